@@ -83,6 +83,15 @@ capture_agg() {
     } > "$OUT/agg-$label.txt"
 }
 
+# Driver side BlockAck and A-MPDU counters, if this rtw88 build has them.
+capture_rtw88_agg() {
+    local label=$1 f
+    for f in /sys/kernel/debug/ieee80211/*/rtw88/agg_stats; do
+        [ -r "$f" ] || continue
+        { echo "== $f =="; cat "$f"; echo; } >> "$OUT/rtw88-agg-$label.txt"
+    done
+}
+
 capture_station() {
     local label=$1
     iw dev "$IFACE" station dump > "$OUT/station-$label.txt"
@@ -108,6 +117,7 @@ RX0=$(cat "/sys/class/net/$IFACE/statistics/rx_bytes")
 capture_link before
 capture_station before
 capture_agg before
+capture_rtw88_agg before
 
 dmesg > "$OUT/dmesg-before.txt" 2>/dev/null || true
 printf 'Running %ss TCP upload to %s on %s...\n' "$DURATION" "$SERVER" "$IFACE"
@@ -117,6 +127,7 @@ iperf3 --bind-dev "$IFACE" -c "$SERVER" -t "$DURATION" -i "$INTERVAL" \
 # Capture immediately while the BA session is still warm.
 capture_agg after
 capture_station after
+capture_rtw88_agg after
 capture_link after
 dmesg > "$OUT/dmesg-after.txt" 2>/dev/null || true
 
@@ -135,6 +146,11 @@ RX1=$(cat "/sys/class/net/$IFACE/statistics/rx_bytes")
     echo
     echo "After active BlockAck entries:"
     grep -E 'active|operational|TX.*[Yy]es|RX.*[Yy]es' "$OUT/agg-after.txt" || true
+    if [ -f "$OUT/rtw88-agg-after.txt" ]; then
+        echo
+        echo "Driver aggregation counters after:"
+        grep -E '^(rx_ampdu_len|sta=)' "$OUT/rtw88-agg-after.txt" || true
+    fi
 } | tee "$OUT/SUMMARY.txt"
 
 echo "Results: $OUT"
@@ -12,6 +12,7 @@
 #include "phy.h"
 #include "reg.h"
 #include "ps.h"
+#include "hrc.h"
 #include "regd.h"
 
 #ifdef CONFIG_RTW88_DEBUGFS
@@ -97,6 +98,23 @@ struct rtw_debugfs {
 	struct rtw_debugfs_priv fw_crash;
 	struct rtw_debugfs_priv force_lowest_basic_rate;
 	struct rtw_debugfs_priv dm_cap;
+	struct rtw_debugfs_priv tx_report;
+	struct rtw_debugfs_priv bss_cck;
+	struct rtw_debugfs_priv traffic_stats;
+	struct rtw_debugfs_priv watch_dog;
+	struct rtw_debugfs_priv lps_policy;
+	struct rtw_debugfs_priv h2c_queue;
+	struct rtw_debugfs_priv c2h_stats;
+	struct rtw_debugfs_priv iqk_cache;
+	struct rtw_debugfs_priv txagc;
+	struct rtw_debugfs_priv tx_pwr_cache;
+	struct rtw_debugfs_priv chan_switch;
+	struct rtw_debugfs_priv rf_shadow;
+	struct rtw_debugfs_priv boot_profile;
+	struct rtw_debugfs_priv ips_wake;
+	struct rtw_debugfs_priv sec_cam;
+	struct rtw_debugfs_priv host_rc;
+	struct rtw_debugfs_priv agg_stats;
 };
 
 static const char * const rtw_dm_cap_strs[] = {
@@ -1151,6 +1169,787 @@ static int rtw_debugfs_get_dm_cap(struct seq_file *m, void *v)
 	return 0;
 }
 
+static int rtw_debugfs_get_tx_report(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+	struct rtw_tx_report_stats stats;
+	unsigned long flags;
+	u32 pending;
+
+	spin_lock_irqsave(&tx_report->q_lock, flags);
+	stats = tx_report->stats;
+	pending = bitmap_weight(tx_report->pending, RTW_TX_REPORT_SLOT_NUM);
+	spin_unlock_irqrestore(&tx_report->q_lock, flags);
+
+	seq_printf(m, "pending: %u/%u\n", pending, RTW_TX_REPORT_SLOT_NUM);
+	seq_printf(m, "matched: %u, expired: %u, overwritten: %u, unmatched: %u\n",
+		   stats.matched, stats.expired, stats.overwritten,
+		   stats.unmatched);
+	seq_printf(m, "latency (us): last %u, avg %llu, max %u\n",
+		   stats.latency_last_us,
+		   stats.matched ? div_u64(stats.latency_sum_us, stats.matched) : 0,
+		   stats.latency_max_us);
+
+	return 0;
+}
+
+static void rtw_debugfs_bss_cck_iter(void *data, struct ieee80211_vif *vif)
+{
+	struct rtw_vif *rtwvif = (struct rtw_vif *)vif->drv_priv;
+	struct rtw_bss_cck *bss_cck = &rtwvif->bss_cck;
+	static const char * const state_strs[] = {
+		[RTW_BSS_CCK_INVALID] = "invalid",
+		[RTW_BSS_CCK_UNKNOWN] = "unknown",
+		[RTW_BSS_CCK_SUPPORTED] = "cck",
+		[RTW_BSS_CCK_UNSUPPORTED] = "no cck",
+	};
+	struct seq_file *m = data;
+
+	seq_printf(m, "vif %pM bss %pM: %s, refresh %u\n", vif->addr,
+		   bss_cck->bssid, state_strs[bss_cck->state],
+		   bss_cck->refresh_cnt);
+}
+
+static int rtw_debugfs_get_bss_cck(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+
+	mutex_lock(&rtwdev->mutex);
+	rtw_iterate_vifs(rtwdev, rtw_debugfs_bss_cck_iter, m);
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_traffic_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	static const char * const ac_strs[IEEE80211_NUM_ACS] = {
+		[IEEE80211_AC_VO] = "VO",
+		[IEEE80211_AC_VI] = "VI",
+		[IEEE80211_AC_BE] = "BE",
+		[IEEE80211_AC_BK] = "BK",
+	};
+	static const char * const rate_strs[RTW_RATE_CLASS_NUM] = {
+		[RTW_RATE_CLASS_CCK] = "CCK",
+		[RTW_RATE_CLASS_OFDM] = "OFDM",
+		[RTW_RATE_CLASS_HT] = "HT",
+		[RTW_RATE_CLASS_VHT] = "VHT",
+	};
+	struct rtw_traffic_counters sum;
+	int i;
+
+	rtw_traffic_stats_sum(rtwdev, &sum);
+
+	seq_printf(m, "TX unicast: %llu pkts, %llu bytes, drop %llu\n",
+		   sum.tx_cnt, sum.tx_unicast, sum.tx_drop);
+	seq_printf(m, "RX unicast: %llu pkts, %llu bytes, drop %llu\n",
+		   sum.rx_cnt, sum.rx_unicast, sum.rx_drop);
+
+	for (i = 0; i < IEEE80211_NUM_ACS; i++)
+		seq_printf(m, "%-2s: TX %llu pkts %llu bytes, RX %llu pkts %llu bytes\n",
+			   ac_strs[i], sum.tx_ac_pkts[i], sum.tx_ac_bytes[i],
+			   sum.rx_ac_pkts[i], sum.rx_ac_bytes[i]);
+
+	for (i = 0; i < RTW_RATE_CLASS_NUM; i++)
+		seq_printf(m, "%-4s: TX %llu, RX %llu\n", rate_strs[i],
+			   sum.tx_rate_pkts[i], sum.rx_rate_pkts[i]);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_watch_dog(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	static const char * const task_strs[RTW_WATCH_DOG_TASK_NUM] = {
+		[RTW_WATCH_DOG_TRAFFIC] = "traffic",
+		[RTW_WATCH_DOG_COEX] = "coex",
+		[RTW_WATCH_DOG_DIG] = "dig",
+		[RTW_WATCH_DOG_CCK_PD] = "cck_pd",
+		[RTW_WATCH_DOG_RA] = "ra",
+		[RTW_WATCH_DOG_PWR_TRACK] = "pwr_track",
+		[RTW_WATCH_DOG_TRACK] = "track",
+	};
+	int i;
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "rounds: %u, lps leave: %u\n", rtwdev->watch_dog_cnt,
+		   sched->lps_leave_cnt);
+	for (i = 0; i < RTW_WATCH_DOG_TASK_NUM; i++)
+		seq_printf(m, "%-10s run %u skip %u\n", task_strs[i],
+			   sched->stats[i].run, sched->stats[i].skip);
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static ssize_t rtw_debugfs_set_lps_policy(struct file *filp,
+					  const char __user *buffer,
+					  size_t count, loff_t *loff)
+{
+	struct seq_file *seqpriv = (struct seq_file *)filp->private_data;
+	struct rtw_debugfs_priv *debugfs_priv = seqpriv->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_lps_policy *policy = &rtwdev->lps_conf.policy;
+	u32 idle_ms, rt_ms, gap_ms;
+	char tmp[48 + 1];
+	char name[16];
+	int num;
+	int ret;
+
+	ret = rtw_debugfs_copy_from_user(tmp, sizeof(tmp), buffer, count, 1);
+	if (ret)
+		return ret;
+
+	/* <policy> [<idle timeout ms> <VO/VI timeout ms> <active gap ms>] */
+	num = sscanf(tmp, "%15s %u %u %u", name, &idle_ms, &rt_ms, &gap_ms);
+	if (num != 1 && num != 4)
+		return -EINVAL;
+
+	mutex_lock(&rtwdev->mutex);
+	ret = rtw_lps_policy_set(rtwdev, name);
+	if (!ret && num == 4) {
+		policy->idle_timeout_ms = idle_ms;
+		policy->rt_timeout_ms = rt_ms;
+		policy->active_gap_ms = gap_ms;
+	}
+	mutex_unlock(&rtwdev->mutex);
+
+	return ret ? ret : count;
+}
+
+static int rtw_debugfs_get_lps_policy(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_lps_policy *policy = &rtwdev->lps_conf.policy;
+	struct rtw_lps_stats *stats = &policy->stats;
+	u64 residency_us;
+	bool in_lps;
+
+	mutex_lock(&rtwdev->mutex);
+
+	in_lps = test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags);
+	residency_us = stats->residency_us;
+	if (in_lps)
+		residency_us += ktime_us_delta(ktime_get(), stats->enter_time);
+
+	seq_printf(m, "policy: %s (traffic, idle)\n",
+		   rtw_lps_policy_name(policy->type));
+	seq_printf(m, "idle timeout: %u ms, VO/VI timeout: %u ms, active gap: %u ms\n",
+		   policy->idle_timeout_ms, policy->rt_timeout_ms,
+		   policy->active_gap_ms);
+	seq_printf(m, "active ACs: VO %d VI %d BE %d BK %d\n",
+		   test_bit(IEEE80211_AC_VO, &policy->active_acs),
+		   test_bit(IEEE80211_AC_VI, &policy->active_acs),
+		   test_bit(IEEE80211_AC_BE, &policy->active_acs),
+		   test_bit(IEEE80211_AC_BK, &policy->active_acs));
+	seq_printf(m, "LPS: %s, enter %u, leave %u, residency %llu ms\n",
+		   in_lps ? "on" : "off", stats->enter_cnt, stats->leave_cnt,
+		   div_u64(residency_us, USEC_PER_MSEC));
+	seq_printf(m, "leave latency (us): last %u, avg %llu, max %u\n",
+		   stats->leave_last_us,
+		   stats->leave_cnt ?
+		   div_u64(stats->leave_sum_us, stats->leave_cnt) : 0,
+		   stats->leave_max_us);
+	seq_printf(m, "leave latency (ms): <1 %u, <2 %u, <5 %u, <10 %u, <20 %u, <50 %u, <100 %u, >=100 %u\n",
+		   stats->leave_hist[0], stats->leave_hist[1],
+		   stats->leave_hist[2], stats->leave_hist[3],
+		   stats->leave_hist[4], stats->leave_hist[5],
+		   stats->leave_hist[6], stats->leave_hist[7]);
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_h2c_queue(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_h2c_stats *stats = &rtwdev->h2c.stats;
+	struct rtw_h2c_lat *lat;
+	int i;
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "depth: %u, max depth: %u\n", rtwdev->h2c.queue_len,
+		   stats->max_depth);
+	seq_printf(m, "queued: %u, coalesced: %u, direct: %u, fail: %u\n",
+		   stats->queued, stats->coalesced, stats->direct, stats->fail);
+	seq_printf(m, "HMETFR reads: %u, box waits: %u\n",
+		   stats->hmetfr_reads, stats->box_waits);
+	seq_printf(m, "pkt: %u in %u transfers, flush size %u barrier %u deadline %u\n",
+		   stats->pkt_sent, stats->pkt_xfers,
+		   stats->pkt_flush[RTW_H2C_PKT_FLUSH_SIZE],
+		   stats->pkt_flush[RTW_H2C_PKT_FLUSH_BARRIER],
+		   stats->pkt_flush[RTW_H2C_PKT_FLUSH_DEADLINE]);
+	for (i = 0; i < RTW_H2C_LAT_NUM; i++) {
+		lat = &stats->lat[i];
+		if (!lat->cnt)
+			break;
+		seq_printf(m, "cmd 0x%02x: cnt %u avg %llu us max %u us\n",
+			   lat->cmd_id, lat->cnt,
+			   div_u64(lat->sum_us, lat->cnt), lat->max_us);
+	}
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_c2h_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_c2h_stats *stats = &rtwdev->c2h_stats;
+	static const char * const class_strs[RTW_C2H_CLASS_NUM] = {
+		[RTW_C2H_CLASS_WORK] = "work",
+		[RTW_C2H_CLASS_HIPRI] = "hipri",
+		[RTW_C2H_CLASS_ATOMIC] = "atomic",
+	};
+	struct rtw_c2h_stats_entry ent[RTW_C2H_STATS_NUM];
+	u32 class_cnt[RTW_C2H_CLASS_NUM];
+	unsigned long flags;
+	u32 unhandled;
+	int i;
+
+	spin_lock_irqsave(&stats->lock, flags);
+	memcpy(ent, stats->ent, sizeof(ent));
+	memcpy(class_cnt, stats->class_cnt, sizeof(class_cnt));
+	unhandled = stats->unhandled;
+	spin_unlock_irqrestore(&stats->lock, flags);
+
+	seq_printf(m, "atomic: %u, hipri: %u, work: %u, unhandled: %u\n",
+		   class_cnt[RTW_C2H_CLASS_ATOMIC],
+		   class_cnt[RTW_C2H_CLASS_HIPRI],
+		   class_cnt[RTW_C2H_CLASS_WORK], unhandled);
+	for (i = 0; i < RTW_C2H_STATS_NUM; i++) {
+		if (!ent[i].cnt)
+			break;
+		seq_printf(m, "id 0x%02x/0x%02x %-6s cnt %u avg %llu us max %u us\n",
+			   ent[i].id, ent[i].sub_id, class_strs[ent[i].class],
+			   ent[i].cnt, div_u64(ent[i].sum_us, ent[i].cnt),
+			   ent[i].max_us);
+	}
+
+	return 0;
+}
+
+static ssize_t rtw_debugfs_set_iqk_cache(struct file *filp,
+					 const char __user *buffer,
+					 size_t count, loff_t *loff)
+{
+	struct seq_file *seqpriv = (struct seq_file *)filp->private_data;
+	struct rtw_debugfs_priv *debugfs_priv = seqpriv->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	bool input;
+	int ret;
+
+	ret = kstrtobool_from_user(buffer, count, &input);
+	if (ret)
+		return ret;
+
+	if (!input)
+		return -EINVAL;
+
+	mutex_lock(&rtwdev->mutex);
+	rtw_phy_iqk_cache_flush(rtwdev);
+	mutex_unlock(&rtwdev->mutex);
+
+	return count;
+}
+
+static int rtw_debugfs_get_iqk_cache(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_iqk_cache *cache = &rtwdev->dm_info.iqk_cache;
+	struct rtw_iqk_cache_entry *ent;
+	int i;
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "hit: %u, miss: %u, forced: %u, flush: %u\n",
+		   cache->hit, cache->miss, cache->forced, cache->flush);
+	seq_printf(m, "saved: %llu ms\n", div_u64(cache->saved_us, 1000));
+	for (i = 0; i < RTW_IQK_CACHE_NUM; i++) {
+		ent = &cache->ent[i];
+		if (!ent->valid)
+			continue;
+		seq_printf(m, "ch_group %u bw %u thermal %u-%u cost %u us\n",
+			   ent->ch_group, ent->bw,
+			   ent->thermal * RTW_IQK_CACHE_THERMAL_STEP,
+			   (ent->thermal + 1) * RTW_IQK_CACHE_THERMAL_STEP - 1,
+			   ent->cost_us);
+	}
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_txagc(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_txagc_shadow *txagc = &rtwdev->hal.txagc;
+
+	mutex_lock(&rtwdev->hal.tx_power_mutex);
+
+	seq_printf(m, "registers: %u\n", txagc->num);
+	seq_printf(m, "last channel switch: writes %u skips %u reads %u\n",
+		   txagc->last_switch.writes, txagc->last_switch.skips,
+		   txagc->last_switch.reads);
+	seq_printf(m, "total: writes %u skips %u reads %u\n",
+		   txagc->total.writes, txagc->total.skips, txagc->total.reads);
+
+	mutex_unlock(&rtwdev->hal.tx_power_mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_tx_pwr_cache(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_tx_pwr_cache *cache = &rtwdev->hal.tx_pwr_cache;
+	struct rtw_tx_pwr_cache_entry *ent;
+	int i;
+
+	mutex_lock(&rtwdev->hal.tx_power_mutex);
+
+	seq_printf(m, "hit: %u miss: %u flush: %u\n",
+		   cache->hit, cache->miss, cache->flush);
+	for (i = 0; i < RTW_TX_PWR_CACHE_NUM; i++) {
+		ent = &cache->ent[i];
+		if (!ent->valid)
+			continue;
+
+		seq_printf(m, "[%02d] band %u ch %3u/%3u bw %u regd %u sar_band %u remnant cck %d ofdm %d/%d\n",
+			   i, ent->band, ent->channel, ent->primary, ent->bw,
+			   ent->regd, ent->sar_band, ent->remnant_cck,
+			   ent->remnant_ofdm[RF_PATH_A],
+			   ent->remnant_ofdm[RF_PATH_B]);
+	}
+
+	mutex_unlock(&rtwdev->hal.tx_power_mutex);
+
+	return 0;
+}
+
+static ssize_t rtw_debugfs_set_chan_switch(struct file *filp,
+					   const char __user *buffer,
+					   size_t count, loff_t *loff)
+{
+	struct seq_file *seqpriv = (struct seq_file *)filp->private_data;
+	struct rtw_debugfs_priv *debugfs_priv = seqpriv->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_chan_delta *cd = &rtwdev->hal.chan_delta;
+	bool reset;
+	int ret;
+
+	ret = kstrtobool_from_user(buffer, count, &reset);
+	if (ret)
+		return ret;
+
+	if (!reset)
+		return count;
+
+	/* clear the statistics and reprogram everything on the next switch */
+	mutex_lock(&rtwdev->mutex);
+	cd->full = 0;
+	cd->delta = 0;
+	cd->writes = 0;
+	cd->skips = 0;
+	memset(cd->hist, 0, sizeof(cd->hist));
+	memset(cd->pair, 0, sizeof(cd->pair));
+	cd->pair_overflow = 0;
+	rtw_phy_chan_delta_invalidate(rtwdev);
+	mutex_unlock(&rtwdev->mutex);
+
+	return count;
+}
+
+static int rtw_debugfs_get_chan_switch(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_chan_delta *cd = &rtwdev->hal.chan_delta;
+	struct rtw_chan_sw_pair *pair;
+	int i;
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "full: %u delta: %u writes: %u skips: %u\n",
+		   cd->full, cd->delta, cd->writes, cd->skips);
+
+	seq_puts(m, "latency:\n");
+	for (i = 0; i < RTW_CHAN_SW_HIST_NUM; i++) {
+		if (i == RTW_CHAN_SW_HIST_NUM - 1)
+			seq_printf(m, "  >= %5u us: %u\n",
+				   128 << (i - 1), cd->hist[i]);
+		else
+			seq_printf(m, "  <  %5u us: %u\n",
+				   128 << i, cd->hist[i]);
+	}
+
+	seq_puts(m, "pairs:\n");
+	for (i = 0; i < RTW_CHAN_SW_PAIR_NUM; i++) {
+		pair = &cd->pair[i];
+		if (!pair->count)
+			break;
+
+		seq_printf(m, "  %3u -> %3u: count %u avg %u us max %u us\n",
+			   pair->from, pair->to, pair->count,
+			   pair->total_us / pair->count, pair->max_us);
+	}
+	seq_printf(m, "  untracked pairs: %u\n", cd->pair_overflow);
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_rf_shadow(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	const struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_rf_shadow *shadow = &rtwdev->hal.rf_shadow;
+	u8 path;
+	int i;
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "hit: %u miss: %u invalidate: %u\n",
+		   shadow->hit, shadow->miss, shadow->invalidate);
+	for (path = 0; path < rtwdev->hal.rf_phy_num; path++) {
+		for (i = 0; i < chip->rf_shadow_def_num; i++) {
+			if (!(shadow->valid[path] & BIT(i)))
+				continue;
+
+			seq_printf(m, "path %u RF 0x%02x: 0x%05x\n", path,
+				   chip->rf_shadow_def[i].addr,
+				   shadow->val[path][i]);
+		}
+	}
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static const char * const rtw_boot_kind_strs[] = {
+	[RTW_BOOT_PROBE] = "probe",
+	[RTW_BOOT_POWER_ON] = "power_on",
+	[RTW_BOOT_IPS_LEAVE] = "ips_leave",
+};
+
+static const char * const rtw_boot_stage_strs[] = {
+	[RTW_BOOT_STAGE_CORE_INIT] = "core_init",
+	[RTW_BOOT_STAGE_HCI_PROBE] = "hci_probe",
+	[RTW_BOOT_STAGE_CHIP_PARAM] = "chip_param",
+	[RTW_BOOT_STAGE_EFUSE] = "efuse",
+	[RTW_BOOT_STAGE_BOARD_INFO] = "board_info",
+	[RTW_BOOT_STAGE_HCI_SETUP] = "hci_setup",
+	[RTW_BOOT_STAGE_MAC_POWER_ON] = "mac_power_on",
+	[RTW_BOOT_STAGE_FW_WAIT] = "fw_wait",
+	[RTW_BOOT_STAGE_FW_DOWNLOAD] = "fw_download",
+	[RTW_BOOT_STAGE_MAC_INIT] = "mac_init",
+	[RTW_BOOT_STAGE_PHY_SET_PARAM] = "phy_set_param",
+	[RTW_BOOT_STAGE_MAC_POSTINIT] = "mac_postinit",
+	[RTW_BOOT_STAGE_HCI_START] = "hci_start",
+	[RTW_BOOT_STAGE_RFK_COEX] = "rfk_coex",
+	[RTW_BOOT_STAGE_IPS_RESTORE] = "ips_restore",
+};
+
+static int rtw_debugfs_get_boot_profile(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_boot_profile *bp = &rtwdev->boot_profile;
+	const struct rtw_boot_stage_rec *stage;
+	const struct rtw_boot_rec *rec;
+	int i, j;
+
+	BUILD_BUG_ON(ARRAY_SIZE(rtw_boot_kind_strs) != RTW_BOOT_KIND_NUM);
+	BUILD_BUG_ON(ARRAY_SIZE(rtw_boot_stage_strs) != RTW_BOOT_STAGE_NUM);
+
+	mutex_lock(&rtwdev->mutex);
+
+	/* newest first */
+	for (i = 1; i <= bp->cnt; i++) {
+		rec = &bp->ring[(bp->head + RTW_BOOT_PROFILE_NUM - i) %
+				RTW_BOOT_PROFILE_NUM];
+
+		seq_printf(m, "%s: %u us ret %d\n",
+			   rtw_boot_kind_strs[rec->kind], rec->total_us,
+			   rec->ret);
+		for (j = 0; j < RTW_BOOT_STAGE_NUM; j++) {
+			stage = &rec->stage[j];
+			if (!stage->us && !stage->reads && !stage->writes &&
+			    !stage->xfers)
+				continue;
+
+			seq_printf(m, "  %-14s %8u us  rd %6u wr %6u xfer %4u\n",
+				   rtw_boot_stage_strs[j], stage->us,
+				   stage->reads, stage->writes, stage->xfers);
+		}
+	}
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static const char * const rtw_ips_wake_strs[] = {
+	[RTW_IPS_WAKE_FULL] = "full",
+	[RTW_IPS_WAKE_SOFT] = "soft",
+	[RTW_IPS_WAKE_RETENTION] = "retention",
+	[RTW_IPS_WAKE_FALLBACK] = "fallback",
+};
+
+static int rtw_debugfs_get_ips_wake(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	const struct rtw_ips_wake_stat *stat;
+	int i;
+
+	BUILD_BUG_ON(ARRAY_SIZE(rtw_ips_wake_strs) != RTW_IPS_WAKE_NUM);
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "retention: %s, parked: %d\n",
+		   rtw_ips_retention ? "on" : "off",
+		   test_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags));
+	for (i = 0; i < RTW_IPS_WAKE_NUM; i++) {
+		stat = &rtwdev->ips.wake[i];
+		seq_printf(m, "%-10s cnt %6u last %8u us avg %8llu us max %8u us\n",
+			   rtw_ips_wake_strs[i], stat->cnt, stat->last_us,
+			   stat->cnt ? div_u64(stat->total_us, stat->cnt) : 0,
+			   stat->max_us);
+	}
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_sec_cam(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_sec_desc *sec = &rtwdev->sec;
+	struct rtw_cam_entry *cam;
+	u8 hw_key_idx;
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "words written %u skipped %u, entries restored %u\n",
+		   sec->cam_stats.written, sec->cam_stats.skipped,
+		   sec->cam_stats.restored);
+	for_each_set_bit(hw_key_idx, sec->cam_map, RTW_MAX_SEC_CAM_NUM) {
+		cam = &sec->cam_table[hw_key_idx];
+		seq_printf(m, "%2u: %pM type %u %s known 0x%02x\n",
+			   hw_key_idx, cam->addr, cam->hw_key_type,
+			   cam->group ? "group" : "pairwise",
+			   sec->cam_known[hw_key_idx]);
+	}
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static void rtw_debugfs_host_rc_iter(void *data, struct ieee80211_sta *sta)
+{
+	struct seq_file *m = data;
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+	const struct rtw_hrc *hrc = &si->hrc;
+	const struct rtw_hrc_rate *r;
+	unsigned long flags;
+	u8 i;
+
+	spin_lock_irqsave(&si->hrc_lock, flags);
+
+	seq_printf(m, "%pM macid %u: max_tp 0x%02x max_prob 0x%02x frames %u samples %u updates %u stray %u\n",
+		   sta->addr, si->mac_id, hrc->max_tp_rate, hrc->max_prob_rate,
+		   hrc->frames, hrc->samples, hrc->updates, hrc->stray);
+	for (i = 0; i < RTW_HRC_RATE_NUM; i++) {
+		if (!(hrc->rate_mask & BIT(i)))
+			continue;
+
+		r = &hrc->rates[i];
+		seq_printf(m, "  %c%c 0x%02x prob %4u/%u tp %7u att %8u succ %8u\n",
+			   i == hrc->max_tp_rate ? 'T' : ' ',
+			   i == hrc->max_prob_rate ? 'P' : ' ',
+			   i, r->prob, RTW_HRC_PROB_SCALE, rtw_hrc_tp(hrc, i),
+			   r->att_total, r->succ_total);
+	}
+
+	spin_unlock_irqrestore(&si->hrc_lock, flags);
+}
+
+static int rtw_debugfs_get_host_rc(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+
+	mutex_lock(&rtwdev->mutex);
+
+	seq_printf(m, "host rate control: %s%s\n",
+		   rtwdev->host_rc ? "on" : "off",
+		   rtw_hrc_supported(rtwdev) ? "" : " (not supported)");
+	rtw_iterate_stas(rtwdev, rtw_debugfs_host_rc_iter, m);
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static ssize_t rtw_debugfs_set_host_rc(struct file *filp,
+				       const char __user *buffer,
+				       size_t count, loff_t *loff)
+{
+	struct seq_file *seqpriv = (struct seq_file *)filp->private_data;
+	struct rtw_debugfs_priv *debugfs_priv = seqpriv->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buffer, count, &enable);
+	if (ret)
+		return ret;
+
+	if (enable && !rtw_hrc_supported(rtwdev))
+		return -EOPNOTSUPP;
+
+	mutex_lock(&rtwdev->mutex);
+	WRITE_ONCE(rtwdev->host_rc, enable);
+	mutex_unlock(&rtwdev->mutex);
+
+	return count;
+}
+
+static const char * const rtw_agg_state_strs[] = {
+	[RTW_AGG_IDLE] = "idle",
+	[RTW_AGG_REQUESTED] = "requested",
+	[RTW_AGG_STARTING] = "starting",
+	[RTW_AGG_OPERATIONAL] = "operational",
+	[RTW_AGG_BLOCKED] = "blocked",
+};
+
+static const char * const rtw_rx_agg_hist_strs[] = {
+	"1", "2", "3-4", "5-8", "9-16", "17-32", "33-64", "65+",
+};
+
+static void rtw_debugfs_agg_stats_iter(void *data, struct ieee80211_sta *sta)
+{
+	struct seq_file *m = data;
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+	const struct rtw_agg_tid_stats *stats;
+	u8 tid;
+
+	for (tid = 0; tid < IEEE80211_NUM_TIDS; tid++) {
+		stats = &si->agg[tid];
+		if (stats->state == RTW_AGG_IDLE && !stats->rx_active &&
+		    !stats->ampdu_frames && !stats->single_frames &&
+		    !memchr_inv(stats->ev, 0, sizeof(stats->ev)))
+			continue;
+
+		seq_printf(m, "sta=%pM macid=%u tid=%u state=%s rx_ba=%d",
+			   sta->addr, si->mac_id, tid,
+			   rtw_agg_state_strs[stats->state], stats->rx_active);
+		seq_printf(m, " req=%u refused=%u blocked=%u start=%u setup=%u teardown=%u",
+			   stats->ev[RTW_AGG_EV_REQUEST],
+			   stats->ev[RTW_AGG_EV_REFUSED],
+			   stats->ev[RTW_AGG_EV_BLOCKED],
+			   stats->ev[RTW_AGG_EV_TX_START],
+			   stats->ev[RTW_AGG_EV_TX_OPERATIONAL],
+			   stats->ev[RTW_AGG_EV_TX_STOP]);
+		seq_printf(m, " rx_start=%u rx_stop=%u ampdu=%u single=%u\n",
+			   stats->ev[RTW_AGG_EV_RX_START],
+			   stats->ev[RTW_AGG_EV_RX_STOP],
+			   stats->ampdu_frames, stats->single_frames);
+	}
+}
+
+static int rtw_debugfs_get_agg_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	const struct rtw_rx_agg_hist *hist = &rtwdev->rx_agg;
+	int i;
+
+	BUILD_BUG_ON(ARRAY_SIZE(rtw_agg_state_strs) != RTW_AGG_STATE_NUM);
+	BUILD_BUG_ON(ARRAY_SIZE(rtw_rx_agg_hist_strs) != RTW_RX_AGG_HIST_NUM);
+
+	mutex_lock(&rtwdev->mutex);
+
+	/* estimated from the 2-bit ppdu_cnt, see rtw_rx_agg_account() */
+	seq_puts(m, "rx_ampdu_len_est");
+	for (i = 0; i < RTW_RX_AGG_HIST_NUM; i++)
+		seq_printf(m, " %s=%u", rtw_rx_agg_hist_strs[i], hist->len[i]);
+	seq_puts(m, "\n");
+
+	rtw_iterate_stas(rtwdev, rtw_debugfs_agg_stats_iter, m);
+
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static void rtw_debugfs_agg_stats_reset_iter(void *data,
+					     struct ieee80211_sta *sta)
+{
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+	struct rtw_agg_tid_stats *stats;
+	u8 tid;
+
+	/* the session state is live, only the counters start over */
+	for (tid = 0; tid < IEEE80211_NUM_TIDS; tid++) {
+		stats = &si->agg[tid];
+		memset(stats->ev, 0, sizeof(stats->ev));
+		stats->ampdu_frames = 0;
+		stats->single_frames = 0;
+	}
+}
+
+static ssize_t rtw_debugfs_set_agg_stats(struct file *filp,
+					 const char __user *buffer,
+					 size_t count, loff_t *loff)
+{
+	struct seq_file *seqpriv = (struct seq_file *)filp->private_data;
+	struct rtw_debugfs_priv *debugfs_priv = seqpriv->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	bool reset;
+	int ret;
+
+	ret = kstrtobool_from_user(buffer, count, &reset);
+	if (ret)
+		return ret;
+
+	if (!reset)
+		return count;
+
+	mutex_lock(&rtwdev->mutex);
+	memset(rtwdev->rx_agg.len, 0, sizeof(rtwdev->rx_agg.len));
+	rtw_iterate_stas(rtwdev, rtw_debugfs_agg_stats_reset_iter, NULL);
+	mutex_unlock(&rtwdev->mutex);
+
+	return count;
+}
+
 #define rtw_debug_priv_mac(addr)				\
 {								\
 	.cb_read = rtw_debug_get_mac_page,			\
@@ -1239,6 +2038,23 @@ static const struct rtw_debugfs rtw_debugfs_templ = {
 	.fw_crash = rtw_debug_priv_set_and_get(fw_crash),
 	.force_lowest_basic_rate = rtw_debug_priv_set_and_get(force_lowest_basic_rate),
 	.dm_cap = rtw_debug_priv_set_and_get(dm_cap),
+	.tx_report = rtw_debug_priv_get(tx_report),
+	.bss_cck = rtw_debug_priv_get(bss_cck),
+	.traffic_stats = rtw_debug_priv_get(traffic_stats),
+	.watch_dog = rtw_debug_priv_get(watch_dog),
+	.lps_policy = rtw_debug_priv_set_and_get(lps_policy),
+	.h2c_queue = rtw_debug_priv_get(h2c_queue),
+	.c2h_stats = rtw_debug_priv_get(c2h_stats),
+	.iqk_cache = rtw_debug_priv_set_and_get(iqk_cache),
+	.txagc = rtw_debug_priv_get(txagc),
+	.tx_pwr_cache = rtw_debug_priv_get(tx_pwr_cache),
+	.chan_switch = rtw_debug_priv_set_and_get(chan_switch),
+	.rf_shadow = rtw_debug_priv_get(rf_shadow),
+	.boot_profile = rtw_debug_priv_get(boot_profile),
+	.ips_wake = rtw_debug_priv_get(ips_wake),
+	.sec_cam = rtw_debug_priv_get(sec_cam),
+	.host_rc = rtw_debug_priv_set_and_get(host_rc),
+	.agg_stats = rtw_debug_priv_set_and_get(agg_stats),
 };
 
 #define rtw_debugfs_add_core(name, mode, fopname, parent)		\
@@ -1279,6 +2095,23 @@ void rtw_debugfs_add_basic(struct rtw_dev *rtwdev, struct dentry *debugfs_topdir
 	rtw_debugfs_add_rw(fw_crash);
 	rtw_debugfs_add_rw(force_lowest_basic_rate);
 	rtw_debugfs_add_rw(dm_cap);
+	rtw_debugfs_add_r(tx_report);
+	rtw_debugfs_add_r(bss_cck);
+	rtw_debugfs_add_r(traffic_stats);
+	rtw_debugfs_add_r(watch_dog);
+	rtw_debugfs_add_rw(lps_policy);
+	rtw_debugfs_add_r(h2c_queue);
+	rtw_debugfs_add_r(c2h_stats);
+	rtw_debugfs_add_rw(iqk_cache);
+	rtw_debugfs_add_r(txagc);
+	rtw_debugfs_add_r(tx_pwr_cache);
+	rtw_debugfs_add_rw(chan_switch);
+	rtw_debugfs_add_r(rf_shadow);
+	rtw_debugfs_add_r(boot_profile);
+	rtw_debugfs_add_r(ips_wake);
+	rtw_debugfs_add_r(sec_cam);
+	rtw_debugfs_add_rw(host_rc);
+	rtw_debugfs_add_rw(agg_stats);
 }
 
 static
@@ -3,6 +3,7 @@
  */
 
 #include <linux/iopoll.h>
+#include <linux/crc32.h>
 
 #include "main.h"
 #include "efuse.h"
@@ -84,10 +85,11 @@ static int rtw_dump_logical_efuse_map(struct rtw_dev *rtwdev, u8 *phy_map,
 	return 0;
 }
 
-static int rtw_dump_physical_efuse_map(struct rtw_dev *rtwdev, u8 *map)
+/* read physical efuse bytes [start, end) into @map */
+static int rtw_dump_physical_efuse_map(struct rtw_dev *rtwdev, u8 *map,
+				       u32 start, u32 end)
 {
 	const struct rtw_chip_info *chip = rtwdev->chip;
-	u32 size = rtwdev->efuse.physical_size;
 	u32 efuse_ctl;
 	u32 addr;
 	u32 cnt;
@@ -101,7 +103,7 @@ static int rtw_dump_physical_efuse_map(struct rtw_dev *rtwdev, u8 *map)
 
 	efuse_ctl = rtw_read32(rtwdev, REG_EFUSE_CTRL);
 
-	for (addr = 0; addr < size; addr++) {
+	for (addr = start; addr < end; addr++) {
 		efuse_ctl &= ~(BIT_MASK_EF_DATA | BITS_EF_ADDR);
 		efuse_ctl |= (addr & BIT_MASK_EF_ADDR) << BIT_SHIFT_EF_ADDR;
 		rtw_write32(rtwdev, REG_EFUSE_CTRL, efuse_ctl & (~BIT_EF_FLAG));
@@ -143,14 +145,130 @@ int rtw_read8_physical_efuse(struct rtw_dev *rtwdev, u16 addr, u8 *data)
 }
 EXPORT_SYMBOL(rtw_read8_physical_efuse);
 
+/* The first physical bytes identify a device together with its bus name,
+ * they hold the headers and the first blocks written at calibration. Two
+ * cards can share them, so the cache is opt-in, see rtw_efuse_cache.
+ */
+#define RTW_EFUSE_ID_LEN	32
+
+struct rtw_efuse_cache_entry {
+	struct list_head list;
+	char dev_name[32];
+	u8 chip_id;
+	u8 id[RTW_EFUSE_ID_LEN];
+	u32 crc;
+	u32 read_us;
+	u32 size;
+	u8 log_map[];
+};
+
+/* logical maps of the devices probed since rtw_core was loaded */
+static LIST_HEAD(rtw_efuse_cache_list);
+static DEFINE_MUTEX(rtw_efuse_cache_mutex);
+
+static struct rtw_efuse_cache_entry *
+rtw_efuse_cache_find(struct rtw_dev *rtwdev, const u8 *id)
+{
+	struct rtw_efuse_cache_entry *ent;
+
+	lockdep_assert_held(&rtw_efuse_cache_mutex);
+
+	list_for_each_entry(ent, &rtw_efuse_cache_list, list) {
+		if (ent->chip_id == rtwdev->chip->id &&
+		    !strcmp(ent->dev_name, dev_name(rtwdev->dev)) &&
+		    !memcmp(ent->id, id, RTW_EFUSE_ID_LEN))
+			return ent;
+	}
+
+	return NULL;
+}
+
+static bool rtw_efuse_cache_get(struct rtw_dev *rtwdev, const u8 *id,
+				u8 *log_map)
+{
+	u32 log_size = rtwdev->efuse.logical_size;
+	struct rtw_efuse_cache_entry *ent;
+	bool hit = false;
+
+	mutex_lock(&rtw_efuse_cache_mutex);
+
+	ent = rtw_efuse_cache_find(rtwdev, id);
+	if (!ent)
+		goto out;
+
+	if (ent->size != log_size ||
+	    crc32_le(~0, ent->log_map, ent->size) != ent->crc) {
+		rtw_warn(rtwdev, "cached efuse map is corrupted, dropped\n");
+		list_del(&ent->list);
+		kfree(ent);
+		goto out;
+	}
+
+	memcpy(log_map, ent->log_map, log_size);
+	hit = true;
+
+	rtw_info(rtwdev, "reuse cached efuse map, saved about %u us\n",
+		 ent->read_us);
+
+out:
+	mutex_unlock(&rtw_efuse_cache_mutex);
+
+	return hit;
+}
+
+static void rtw_efuse_cache_put(struct rtw_dev *rtwdev, const u8 *id,
+				const u8 *log_map, u32 read_us)
+{
+	u32 log_size = rtwdev->efuse.logical_size;
+	struct rtw_efuse_cache_entry *ent;
+
+	mutex_lock(&rtw_efuse_cache_mutex);
+
+	ent = rtw_efuse_cache_find(rtwdev, id);
+	if (ent) {
+		list_del(&ent->list);
+		kfree(ent);
+	}
+
+	ent = kzalloc(struct_size(ent, log_map, log_size), GFP_KERNEL);
+	if (!ent)
+		goto out;
+
+	strscpy(ent->dev_name, dev_name(rtwdev->dev), sizeof(ent->dev_name));
+	ent->chip_id = rtwdev->chip->id;
+	memcpy(ent->id, id, RTW_EFUSE_ID_LEN);
+	ent->size = log_size;
+	memcpy(ent->log_map, log_map, log_size);
+	ent->crc = crc32_le(~0, ent->log_map, log_size);
+	ent->read_us = read_us;
+	list_add(&ent->list, &rtw_efuse_cache_list);
+
+out:
+	mutex_unlock(&rtw_efuse_cache_mutex);
+}
+
+void rtw_efuse_cache_free(void)
+{
+	struct rtw_efuse_cache_entry *ent, *tmp;
+
+	mutex_lock(&rtw_efuse_cache_mutex);
+	list_for_each_entry_safe(ent, tmp, &rtw_efuse_cache_list, list) {
+		list_del(&ent->list);
+		kfree(ent);
+	}
+	mutex_unlock(&rtw_efuse_cache_mutex);
+}
+
 int rtw_parse_efuse_map(struct rtw_dev *rtwdev)
 {
 	const struct rtw_chip_info *chip = rtwdev->chip;
 	struct rtw_efuse *efuse = &rtwdev->efuse;
 	u32 phy_size = efuse->physical_size;
 	u32 log_size = efuse->logical_size;
+	u32 id_len = min_t(u32, RTW_EFUSE_ID_LEN, phy_size);
 	u8 *phy_map = NULL;
 	u8 *log_map = NULL;
+	ktime_t start;
 	int ret = 0;
 
 	phy_map = kmalloc(phy_size, GFP_KERNEL);
@@ -160,7 +278,20 @@ int rtw_parse_efuse_map(struct rtw_dev *rtwdev)
 		goto out_free;
 	}
 
-	ret = rtw_dump_physical_efuse_map(rtwdev, phy_map);
+	start = ktime_get();
+
+	/* the identity part first, the rest only if the cache misses */
+	memset(phy_map, 0xff, phy_size);
+	ret = rtw_dump_physical_efuse_map(rtwdev, phy_map, 0, id_len);
+	if (ret) {
+		rtw_err(rtwdev, "failed to dump efuse physical map\n");
+		goto out_free;
+	}
+
+	if (rtw_efuse_cache && rtw_efuse_cache_get(rtwdev, phy_map, log_map))
+		goto read_efuse;
+
+	ret = rtw_dump_physical_efuse_map(rtwdev, phy_map, id_len, phy_size);
 	if (ret) {
 		rtw_err(rtwdev, "failed to dump efuse physical map\n");
 		goto out_free;
@@ -173,6 +304,11 @@ int rtw_parse_efuse_map(struct rtw_dev *rtwdev)
 		goto out_free;
 	}
 
+	if (rtw_efuse_cache)
+		rtw_efuse_cache_put(rtwdev, phy_map, log_map,
+				    ktime_us_delta(ktime_get(), start));
+
+read_efuse:
 	ret = chip->ops->read_efuse(rtwdev, log_map);
 	if (ret) {
 		rtw_err(rtwdev, "failed to read efuse map\n");
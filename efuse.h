@@ -25,5 +25,6 @@
 
 int rtw_parse_efuse_map(struct rtw_dev *rtwdev);
 int rtw_read8_physical_efuse(struct rtw_dev *rtwdev, u16 addr, u8 *data);
+void rtw_efuse_cache_free(void);
 
 #endif
@@ -90,30 +90,6 @@ void rtw_fw_dump_dbg_info(struct rtw_dev *rtwdev)
 	}
 }
 
-static void rtw_fw_c2h_cmd_handle_ext(struct rtw_dev *rtwdev,
-				      struct sk_buff *skb)
-{
-	struct rtw_c2h_cmd *c2h;
-	u8 sub_cmd_id;
-
-	c2h = get_c2h_from_skb(skb);
-	sub_cmd_id = c2h->payload[0];
-
-	switch (sub_cmd_id) {
-	case C2H_CCX_RPT:
-		rtw_tx_report_handle(rtwdev, skb, C2H_CCX_RPT);
-		break;
-	case C2H_SCAN_STATUS_RPT:
-		rtw_hw_scan_status_report(rtwdev, skb);
-		break;
-	case C2H_CHAN_SWITCH:
-		rtw_hw_scan_chan_switch(rtwdev, skb);
-		break;
-	default:
-		break;
-	}
-}
-
 static u16 get_max_amsdu_len(u32 bit_rate)
 {
 	/* lower than ofdm, do not aggregate */
@@ -301,81 +277,262 @@ static void rtw_fw_adaptivity_result(struct rtw_dev *rtwdev, u8 *payload,
 		"Set" : "Unset");
 }
 
-void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb)
+struct rtw_c2h_handler {
+	u8 id;
+	u8 class;
+	/* the handler takes over the skb */
+	bool own_skb;
+	void (*handle)(struct rtw_dev *rtwdev, struct sk_buff *skb,
+		       struct rtw_c2h_cmd *c2h, u8 len);
+};
+
+static void rtw_c2h_ccx_tx_rpt(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			       struct rtw_c2h_cmd *c2h, u8 len)
 {
-	struct rtw_c2h_cmd *c2h;
-	u32 pkt_offset;
-	u8 len;
+	if (rtwdev->chip->id == RTW_CHIP_TYPE_8723B &&
+	    rtw_hci_type(rtwdev) == RTW_HCI_TYPE_SDIO) {
+		rtw_tx_report_handle_8723b(rtwdev, len ? c2h->payload[0] : 0,
+					   c2h->payload, len);
+		return;
+	}
 
-	pkt_offset = *((u32 *)skb->cb);
-	c2h = (struct rtw_c2h_cmd *)(skb->data + pkt_offset);
-	len = skb->len - pkt_offset - 2;
+	rtw_tx_report_handle(rtwdev, skb, C2H_CCX_TX_RPT);
+}
 
-	mutex_lock(&rtwdev->mutex);
+static void rtw_c2h_vendor_tx_rpt(struct rtw_dev *rtwdev, struct sk_buff *skb,
+				  struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_tx_report_handle_8723b(rtwdev, c2h->id, c2h->payload, len);
+}
+
+static void rtw_c2h_wlan_rfon(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			      struct rtw_c2h_cmd *c2h, u8 len)
+{
+	/* On 8723B SDIO with v41 firmware, C2H 0x32 carries a scan TX
+	 * report, not a WLAN_RFON event.
+	 */
+	if (rtwdev->chip->id == RTW_CHIP_TYPE_8723B &&
+	    rtw_hci_type(rtwdev) == RTW_HCI_TYPE_SDIO) {
+		rtw_c2h_vendor_tx_rpt(rtwdev, skb, c2h, len);
+		return;
+	}
 
-	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags))
-		goto unlock;
+	rtw_lps_leave_done(rtwdev);
+}
 
-	switch (c2h->id) {
-	case C2H_CCX_TX_RPT:
-		if (rtwdev->chip->id == RTW_CHIP_TYPE_8723B &&
-		    rtw_hci_type(rtwdev) == RTW_HCI_TYPE_SDIO) {
-			rtw_tx_report_handle_8723b(rtwdev,
-						   len ? c2h->payload[0] : 0,
-						   c2h->payload, len);
-			break;
-		}
-		rtw_tx_report_handle(rtwdev, skb, C2H_CCX_TX_RPT);
-		break;
-	case C2H_BT_INFO:
-		rtw_coex_bt_info_notify(rtwdev, c2h->payload, len);
-		break;
-	case C2H_BT_HID_INFO:
-		rtw_coex_bt_hid_info_notify(rtwdev, c2h->payload, len);
-		break;
-	case C2H_WLAN_INFO:
-		rtw_coex_wl_fwdbginfo_notify(rtwdev, c2h->payload, len);
-		break;
-	case C2H_BCN_FILTER_NOTIFY:
-		rtw_fw_bcn_filter_notify(rtwdev, c2h->payload, len);
-		break;
-	case C2H_HALMAC:
-		rtw_fw_c2h_cmd_handle_ext(rtwdev, skb);
-		break;
-	case C2H_RA_RPT:
-		rtw_fw_ra_report_handle(rtwdev, c2h->payload, len);
-		break;
-	case C2H_ADAPTIVITY:
-		rtw_fw_adaptivity_result(rtwdev, c2h->payload, len);
-		break;
-	case C2H_VENDOR_TX_RPT:
-	case C2H_VENDOR_SCAN_TX_RPT:
-		rtw_tx_report_handle_8723b(rtwdev, c2h->id, c2h->payload,
-					   len);
-		break;
-	case C2H_MAILBOX_STATUS:
-		rtw_info(rtwdev, "C2H mailbox status: 0x%02x\n",
-			 len > 0 ? c2h->payload[0] : 0);
-		break;
-	default:
-		rtw_dbg(rtwdev, RTW_DBG_FW, "C2H_DEBUG: unhandled C2H id=0x%02x seq=0x%02x len=%d\n",
-			 c2h->id, c2h->seq, len);
+static void rtw_c2h_bt_mp_info(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			       struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_coex_info_response(rtwdev, skb);
+}
+
+static void rtw_c2h_scan_result(struct rtw_dev *rtwdev, struct sk_buff *skb,
+				struct rtw_c2h_cmd *c2h, u8 len)
+{
+	complete(&rtwdev->fw_scan_density);
+	rtw_fw_scan_result(rtwdev, c2h->payload, len);
+}
+
+static void rtw_c2h_ra_rpt(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			   struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_fw_ra_report_handle(rtwdev, c2h->payload, len);
+}
+
+static void rtw_c2h_bt_info(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			    struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_coex_bt_info_notify(rtwdev, c2h->payload, len);
+}
+
+static void rtw_c2h_bt_hid_info(struct rtw_dev *rtwdev, struct sk_buff *skb,
+				struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_coex_bt_hid_info_notify(rtwdev, c2h->payload, len);
+}
+
+static void rtw_c2h_wlan_info(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			      struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_coex_wl_fwdbginfo_notify(rtwdev, c2h->payload, len);
+}
+
+static void rtw_c2h_bcn_filter(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			       struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_fw_bcn_filter_notify(rtwdev, c2h->payload, len);
+}
+
+static void rtw_c2h_adaptivity(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			       struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_fw_adaptivity_result(rtwdev, c2h->payload, len);
+}
+
+static void rtw_c2h_mailbox_status(struct rtw_dev *rtwdev, struct sk_buff *skb,
+				   struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_info(rtwdev, "C2H mailbox status: 0x%02x\n",
+		 len > 0 ? c2h->payload[0] : 0);
+}
+
+static void rtw_c2h_ccx_rpt(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			    struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_tx_report_handle(rtwdev, skb, C2H_CCX_RPT);
+}
+
+static void rtw_c2h_scan_status_rpt(struct rtw_dev *rtwdev,
+				    struct sk_buff *skb,
+				    struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_hw_scan_status_report(rtwdev, skb);
+}
+
+static void rtw_c2h_chan_switch(struct rtw_dev *rtwdev, struct sk_buff *skb,
+				struct rtw_c2h_cmd *c2h, u8 len)
+{
+	rtw_hw_scan_chan_switch(rtwdev, skb);
+}
+
+/* Only handlers that take no sleeping lock and touch no registers may be
+ * RTW_C2H_CLASS_ATOMIC, RTW_C2H_CLASS_HIPRI ones must not need the mutex.
+ */
+static const struct rtw_c2h_handler rtw_c2h_handlers[] = {
+	{C2H_CCX_TX_RPT, RTW_C2H_CLASS_ATOMIC, false, rtw_c2h_ccx_tx_rpt},
+	{C2H_VENDOR_TX_RPT, RTW_C2H_CLASS_ATOMIC, false, rtw_c2h_vendor_tx_rpt},
+	{C2H_WLAN_RFON, RTW_C2H_CLASS_ATOMIC, false, rtw_c2h_wlan_rfon},
+	{C2H_BT_MP_INFO, RTW_C2H_CLASS_ATOMIC, true, rtw_c2h_bt_mp_info},
+	{C2H_SCAN_RESULT, RTW_C2H_CLASS_ATOMIC, false, rtw_c2h_scan_result},
+	{C2H_RA_RPT, RTW_C2H_CLASS_HIPRI, false, rtw_c2h_ra_rpt},
+	{C2H_BT_INFO, RTW_C2H_CLASS_WORK, false, rtw_c2h_bt_info},
+	{C2H_BT_HID_INFO, RTW_C2H_CLASS_WORK, false, rtw_c2h_bt_hid_info},
+	{C2H_WLAN_INFO, RTW_C2H_CLASS_WORK, false, rtw_c2h_wlan_info},
+	{C2H_BCN_FILTER_NOTIFY, RTW_C2H_CLASS_WORK, false, rtw_c2h_bcn_filter},
+	{C2H_ADAPTIVITY, RTW_C2H_CLASS_WORK, false, rtw_c2h_adaptivity},
+	{C2H_MAILBOX_STATUS, RTW_C2H_CLASS_WORK, false, rtw_c2h_mailbox_status},
+};
+
+/* C2H_HALMAC, keyed by payload[0] */
+static const struct rtw_c2h_handler rtw_c2h_ext_handlers[] = {
+	{C2H_CCX_RPT, RTW_C2H_CLASS_ATOMIC, false, rtw_c2h_ccx_rpt},
+	{C2H_SCAN_STATUS_RPT, RTW_C2H_CLASS_WORK, false, rtw_c2h_scan_status_rpt},
+	{C2H_CHAN_SWITCH, RTW_C2H_CLASS_WORK, false, rtw_c2h_chan_switch},
+};
+
+static const struct rtw_c2h_handler *
+rtw_fw_c2h_lookup(struct rtw_c2h_cmd *c2h, u8 len)
+{
+	const struct rtw_c2h_handler *tbl = rtw_c2h_handlers;
+	int num = ARRAY_SIZE(rtw_c2h_handlers);
+	u8 id = c2h->id;
+	int i;
+
+	if (c2h->id == C2H_HALMAC) {
+		if (!len)
+			return NULL;
+
+		tbl = rtw_c2h_ext_handlers;
+		num = ARRAY_SIZE(rtw_c2h_ext_handlers);
+		id = c2h->payload[0];
+	}
+
+	for (i = 0; i < num; i++)
+		if (tbl[i].id == id)
+			return &tbl[i];
+
+	return NULL;
+}
+
+static void rtw_fw_c2h_account(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			       struct rtw_c2h_cmd *c2h, u8 len, u8 class,
+			       bool handled)
+{
+	struct rtw_c2h_stats *stats = &rtwdev->c2h_stats;
+	u32 us = (u32)ktime_us_delta(ktime_get(), rtw_c2h_cb(skb)->rx_time);
+	u8 sub_id = c2h->id == C2H_HALMAC && len ? c2h->payload[0] : 0;
+	struct rtw_c2h_stats_entry *ent;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&stats->lock, flags);
+
+	stats->class_cnt[class]++;
+	if (!handled)
+		stats->unhandled++;
+	for (i = 0; i < RTW_C2H_STATS_NUM; i++) {
+		ent = &stats->ent[i];
+		if (ent->cnt && (ent->id != c2h->id || ent->sub_id != sub_id))
+			continue;
+
+		ent->id = c2h->id;
+		ent->sub_id = sub_id;
+		ent->class = class;
+		ent->cnt++;
+		ent->sum_us += us;
+		ent->max_us = max(ent->max_us, us);
 		break;
 	}
 
-unlock:
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+
+static void rtw_fw_c2h_run(struct rtw_dev *rtwdev, struct sk_buff *skb,
+			   u8 class)
+{
+	struct rtw_c2h_cmd *c2h = get_c2h_from_skb(skb);
+	u8 len = skb->len - rtw_c2h_cb(skb)->pkt_offset - 2;
+	const struct rtw_c2h_handler *handler;
+
+	handler = rtw_fw_c2h_lookup(c2h, len);
+	rtw_fw_c2h_account(rtwdev, skb, c2h, len, class, handler);
+
+	if (!handler) {
+		rtw_dbg(rtwdev, RTW_DBG_FW,
+			"C2H_DEBUG: unhandled C2H id=0x%02x seq=0x%02x len=%d\n",
+			c2h->id, c2h->seq, len);
+		dev_kfree_skb_any(skb);
+		return;
+	}
+
+	handler->handle(rtwdev, skb, c2h, len);
+	if (!handler->own_skb)
+		dev_kfree_skb_any(skb);
+}
+
+/* c2h_work context, any C2H may end up here */
+void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb)
+{
+	mutex_lock(&rtwdev->mutex);
+
+	if (test_bit(RTW_FLAG_RUNNING, rtwdev->flags))
+		rtw_fw_c2h_run(rtwdev, skb, RTW_C2H_CLASS_WORK);
+	else
+		dev_kfree_skb_any(skb);
+
 	mutex_unlock(&rtwdev->mutex);
 }
 
+void rtw_fw_c2h_cmd_handle_hipri(struct rtw_dev *rtwdev, struct sk_buff *skb)
+{
+	if (test_bit(RTW_FLAG_RUNNING, rtwdev->flags))
+		rtw_fw_c2h_run(rtwdev, skb, RTW_C2H_CLASS_HIPRI);
+	else
+		dev_kfree_skb_any(skb);
+}
+
 void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
 			       struct sk_buff *skb)
 {
+	const struct rtw_c2h_handler *handler;
 	struct rtw_c2h_cmd *c2h;
+	u8 class;
 	u8 len;
 
 	c2h = (struct rtw_c2h_cmd *)(skb->data + pkt_offset);
 	len = skb->len - pkt_offset - 2;
-	*((u32 *)skb->cb) = pkt_offset;
+	rtw_c2h_cb(skb)->pkt_offset = pkt_offset;
+	rtw_c2h_cb(skb)->rx_time = ktime_get();
 
 	rtw_dbg(rtwdev, RTW_DBG_FW, "recv C2H, id=0x%02x, seq=0x%02x, len=%d\n",
 		c2h->id, c2h->seq, len);
@@ -387,33 +544,24 @@ void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
 			 c2h->id, c2h->seq, len, min_t(int, len, 8),
 			 c2h->payload);
 
-	switch (c2h->id) {
-	case C2H_BT_MP_INFO:
-		rtw_coex_info_response(rtwdev, skb);
-		break;
-	case C2H_WLAN_RFON:
-		/* On 8723B SDIO with v41 firmware, C2H 0x32 carries a
-		 * scan TX report, not a WLAN_RFON event.  Route it to
-		 * the deferred queue for rtw_fw_c2h_cmd_handle().
+	handler = rtw_fw_c2h_lookup(c2h, len);
+	class = handler ? handler->class : RTW_C2H_CLASS_WORK;
+
+	switch (class) {
+	case RTW_C2H_CLASS_ATOMIC:
+		/* same as the deferred classes, nothing to report to once
+		 * the core stopped
 		 */
-		if (rtwdev->chip->id == RTW_CHIP_TYPE_8723B &&
-		    rtw_hci_type(rtwdev) == RTW_HCI_TYPE_SDIO) {
-			*((u32 *)skb->cb) = pkt_offset;
-			skb_queue_tail(&rtwdev->c2h_queue, skb);
-			ieee80211_queue_work(rtwdev->hw, &rtwdev->c2h_work);
-			break;
-		}
-		complete(&rtwdev->lps_leave_check);
-		dev_kfree_skb_any(skb);
+		if (test_bit(RTW_FLAG_RUNNING, rtwdev->flags))
+			rtw_fw_c2h_run(rtwdev, skb, class);
+		else
+			dev_kfree_skb_any(skb);
 		break;
-	case C2H_SCAN_RESULT:
-		complete(&rtwdev->fw_scan_density);
-		rtw_fw_scan_result(rtwdev, c2h->payload, len);
-		dev_kfree_skb_any(skb);
+	case RTW_C2H_CLASS_HIPRI:
+		skb_queue_tail(&rtwdev->c2h_hipri_queue, skb);
+		queue_work(rtwdev->tx_wq, &rtwdev->c2h_hipri_work);
 		break;
 	default:
-		/* pass offset for further operation */
-		*((u32 *)skb->cb) = pkt_offset;
 		skb_queue_tail(&rtwdev->c2h_queue, skb);
 		ieee80211_queue_work(rtwdev->hw, &rtwdev->c2h_work);
 		break;
@@ -430,119 +578,239 @@ void rtw_fw_c2h_cmd_isr(struct rtw_dev *rtwdev)
 }
 EXPORT_SYMBOL(rtw_fw_c2h_cmd_isr);
 
-static void rtw_fw_send_h2c_command_register(struct rtw_dev *rtwdev,
-					     struct rtw_h2c_register *h2c)
+static const u32 rtw_h2c_box_reg[RTW_H2C_BOX_NUM][2] = {
+	{REG_HMEBOX0, REG_HMEBOX0_EX},
+	{REG_HMEBOX1, REG_HMEBOX1_EX},
+	{REG_HMEBOX2, REG_HMEBOX2_EX},
+	{REG_HMEBOX3, REG_HMEBOX3_EX},
+};
+
+void rtw_fw_h2c_reset(struct rtw_dev *rtwdev)
+{
+	rtwdev->h2c.last_box_num = 0;
+	/* unknown until the first HMETFR read */
+	rtwdev->h2c.box_busy = GENMASK(RTW_H2C_BOX_NUM - 1, 0);
+	rtwdev->h2c.queue_head = 0;
+	rtwdev->h2c.queue_len = 0;
+	rtwdev->h2c.seq = 0;
+	rtwdev->h2c.pkt_len = 0;
+}
+
+static void rtw_fw_h2c_account(struct rtw_dev *rtwdev, u8 cmd_id,
+			       ktime_t submit)
 {
+	struct rtw_h2c_stats *stats = &rtwdev->h2c.stats;
+	u32 us = (u32)ktime_us_delta(ktime_get(), submit);
+	struct rtw_h2c_lat *lat;
+	int i;
+
+	for (i = 0; i < RTW_H2C_LAT_NUM; i++) {
+		lat = &stats->lat[i];
+		if (lat->cnt && lat->cmd_id != cmd_id)
+			continue;
+
+		lat->cmd_id = cmd_id;
+		lat->cnt++;
+		lat->sum_us += us;
+		lat->max_us = max(lat->max_us, us);
+		return;
+	}
+}
 
-	u32 box_reg, box_ex_reg;
-	u8 box_state, box;
+/* Boxes only turn busy when we write them, so a box the cached bitmap
+ * reports free is free; HMETFR is read again only when the next box was
+ * still owned by the firmware last time we looked.
+ */
+static int rtw_fw_h2c_wait_box(struct rtw_dev *rtwdev, u8 box)
+{
+	struct rtw_h2c_stats *stats = &rtwdev->h2c.stats;
+	u8 box_state;
 	int ret;
 
-	rtw_dbg(rtwdev, RTW_DBG_FW, "send H2C content %08x %08x\n", h2c->w0,
-		h2c->w1);
+	if (!(rtwdev->h2c.box_busy & BIT(box)))
+		return 0;
 
-	lockdep_assert_held(&rtwdev->mutex);
+	box_state = rtw_read8(rtwdev, REG_HMETFR);
+	stats->hmetfr_reads++;
+	if (box_state & BIT(box)) {
+		stats->box_waits++;
+		ret = read_poll_timeout_atomic(rtw_read8, box_state,
+					       !(box_state & BIT(box)), 100,
+					       3000, false, rtwdev, REG_HMETFR);
+		if (ret)
+			return ret;
+	}
 
-	box = rtwdev->h2c.last_box_num;
-	switch (box) {
-	case 0:
-		box_reg = REG_HMEBOX0;
-		box_ex_reg = REG_HMEBOX0_EX;
-		break;
-	case 1:
-		box_reg = REG_HMEBOX1;
-		box_ex_reg = REG_HMEBOX1_EX;
-		break;
-	case 2:
-		box_reg = REG_HMEBOX2;
-		box_ex_reg = REG_HMEBOX2_EX;
-		break;
-	case 3:
-		box_reg = REG_HMEBOX3;
-		box_ex_reg = REG_HMEBOX3_EX;
-		break;
-	default:
+	rtwdev->h2c.box_busy = box_state & GENMASK(RTW_H2C_BOX_NUM - 1, 0);
+
+	return 0;
+}
+
+static int rtw_fw_h2c_write_box(struct rtw_dev *rtwdev, u32 w0, u32 w1,
+				ktime_t submit)
+{
+	u8 box = rtwdev->h2c.last_box_num;
+	int ret;
+
+	rtw_dbg(rtwdev, RTW_DBG_FW, "send H2C content %08x %08x\n", w0, w1);
+
+	if (box >= RTW_H2C_BOX_NUM) {
 		WARN(1, "invalid h2c mail box number\n");
-		return;
+		return -EINVAL;
 	}
 
-	ret = read_poll_timeout_atomic(rtw_read8, box_state,
-				       !((box_state >> box) & 0x1), 100, 3000,
-				       false, rtwdev, REG_HMETFR);
-
+	ret = rtw_fw_h2c_wait_box(rtwdev, box);
 	if (ret) {
+		rtwdev->h2c.stats.fail++;
 		rtw_err(rtwdev, "failed to send h2c command\n");
-		rtw_fw_dump_dbg_info(rtwdev);
-		return;
+		return ret;
 	}
 
-	rtw_write32(rtwdev, box_ex_reg, h2c->w1);
-	rtw_write32(rtwdev, box_reg, h2c->w0);
+	rtw_write32(rtwdev, rtw_h2c_box_reg[box][1], w1);
+	rtw_write32(rtwdev, rtw_h2c_box_reg[box][0], w0);
+	rtwdev->h2c.box_busy |= BIT(box);
 
-	if (++rtwdev->h2c.last_box_num >= 4)
+	rtw_fw_h2c_account(rtwdev, u32_get_bits(w0, RTW_H2C_W0_CMDID), submit);
+
+	if (++rtwdev->h2c.last_box_num >= RTW_H2C_BOX_NUM)
 		rtwdev->h2c.last_box_num = 0;
+
+	return 0;
 }
 
-static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
-				    u8 *h2c)
+void rtw_fw_h2c_flush(struct rtw_dev *rtwdev)
 {
-	u8 cmd_id = h2c[0] & 0xff;
-
-	rtw_dbg(rtwdev,
-		 RTW_DBG_FW, "H2C_DEBUG: send_h2c id=0x%02x raw=%02x %02x %02x %02x %02x %02x %02x %02x\n",
-		 cmd_id, h2c[0], h2c[1], h2c[2], h2c[3],
-		 h2c[4], h2c[5], h2c[6], h2c[7]);
+	struct rtw_h2c_entry *entry;
 
-	struct rtw_h2c_cmd *h2c_cmd = (struct rtw_h2c_cmd *)h2c;
-	u8 box;
-	u8 box_state;
-	u32 box_reg, box_ex_reg;
-	int ret;
+	lockdep_assert_held(&rtwdev->mutex);
 
-	rtw_dbg(rtwdev, RTW_DBG_FW,
-		"send H2C content %02x%02x%02x%02x %02x%02x%02x%02x\n",
-		h2c[3], h2c[2], h2c[1], h2c[0],
-		h2c[7], h2c[6], h2c[5], h2c[4]);
+	while (rtwdev->h2c.queue_len) {
+		entry = &rtwdev->h2c.queue[rtwdev->h2c.queue_head];
+		rtwdev->h2c.queue_head =
+			(rtwdev->h2c.queue_head + 1) % RTW_H2C_QUEUE_LEN;
+		rtwdev->h2c.queue_len--;
 
-	lockdep_assert_held(&rtwdev->mutex);
+		rtw_fw_h2c_write_box(rtwdev, entry->w0, entry->w1,
+				     entry->submit);
+	}
+}
 
-	box = rtwdev->h2c.last_box_num;
-	switch (box) {
-	case 0:
-		box_reg = REG_HMEBOX0;
-		box_ex_reg = REG_HMEBOX0_EX;
-		break;
-	case 1:
-		box_reg = REG_HMEBOX1;
-		box_ex_reg = REG_HMEBOX1_EX;
-		break;
-	case 2:
-		box_reg = REG_HMEBOX2;
-		box_ex_reg = REG_HMEBOX2_EX;
-		break;
-	case 3:
-		box_reg = REG_HMEBOX3;
-		box_ex_reg = REG_HMEBOX3_EX;
-		break;
+/* periodic per station state, only the latest value matters. 0x40 is
+ * also MACID_CFG (rtw_fw_macid_cfg()), and an RA_INFO that carries a new
+ * rate mask is a configuration as well, so only no_update refreshes of
+ * RA_INFO are merged.
+ */
+static bool rtw_fw_h2c_coalescable(u32 w0)
+{
+	switch (u32_get_bits(w0, RTW_H2C_W0_CMDID)) {
+	case H2C_CMD_RSSI_MONITOR:
+		return true;
+	case H2C_CMD_RA_INFO:
+		return w0 & RTW_H2C_W0_RA_NO_UPDATE;
 	default:
-		WARN(1, "invalid h2c mail box number\n");
+		return false;
+	}
+}
+
+static void rtw_fw_h2c_queue(struct rtw_dev *rtwdev, u32 w0, u32 w1)
+{
+	struct rtw_h2c_stats *stats = &rtwdev->h2c.stats;
+	struct rtw_h2c_entry *entry;
+	u8 i, idx;
+
+	for (i = 0; i < rtwdev->h2c.queue_len; i++) {
+		idx = (rtwdev->h2c.queue_head + i) % RTW_H2C_QUEUE_LEN;
+		entry = &rtwdev->h2c.queue[idx];
+
+		if (u32_get_bits(entry->w0, RTW_H2C_W0_CMDID) !=
+		    u32_get_bits(w0, RTW_H2C_W0_CMDID) ||
+		    u32_get_bits(entry->w0, RTW_H2C_W0_MACID) !=
+		    u32_get_bits(w0, RTW_H2C_W0_MACID))
+			continue;
+
+		entry->w0 = w0;
+		entry->w1 = w1;
+		stats->coalesced++;
 		return;
 	}
 
-	ret = read_poll_timeout_atomic(rtw_read8, box_state,
-				       !((box_state >> box) & 0x1), 100, 3000,
-				       false, rtwdev, REG_HMETFR);
+	if (rtwdev->h2c.queue_len == RTW_H2C_QUEUE_LEN)
+		rtw_fw_h2c_flush(rtwdev);
 
-	if (ret) {
-		rtw_err(rtwdev, "failed to send h2c command\n");
+	idx = (rtwdev->h2c.queue_head + rtwdev->h2c.queue_len) %
+	      RTW_H2C_QUEUE_LEN;
+	entry = &rtwdev->h2c.queue[idx];
+	entry->w0 = w0;
+	entry->w1 = w1;
+	entry->submit = ktime_get();
+
+	rtwdev->h2c.queue_len++;
+	stats->queued++;
+	stats->max_depth = max_t(u32, stats->max_depth, rtwdev->h2c.queue_len);
+
+	ieee80211_queue_work(rtwdev->hw, &rtwdev->h2c.work);
+}
+
+static void rtw_fw_h2c_pkt_write(struct rtw_dev *rtwdev, u8 *buf, u32 len)
+{
+	if (rtw_hci_write_data_h2c(rtwdev, buf, len))
+		rtw_err(rtwdev, "failed to send h2c packet\n");
+
+	rtwdev->h2c.stats.pkt_sent += len / H2C_PKT_SIZE;
+	rtwdev->h2c.stats.pkt_xfers++;
+}
+
+void rtw_fw_h2c_pkt_flush(struct rtw_dev *rtwdev,
+			  enum rtw_h2c_pkt_flush reason)
+{
+	lockdep_assert_held(&rtwdev->mutex);
+
+	if (!rtwdev->h2c.pkt_len)
 		return;
+
+	rtw_fw_h2c_pkt_write(rtwdev, rtwdev->h2c.pkt_buf, rtwdev->h2c.pkt_len);
+	rtwdev->h2c.pkt_len = 0;
+	rtwdev->h2c.stats.pkt_flush[reason]++;
+}
+
+/* hand everything submitted so far to the firmware */
+void rtw_fw_h2c_barrier(struct rtw_dev *rtwdev)
+{
+	rtw_fw_h2c_flush(rtwdev);
+	rtw_fw_h2c_pkt_flush(rtwdev, RTW_H2C_PKT_FLUSH_BARRIER);
+}
+
+static int rtw_fw_h2c_submit(struct rtw_dev *rtwdev, u32 w0, u32 w1)
+{
+	lockdep_assert_held(&rtwdev->mutex);
+
+	if (rtw_fw_h2c_coalescable(w0)) {
+		rtw_fw_h2c_queue(rtwdev, w0, w1);
+		return 0;
 	}
 
-	rtw_write32(rtwdev, box_ex_reg, le32_to_cpu(h2c_cmd->msg_ext));
-	rtw_write32(rtwdev, box_reg, le32_to_cpu(h2c_cmd->msg));
+	/* anything else keeps its place behind the queued commands */
+	rtw_fw_h2c_flush(rtwdev);
+	rtw_fw_h2c_pkt_flush(rtwdev, RTW_H2C_PKT_FLUSH_BARRIER);
+	rtwdev->h2c.stats.direct++;
 
-	if (++rtwdev->h2c.last_box_num >= 4)
-		rtwdev->h2c.last_box_num = 0;
+	return rtw_fw_h2c_write_box(rtwdev, w0, w1, ktime_get());
+}
+
+static void rtw_fw_send_h2c_command_register(struct rtw_dev *rtwdev,
+					     struct rtw_h2c_register *h2c)
+{
+	if (rtw_fw_h2c_submit(rtwdev, h2c->w0, h2c->w1))
+		rtw_fw_dump_dbg_info(rtwdev);
+}
+
+static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
+				    u8 *h2c)
+{
+	struct rtw_h2c_cmd *h2c_cmd = (struct rtw_h2c_cmd *)h2c;
+
+	rtw_fw_h2c_submit(rtwdev, le32_to_cpu(h2c_cmd->msg),
+			  le32_to_cpu(h2c_cmd->msg_ext));
 }
 
 void rtw_fw_h2c_cmd_dbg(struct rtw_dev *rtwdev, u8 *h2c)
@@ -552,15 +820,30 @@ void rtw_fw_h2c_cmd_dbg(struct rtw_dev *rtwdev, u8 *h2c)
 
 static void rtw_fw_send_h2c_packet(struct rtw_dev *rtwdev, u8 *h2c_pkt)
 {
-	int ret;
-
 	lockdep_assert_held(&rtwdev->mutex);
 
+	rtw_fw_h2c_flush(rtwdev);
+
 	FW_OFFLOAD_H2C_SET_SEQ_NUM(h2c_pkt, rtwdev->h2c.seq);
-	ret = rtw_hci_write_data_h2c(rtwdev, h2c_pkt, H2C_PKT_SIZE);
-	if (ret)
-		rtw_err(rtwdev, "failed to send h2c packet\n");
 	rtwdev->h2c.seq++;
+
+	if (!rtw_h2c_pkt_batch) {
+		rtw_fw_h2c_pkt_flush(rtwdev, RTW_H2C_PKT_FLUSH_BARRIER);
+		rtw_fw_h2c_pkt_write(rtwdev, h2c_pkt, H2C_PKT_SIZE);
+		return;
+	}
+
+	BUILD_BUG_ON(RTW_H2C_PKT_BATCH_SIZE % H2C_PKT_SIZE);
+
+	memcpy(rtwdev->h2c.pkt_buf + rtwdev->h2c.pkt_len, h2c_pkt,
+	       H2C_PKT_SIZE);
+	rtwdev->h2c.pkt_len += H2C_PKT_SIZE;
+
+	if (rtwdev->h2c.pkt_len == RTW_H2C_PKT_BATCH_SIZE)
+		rtw_fw_h2c_pkt_flush(rtwdev, RTW_H2C_PKT_FLUSH_SIZE);
+	else if (rtwdev->h2c.pkt_len == H2C_PKT_SIZE)
+		ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->h2c.pkt_work,
+					     msecs_to_jiffies(RTW_H2C_PKT_BATCH_DEADLINE_MS));
 }
 
 void
@@ -624,6 +907,8 @@ void rtw_fw_do_iqk(struct rtw_dev *rtwdev, struct rtw_iqk_para *para)
 	IQK_SET_SEGMENT_IQK(h2c_pkt, para->segment_iqk);
 
 	rtw_fw_send_h2c_packet(rtwdev, h2c_pkt);
+	/* callers poll for the result right away */
+	rtw_fw_h2c_barrier(rtwdev);
 }
 EXPORT_SYMBOL(rtw_fw_do_iqk);
 
@@ -658,7 +943,7 @@ void rtw_fw_default_port(struct rtw_dev *rtwdev, struct rtw_vif *rtwvif)
 		return;
 
 	/* Leave LPS before default port H2C so FW timer is correct */
-	rtw_leave_lps(rtwdev);
+	rtw_leave_lps_sync(rtwdev);
 
 	h2c.w0 = u32_encode_bits(H2C_CMD_DEFAULT_PORT, RTW_H2C_W0_CMDID) |
 		 u32_encode_bits(rtwvif->port, RTW_H2C_DEFAULT_PORT_W0_PORTID) |
@@ -2330,6 +2615,7 @@ void rtw_fw_channel_switch(struct rtw_dev *rtwdev, bool enable)
 	CH_SWITCH_SET_INFO_LOC(h2c_pkt, loc_ch_info);
 
 	rtw_fw_send_h2c_packet(rtwdev, h2c_pkt);
+	rtw_fw_h2c_barrier(rtwdev);
 }
 
 void rtw_fw_adaptivity(struct rtw_dev *rtwdev)
@@ -2595,6 +2881,8 @@ static void rtw_fw_set_scan_offload(struct rtw_dev *rtwdev,
 	SCAN_OFFLOAD_SET_PKT_LOC(h2c_pkt, pkt_loc);
 
 	rtw_fw_send_h2c_packet(rtwdev, h2c_pkt);
+	/* probe request updates and the scan start go out together */
+	rtw_fw_h2c_barrier(rtwdev);
 }
 
 void rtw_hw_scan_start(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
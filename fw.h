@@ -117,6 +117,13 @@ struct rtw_h2c_register {
 
 #define RTW_H2C_W0_CMDID		GENMASK(7, 0)
 
+/* H2C_CMD_RSSI_MONITOR and H2C_CMD_RA_INFO, in both the rtw88 and the
+ * 8723BS RA_INFO layout. MACID_CFG shares the RA_INFO id and the mac id
+ * byte but has no no_update bit, see rtw_fw_h2c_coalescable().
+ */
+#define RTW_H2C_W0_MACID		GENMASK(15, 8)
+#define RTW_H2C_W0_RA_NO_UPDATE		BIT(27)
+
 /* H2C_CMD_DEFAULT_PORT command */
 #define RTW_H2C_DEFAULT_PORT_W0_PORTID	GENMASK(15, 8)
 #define RTW_H2C_DEFAULT_PORT_W0_MACID	GENMASK(23, 16)
@@ -381,6 +388,9 @@ struct rtw_fw_hdr_legacy {
 /* C2H */
 #define GET_CCX_REPORT_SEQNUM_V0(c2h_payload)	(c2h_payload[6] & 0xfc)
 #define GET_CCX_REPORT_STATUS_V0(c2h_payload)	(c2h_payload[0] & 0xc0)
+#define GET_CCX_REPORT_MACID_V0(c2h_payload)	(c2h_payload[1] & 0x7f)
+#define GET_CCX_REPORT_RETRY_V0(c2h_payload)	(c2h_payload[2] & 0x3f)
+#define GET_CCX_REPORT_RATE_V0(c2h_payload)	(c2h_payload[5] & 0x7f)
 #define GET_CCX_REPORT_SEQNUM_V1(c2h_payload)	(c2h_payload[8] & 0xfc)
 #define GET_CCX_REPORT_STATUS_V1(c2h_payload)	(c2h_payload[9] & 0xc0)
 
@@ -822,6 +832,20 @@ static inline void rtw_h2c_pkt_set_header(u8 *h2c_pkt, u8 sub_id)
 
 #define RFK_SET_INFORM_START(h2c_pkt, value)				\
 	le32p_replace_bits((__le32 *)(h2c_pkt) + 0x00, value, BIT(8))
+
+/* skb->cb of a received C2H, pkt_offset must stay first */
+struct rtw_c2h_cb {
+	u32 pkt_offset;
+	ktime_t rx_time;
+};
+
+static inline struct rtw_c2h_cb *rtw_c2h_cb(struct sk_buff *skb)
+{
+	BUILD_BUG_ON(sizeof(struct rtw_c2h_cb) > sizeof(skb->cb));
+
+	return (struct rtw_c2h_cb *)skb->cb;
+}
+
 static inline struct rtw_c2h_cmd *get_c2h_from_skb(struct sk_buff *skb)
 {
 	u32 pkt_offset;
@@ -846,6 +870,7 @@ void rtw_fw_dump_dbg_info(struct rtw_dev *rtwdev);
 void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
 			       struct sk_buff *skb);
 void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb);
+void rtw_fw_c2h_cmd_handle_hipri(struct rtw_dev *rtwdev, struct sk_buff *skb);
 void rtw_fw_send_general_info(struct rtw_dev *rtwdev);
 void rtw_fw_send_phydm_info(struct rtw_dev *rtwdev);
 void rtw_fw_default_port(struct rtw_dev *rtwdev, struct rtw_vif *rtwvif);
@@ -911,6 +936,11 @@ void rtw_fw_update_pkt_probe_req(struct rtw_dev *rtwdev,
 				 struct cfg80211_ssid *ssid);
 void rtw_fw_channel_switch(struct rtw_dev *rtwdev, bool enable);
 void rtw_fw_h2c_cmd_dbg(struct rtw_dev *rtwdev, u8 *h2c);
+void rtw_fw_h2c_flush(struct rtw_dev *rtwdev);
+void rtw_fw_h2c_pkt_flush(struct rtw_dev *rtwdev,
+			  enum rtw_h2c_pkt_flush reason);
+void rtw_fw_h2c_barrier(struct rtw_dev *rtwdev);
+void rtw_fw_h2c_reset(struct rtw_dev *rtwdev);
 void rtw_fw_c2h_cmd_isr(struct rtw_dev *rtwdev);
 int rtw_fw_dump_fifo(struct rtw_dev *rtwdev, u8 fifo_sel, u32 addr, u32 size,
 		     u32 *buffer);
@@ -10,6 +10,12 @@ struct rtw_hci_ops {
 	int (*tx_write)(struct rtw_dev *rtwdev,
 			struct rtw_tx_pkt_info *pkt_info,
 			struct sk_buff *skb);
+	/* optional, returns the number of frames taken from the head of
+	 * the batch, the caller frees the rest
+	 */
+	int (*tx_write_batch)(struct rtw_dev *rtwdev,
+			      enum rtw_tx_queue_type queue,
+			      struct rtw_tx_batch *batch);
 	void (*tx_kick_off)(struct rtw_dev *rtwdev);
 	void (*flush_queues)(struct rtw_dev *rtwdev, u32 queues, bool drop);
 	int (*setup)(struct rtw_dev *rtwdev);
@@ -40,6 +46,27 @@ static inline int rtw_hci_tx_write(struct rtw_dev *rtwdev,
 	return rtwdev->hci.ops->tx_write(rtwdev, pkt_info, skb);
 }
 
+static inline int rtw_hci_tx_write_batch(struct rtw_dev *rtwdev,
+					 enum rtw_tx_queue_type queue,
+					 struct rtw_tx_batch *batch)
+{
+	struct sk_buff *skb;
+	int ret;
+	int i;
+
+	if (rtwdev->hci.ops->tx_write_batch)
+		return rtwdev->hci.ops->tx_write_batch(rtwdev, queue, batch);
+
+	for (i = 0; i < batch->num; i++) {
+		skb = batch->skbs[i];
+		ret = rtwdev->hci.ops->tx_write(rtwdev, &batch->pkt_info[i], skb);
+		if (ret)
+			return i ? i : ret;
+	}
+
+	return batch->num;
+}
+
 static inline void rtw_hci_tx_kick_off(struct rtw_dev *rtwdev)
 {
 	return rtwdev->hci.ops->tx_kick_off(rtwdev);
@@ -84,48 +111,57 @@ static inline void rtw_hci_dynamic_rx_agg(struct rtw_dev *rtwdev, bool enable)
 static inline void rtw_hci_write_firmware_page(struct rtw_dev *rtwdev, u32 page,
 					       const u8 *data, u32 size)
 {
+	rtwdev->hci.xfers++;
 	rtwdev->hci.ops->write_firmware_page(rtwdev, page, data, size);
 }
 
 static inline int
 rtw_hci_write_data_rsvd_page(struct rtw_dev *rtwdev, u8 *buf, u32 size)
 {
+	rtwdev->hci.xfers++;
 	return rtwdev->hci.ops->write_data_rsvd_page(rtwdev, buf, size);
 }
 
 static inline int
 rtw_hci_write_data_h2c(struct rtw_dev *rtwdev, u8 *buf, u32 size)
 {
+	rtwdev->hci.xfers++;
 	return rtwdev->hci.ops->write_data_h2c(rtwdev, buf, size);
 }
 
 static inline u8 rtw_read8(struct rtw_dev *rtwdev, u32 addr)
 {
+	rtwdev->hci.reads++;
 	return rtwdev->hci.ops->read8(rtwdev, addr);
 }
 
 static inline u16 rtw_read16(struct rtw_dev *rtwdev, u32 addr)
 {
+	rtwdev->hci.reads++;
 	return rtwdev->hci.ops->read16(rtwdev, addr);
 }
 
 static inline u32 rtw_read32(struct rtw_dev *rtwdev, u32 addr)
 {
+	rtwdev->hci.reads++;
 	return rtwdev->hci.ops->read32(rtwdev, addr);
 }
 
 static inline void rtw_write8(struct rtw_dev *rtwdev, u32 addr, u8 val)
 {
+	rtwdev->hci.writes++;
 	rtwdev->hci.ops->write8(rtwdev, addr, val);
 }
 
 static inline void rtw_write16(struct rtw_dev *rtwdev, u32 addr, u16 val)
 {
+	rtwdev->hci.writes++;
 	rtwdev->hci.ops->write16(rtwdev, addr, val);
 }
 
 static inline void rtw_write32(struct rtw_dev *rtwdev, u32 addr, u32 val)
 {
+	rtwdev->hci.writes++;
 	rtwdev->hci.ops->write32(rtwdev, addr, val);
 }
 
@@ -271,6 +307,12 @@ static inline enum rtw_hci_type rtw_hci_type(struct rtw_dev *rtwdev)
 	return rtwdev->hci.type;
 }
 
+static inline bool rtw_is_8723bs_sdio(struct rtw_dev *rtwdev)
+{
+	return rtwdev->chip->id == RTW_CHIP_TYPE_8723B &&
+	       rtw_hci_type(rtwdev) == RTW_HCI_TYPE_SDIO;
+}
+
 static inline void rtw_hci_flush_queues(struct rtw_dev *rtwdev, u32 queues,
 					bool drop)
 {
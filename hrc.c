@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#include "main.h"
+#include "hrc.h"
+#include "debug.h"
+
+/* hrc_alg.c indexes its tables by DESC_RATE */
+static_assert(RTW_HRC_RATE_NUM == DESC_RATEMCS15 + 1);
+
+/* Only the 8723BS firmware reports are matched by sequence number and
+ * carry the mac id, retry count and final rate the algorithm needs. Chips
+ * matching reports to the oldest pending frame would mix the extra reports
+ * up with the frames mac80211 waits for.
+ */
+bool rtw_hrc_supported(struct rtw_dev *rtwdev)
+{
+	return rtwdev->chip->id == RTW_CHIP_TYPE_8723B &&
+	       rtw_hci_type(rtwdev) == RTW_HCI_TYPE_SDIO;
+}
+
+bool rtw_hrc_active(struct rtw_dev *rtwdev)
+{
+	return READ_ONCE(rtwdev->host_rc) && rtw_hrc_supported(rtwdev);
+}
+
+static u32 rtw_hrc_now(void)
+{
+	return jiffies_to_msecs(jiffies);
+}
+
+void rtw_hrc_sta_update(struct rtw_dev *rtwdev, struct rtw_sta_info *si)
+{
+	unsigned long flags;
+	u32 rate_mask;
+
+	/* VHT masks index rates differently, leave them to the firmware */
+	rate_mask = si->vht_enable ? 0 : si->ra_mask;
+
+	spin_lock_irqsave(&si->hrc_lock, flags);
+	if (rate_mask != si->hrc.rate_mask)
+		rtw_hrc_set_rates(&si->hrc, rate_mask, rtw_hrc_now());
+	spin_unlock_irqrestore(&si->hrc_lock, flags);
+}
+
+bool rtw_hrc_tx_rate(struct rtw_dev *rtwdev, struct rtw_sta_info *si,
+		     u8 *rate, bool *report)
+{
+	unsigned long flags;
+	bool sample;
+
+	if (!rtw_hrc_active(rtwdev))
+		return false;
+
+	spin_lock_irqsave(&si->hrc_lock, flags);
+	if (!si->hrc.rate_mask) {
+		spin_unlock_irqrestore(&si->hrc_lock, flags);
+		return false;
+	}
+	*rate = rtw_hrc_next_rate(&si->hrc, &sample, report);
+	spin_unlock_irqrestore(&si->hrc_lock, flags);
+
+	return true;
+}
+
+struct rtw_hrc_iter_data {
+	u8 mac_id;
+	u8 rate;
+	u8 retries;
+	bool acked;
+	bool fed;
+};
+
+static void rtw_hrc_report_iter(void *data, struct ieee80211_sta *sta)
+{
+	struct rtw_hrc_iter_data *iter_data = data;
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+	unsigned long flags;
+
+	if (si->mac_id != iter_data->mac_id)
+		return;
+
+	spin_lock_irqsave(&si->hrc_lock, flags);
+	if (si->hrc.rate_mask) {
+		rtw_hrc_feed(&si->hrc, iter_data->rate, iter_data->retries,
+			     iter_data->acked, rtw_hrc_now());
+		iter_data->fed = true;
+	}
+	spin_unlock_irqrestore(&si->hrc_lock, flags);
+}
+
+bool rtw_hrc_tx_report(struct rtw_dev *rtwdev, u8 mac_id, u8 rate,
+		       u8 retries, bool acked)
+{
+	struct rtw_hrc_iter_data iter_data = {
+		.mac_id = mac_id,
+		.rate = rate,
+		.retries = retries,
+		.acked = acked,
+	};
+
+	if (!rtw_hrc_active(rtwdev))
+		return false;
+
+	rtw_iterate_stas_atomic(rtwdev, rtw_hrc_report_iter, &iter_data);
+
+	rtw_dbg(rtwdev, RTW_DBG_TX,
+		"host rc: macid %u rate 0x%02x retry %u %s%s\n", mac_id, rate,
+		retries, acked ? "acked" : "failed",
+		iter_data.fed ? "" : " (no station)");
+
+	return iter_data.fed;
+}
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause */
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#ifndef __RTW_HRC_H_
+#define __RTW_HRC_H_
+
+bool rtw_hrc_supported(struct rtw_dev *rtwdev);
+bool rtw_hrc_active(struct rtw_dev *rtwdev);
+void rtw_hrc_sta_update(struct rtw_dev *rtwdev, struct rtw_sta_info *si);
+bool rtw_hrc_tx_rate(struct rtw_dev *rtwdev, struct rtw_sta_info *si,
+		     u8 *rate, bool *report);
+bool rtw_hrc_tx_report(struct rtw_dev *rtwdev, u8 mac_id, u8 rate,
+		       u8 retries, bool acked);
+
+#endif
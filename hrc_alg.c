@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#include <linux/bits.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include "hrc_alg.h"
+
+/* Host rate control, a reduced Minstrel. Every data frame to a station is
+ * sent at one forced rate without hardware fallback, and its TX report
+ * tells how many attempts it took at that rate. Each RTW_HRC_UPDATE_MS the
+ * attempts are folded into a per rate success EWMA, the rate with the best
+ * expected throughput is used from then on, and every
+ * RTW_HRC_SAMPLE_INTERVAL-th frame probes another rate that could beat it.
+ */
+
+/* nominal rate in 100 kbps, 20 MHz and long GI, only the order matters */
+static const u16 rtw_hrc_bitrate[RTW_HRC_RATE_NUM] = {
+	10, 20, 55, 110,
+	60, 90, 120, 180, 240, 360, 480, 540,
+	65, 130, 195, 260, 390, 520, 585, 650,
+	130, 260, 390, 520, 780, 1040, 1170, 1300,
+};
+
+/* the first rate used before any statistics exist */
+#define RTW_HRC_START_BITRATE	260
+
+static bool rtw_hrc_has_rate(const struct rtw_hrc *hrc, u8 rate)
+{
+	return rate < RTW_HRC_RATE_NUM && (hrc->rate_mask & BIT(rate));
+}
+
+static bool rtw_hrc_expired(u32 now_ms, u32 deadline_ms)
+{
+	return (s32)(now_ms - deadline_ms) >= 0;
+}
+
+u32 rtw_hrc_tp(const struct rtw_hrc *hrc, u8 rate)
+{
+	const struct rtw_hrc_rate *r = &hrc->rates[rate];
+
+	/* below 10% the rate only burns airtime */
+	if (!r->sampled || r->prob < RTW_HRC_PROB_SCALE / 10)
+		return 0;
+
+	return r->prob * rtw_hrc_bitrate[rate];
+}
+
+static u8 rtw_hrc_start_rate(const struct rtw_hrc *hrc)
+{
+	u8 start = RTW_HRC_RATE_NUM;
+	u8 i;
+
+	for (i = 0; i < RTW_HRC_RATE_NUM; i++) {
+		if (!rtw_hrc_has_rate(hrc, i))
+			continue;
+		if (start == RTW_HRC_RATE_NUM ||
+		    (rtw_hrc_bitrate[i] <= RTW_HRC_START_BITRATE &&
+		     rtw_hrc_bitrate[i] > rtw_hrc_bitrate[start]))
+			start = i;
+	}
+
+	return start;
+}
+
+void rtw_hrc_set_rates(struct rtw_hrc *hrc, u32 rate_mask, u32 now_ms)
+{
+	u32 dropped;
+	u8 i;
+
+	rate_mask &= GENMASK(RTW_HRC_RATE_NUM - 1, 0);
+	dropped = hrc->rate_mask & ~rate_mask;
+	for (i = 0; i < RTW_HRC_RATE_NUM; i++)
+		if (dropped & BIT(i))
+			memset(&hrc->rates[i], 0, sizeof(hrc->rates[i]));
+
+	hrc->rate_mask = rate_mask;
+	if (!rate_mask)
+		return;
+
+	if (!rtw_hrc_has_rate(hrc, hrc->max_tp_rate))
+		hrc->max_tp_rate = rtw_hrc_start_rate(hrc);
+	if (!rtw_hrc_has_rate(hrc, hrc->max_prob_rate))
+		hrc->max_prob_rate = hrc->max_tp_rate;
+
+	rtw_hrc_update(hrc, now_ms);
+}
+
+void rtw_hrc_init(struct rtw_hrc *hrc, u32 rate_mask, u32 now_ms)
+{
+	memset(hrc, 0, sizeof(*hrc));
+	hrc->max_tp_rate = RTW_HRC_RATE_NUM;
+	hrc->max_prob_rate = RTW_HRC_RATE_NUM;
+	rtw_hrc_set_rates(hrc, rate_mask, now_ms);
+}
+
+void rtw_hrc_update(struct rtw_hrc *hrc, u32 now_ms)
+{
+	struct rtw_hrc_rate *r;
+	u32 best_tp, tp, cur;
+	u8 best_prob = RTW_HRC_RATE_NUM;
+	u8 i;
+
+	for (i = 0; i < RTW_HRC_RATE_NUM; i++) {
+		r = &hrc->rates[i];
+		if (!rtw_hrc_has_rate(hrc, i) || !r->att)
+			continue;
+
+		cur = r->succ * RTW_HRC_PROB_SCALE / r->att;
+		if (r->sampled)
+			r->prob = (r->prob * (100 - RTW_HRC_EWMA_NEW) +
+				   cur * RTW_HRC_EWMA_NEW) / 100;
+		else
+			r->prob = cur;
+		r->sampled = true;
+		r->att = 0;
+		r->succ = 0;
+	}
+
+	best_tp = rtw_hrc_tp(hrc, hrc->max_tp_rate);
+	for (i = 0; i < RTW_HRC_RATE_NUM; i++) {
+		if (!rtw_hrc_has_rate(hrc, i) || !hrc->rates[i].sampled)
+			continue;
+
+		tp = rtw_hrc_tp(hrc, i);
+		if (tp > best_tp) {
+			best_tp = tp;
+			hrc->max_tp_rate = i;
+		}
+
+		/* the fastest rate that almost always gets through */
+		if (best_prob == RTW_HRC_RATE_NUM ||
+		    hrc->rates[i].prob > hrc->rates[best_prob].prob ||
+		    (hrc->rates[i].prob >= RTW_HRC_PROB_SCALE * 95 / 100 &&
+		     rtw_hrc_bitrate[i] > rtw_hrc_bitrate[best_prob]))
+			best_prob = i;
+	}
+
+	if (best_prob != RTW_HRC_RATE_NUM)
+		hrc->max_prob_rate = best_prob;
+
+	/* nothing has a usable throughput, fall back to the safest rate */
+	if (!best_tp && best_prob != RTW_HRC_RATE_NUM)
+		hrc->max_tp_rate = best_prob;
+
+	hrc->fail_streak = 0;
+	hrc->next_update = now_ms + RTW_HRC_UPDATE_MS;
+	hrc->updates++;
+}
+
+/* Walk the rates round robin and pick one that could beat the best
+ * expected throughput if it got every frame through.
+ */
+static u8 rtw_hrc_sample_rate(struct rtw_hrc *hrc)
+{
+	u32 best_tp = rtw_hrc_tp(hrc, hrc->max_tp_rate);
+	u8 rate;
+	u8 i;
+
+	for (i = 0; i < RTW_HRC_RATE_NUM; i++) {
+		rate = hrc->sample_cursor;
+		hrc->sample_cursor = (rate + 1) % RTW_HRC_RATE_NUM;
+
+		if (!rtw_hrc_has_rate(hrc, rate) || rate == hrc->max_tp_rate)
+			continue;
+		if (rtw_hrc_bitrate[rate] * RTW_HRC_PROB_SCALE <= best_tp)
+			continue;
+
+		return rate;
+	}
+
+	return hrc->max_tp_rate;
+}
+
+u8 rtw_hrc_next_rate(struct rtw_hrc *hrc, bool *sample, bool *report)
+{
+	u8 rate;
+
+	hrc->frames++;
+	*sample = false;
+	*report = !(hrc->frames % RTW_HRC_REPORT_INTERVAL);
+
+	if (!(hrc->frames % RTW_HRC_SAMPLE_INTERVAL)) {
+		rate = rtw_hrc_sample_rate(hrc);
+		if (rate != hrc->max_tp_rate) {
+			hrc->samples++;
+			*sample = true;
+			*report = true;
+			return rate;
+		}
+	}
+
+	return hrc->max_tp_rate;
+}
+
+void rtw_hrc_feed(struct rtw_hrc *hrc, u8 rate, u8 retries, bool acked,
+		  u32 now_ms)
+{
+	struct rtw_hrc_rate *r;
+	u16 att = retries + 1;
+
+	if (!rtw_hrc_has_rate(hrc, rate)) {
+		hrc->stray++;
+		return;
+	}
+
+	r = &hrc->rates[rate];
+	if (r->att > U16_MAX - att) {
+		r->att /= 2;
+		r->succ /= 2;
+	}
+	r->att += att;
+	r->succ += acked;
+	r->att_total += att;
+	r->succ_total += acked;
+
+	if (rate == hrc->max_tp_rate)
+		hrc->fail_streak = acked ? 0 : hrc->fail_streak + 1;
+
+	if (hrc->fail_streak >= RTW_HRC_FAIL_STREAK ||
+	    rtw_hrc_expired(now_ms, hrc->next_update))
+		rtw_hrc_update(hrc, now_ms);
+}
+
+#ifdef CONFIG_RTW88_KUNIT_TEST
+#include "hrc_alg_test.c"
+#endif
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause */
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#ifndef __RTW_HRC_ALG_H_
+#define __RTW_HRC_ALG_H_
+
+#include <linux/types.h>
+
+/* CCK, OFDM and HT MCS0-15, indexed by DESC_RATE */
+#define RTW_HRC_RATE_NUM		28
+
+/* statistics are folded into the success EWMA this often */
+#define RTW_HRC_UPDATE_MS		100
+/* every Nth frame of a station probes a rate other than the best one */
+#define RTW_HRC_SAMPLE_INTERVAL		16
+/* every Nth non-probing frame asks the firmware for a TX report */
+#define RTW_HRC_REPORT_INTERVAL		4
+/* failures in a row at the best rate that fold the statistics early */
+#define RTW_HRC_FAIL_STREAK		3
+
+#define RTW_HRC_PROB_SCALE		1024
+/* weight of the newest interval in the success EWMA, in percent */
+#define RTW_HRC_EWMA_NEW		25
+
+struct rtw_hrc_rate {
+	/* attempts and successes since the last update */
+	u16 att;
+	u16 succ;
+	/* success probability EWMA in 1/RTW_HRC_PROB_SCALE, once sampled */
+	u16 prob;
+	bool sampled;
+	u32 att_total;
+	u32 succ_total;
+};
+
+/* host rate control of one station, see hrc_alg.c */
+struct rtw_hrc {
+	u32 rate_mask;
+	u8 max_tp_rate;
+	u8 max_prob_rate;
+	u8 sample_cursor;
+	u8 fail_streak;
+	u32 frames;
+	u32 next_update;
+	u32 updates;
+	u32 samples;
+	u32 stray;
+	struct rtw_hrc_rate rates[RTW_HRC_RATE_NUM];
+};
+
+/* The algorithm below only works on struct rtw_hrc and plain numbers, the
+ * caller provides locking and the time, so that recorded TX report streams
+ * can be replayed through it outside of the driver.
+ */
+void rtw_hrc_init(struct rtw_hrc *hrc, u32 rate_mask, u32 now_ms);
+void rtw_hrc_set_rates(struct rtw_hrc *hrc, u32 rate_mask, u32 now_ms);
+u8 rtw_hrc_next_rate(struct rtw_hrc *hrc, bool *sample, bool *report);
+void rtw_hrc_feed(struct rtw_hrc *hrc, u8 rate, u8 retries, bool acked,
+		  u32 now_ms);
+void rtw_hrc_update(struct rtw_hrc *hrc, u32 now_ms);
+u32 rtw_hrc_tp(const struct rtw_hrc *hrc, u8 rate);
+
+#endif
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#include <kunit/test.h>
+
+/* DESC_RATE values, main.h stays out of the algorithm */
+#define HRC_TEST_1M		0x00
+#define HRC_TEST_54M		0x0b
+#define HRC_TEST_MCS0		0x0c
+#define HRC_TEST_MCS3		0x0f
+#define HRC_TEST_MCS5		0x11
+#define HRC_TEST_MCS7		0x13
+
+/* CCK, OFDM and HT MCS0-7 */
+#define HRC_TEST_RATE_MASK	GENMASK(HRC_TEST_MCS7, HRC_TEST_1M)
+
+struct hrc_test_report {
+	u16 ms;
+	u8 rate;
+	u8 retries;
+	u8 acked;
+};
+
+/* TX reports as rtw_hrc_tx_report() logs them, one every fourth frame,
+ * of a 1x1 link where MCS7 barely gets through, MCS6 and 54M lose more
+ * than half of the attempts and MCS5 and 48M about one in seven. A
+ * failed frame is reported with the last retry. A stream captured from
+ * the debug log replays the same way.
+ */
+static const struct hrc_test_report hrc_test_stream[] = {
+	{20, 0x0f, 0, 1}, {40, 0x0f, 0, 1}, {60, 0x0f, 0, 1},
+	{80, 0x00, 0, 1}, {100, 0x0f, 0, 1}, {120, 0x0f, 0, 1},
+	{140, 0x0f, 0, 1}, {160, 0x09, 0, 1}, {180, 0x0f, 0, 1},
+	{200, 0x0f, 0, 1}, {220, 0x09, 0, 1}, {240, 0x0a, 0, 1},
+	{260, 0x09, 0, 1}, {280, 0x09, 0, 1}, {300, 0x09, 0, 1},
+	{320, 0x0b, 0, 1}, {340, 0x0a, 0, 1}, {360, 0x0a, 0, 1},
+	{380, 0x0a, 0, 1}, {400, 0x11, 0, 1}, {420, 0x0b, 0, 1},
+	{440, 0x0b, 2, 1}, {460, 0x0b, 2, 1}, {480, 0x12, 0, 1},
+	{500, 0x0b, 1, 1}, {520, 0x12, 3, 1}, {540, 0x12, 0, 1},
+	{560, 0x13, 3, 0}, {580, 0x12, 3, 0}, {600, 0x12, 2, 1},
+	{620, 0x11, 0, 1}, {640, 0x0b, 1, 1}, {660, 0x11, 0, 1},
+	{680, 0x11, 0, 1}, {700, 0x11, 1, 1}, {720, 0x12, 1, 1},
+	{740, 0x11, 0, 1}, {760, 0x11, 2, 1}, {780, 0x11, 0, 1},
+	{800, 0x13, 3, 0}, {820, 0x0a, 0, 1}, {840, 0x0a, 0, 1},
+	{860, 0x0a, 0, 1}, {880, 0x0b, 1, 1}, {900, 0x0a, 0, 1},
+	{920, 0x0a, 0, 1}, {940, 0x0a, 1, 1}, {960, 0x11, 0, 1},
+	{980, 0x0a, 0, 1}, {1000, 0x0a, 0, 1}, {1020, 0x11, 0, 1},
+	{1040, 0x12, 0, 1}, {1060, 0x11, 0, 1}, {1080, 0x11, 0, 1},
+	{1100, 0x11, 0, 1}, {1120, 0x13, 1, 1}, {1140, 0x11, 0, 1},
+	{1160, 0x11, 0, 1}, {1180, 0x11, 0, 1}, {1200, 0x0a, 0, 1},
+	{1220, 0x11, 0, 1}, {1240, 0x11, 0, 1}, {1260, 0x11, 0, 1},
+	{1280, 0x0b, 3, 0}, {1300, 0x11, 0, 1}, {1320, 0x11, 1, 1},
+	{1340, 0x11, 0, 1}, {1360, 0x12, 2, 1}, {1380, 0x11, 0, 1},
+	{1400, 0x11, 0, 1}, {1420, 0x11, 1, 1}, {1440, 0x13, 3, 0},
+	{1460, 0x11, 0, 1}, {1480, 0x11, 0, 1}, {1500, 0x11, 0, 1},
+	{1520, 0x0b, 1, 1}, {1540, 0x0a, 1, 1}, {1560, 0x0a, 0, 1},
+	{1580, 0x0a, 0, 1}, {1600, 0x11, 1, 1}, {1620, 0x0a, 0, 1},
+	{1640, 0x0a, 0, 1}, {1660, 0x0a, 0, 1}, {1680, 0x12, 3, 0},
+	{1700, 0x0a, 0, 1}, {1720, 0x0a, 0, 1}, {1740, 0x0a, 0, 1},
+	{1760, 0x13, 3, 1}, {1780, 0x0a, 0, 1}, {1800, 0x0a, 0, 1},
+	{1820, 0x0a, 1, 1}, {1840, 0x0b, 0, 1}, {1860, 0x0a, 0, 1},
+	{1880, 0x0a, 1, 1}, {1900, 0x0a, 1, 1}, {1920, 0x12, 1, 1},
+	{1940, 0x11, 0, 1}, {1960, 0x11, 0, 1}, {1980, 0x11, 0, 1},
+	{2000, 0x13, 3, 0},
+};
+
+static void hrc_test_replay(struct rtw_hrc *hrc)
+{
+	const struct hrc_test_report *rep;
+	int i;
+
+	rtw_hrc_init(hrc, HRC_TEST_RATE_MASK, 0);
+
+	for (i = 0; i < ARRAY_SIZE(hrc_test_stream); i++) {
+		rep = &hrc_test_stream[i];
+		rtw_hrc_feed(hrc, rep->rate, rep->retries, rep->acked,
+			     rep->ms);
+	}
+}
+
+static void rtw_hrc_test_replay(struct kunit *test)
+{
+	struct rtw_hrc *hrc;
+
+	hrc = kunit_kzalloc(test, sizeof(*hrc), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, hrc);
+
+	hrc_test_replay(hrc);
+
+	KUNIT_EXPECT_EQ(test, hrc->stray, 0);
+	KUNIT_EXPECT_EQ(test, hrc->max_tp_rate, HRC_TEST_MCS5);
+	KUNIT_EXPECT_LE(test, hrc->rates[HRC_TEST_MCS7].prob,
+			RTW_HRC_PROB_SCALE / 10);
+	KUNIT_EXPECT_LT(test, rtw_hrc_tp(hrc, HRC_TEST_MCS7),
+			rtw_hrc_tp(hrc, HRC_TEST_MCS5));
+	KUNIT_EXPECT_GE(test, hrc->rates[hrc->max_prob_rate].prob,
+			RTW_HRC_PROB_SCALE * 95 / 100);
+}
+
+static void rtw_hrc_test_fail_streak(struct kunit *test)
+{
+	const struct hrc_test_report *last;
+	struct rtw_hrc *hrc;
+	u32 updates;
+	int i;
+
+	hrc = kunit_kzalloc(test, sizeof(*hrc), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, hrc);
+
+	hrc_test_replay(hrc);
+	last = &hrc_test_stream[ARRAY_SIZE(hrc_test_stream) - 1];
+	updates = hrc->updates;
+
+	/* the best rate stops working before the next periodic update */
+	for (i = 0; i < RTW_HRC_FAIL_STREAK; i++)
+		rtw_hrc_feed(hrc, HRC_TEST_MCS5, 3, false, last->ms);
+
+	KUNIT_EXPECT_EQ(test, hrc->updates, updates + 1);
+	KUNIT_EXPECT_NE(test, hrc->max_tp_rate, HRC_TEST_MCS5);
+}
+
+static void rtw_hrc_test_sample(struct kunit *test)
+{
+	struct rtw_hrc *hrc;
+	bool sample, report;
+	u8 rate;
+	int i;
+
+	hrc = kunit_kzalloc(test, sizeof(*hrc), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, hrc);
+
+	rtw_hrc_init(hrc, HRC_TEST_RATE_MASK, 0);
+	KUNIT_EXPECT_EQ(test, hrc->max_tp_rate, HRC_TEST_MCS3);
+
+	for (i = 1; i < RTW_HRC_SAMPLE_INTERVAL; i++) {
+		rate = rtw_hrc_next_rate(hrc, &sample, &report);
+		KUNIT_EXPECT_EQ(test, rate, HRC_TEST_MCS3);
+		KUNIT_EXPECT_FALSE(test, sample);
+		KUNIT_EXPECT_EQ(test, report,
+				!(i % RTW_HRC_REPORT_INTERVAL));
+	}
+
+	rate = rtw_hrc_next_rate(hrc, &sample, &report);
+	KUNIT_EXPECT_TRUE(test, sample);
+	KUNIT_EXPECT_TRUE(test, report);
+	KUNIT_EXPECT_NE(test, rate, HRC_TEST_MCS3);
+	KUNIT_EXPECT_EQ(test, hrc->samples, 1);
+}
+
+static void rtw_hrc_test_set_rates(struct kunit *test)
+{
+	u32 mask = HRC_TEST_RATE_MASK & ~BIT(HRC_TEST_MCS3);
+	struct rtw_hrc *hrc;
+
+	hrc = kunit_kzalloc(test, sizeof(*hrc), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, hrc);
+
+	hrc_test_replay(hrc);
+	rtw_hrc_set_rates(hrc, mask, 0);
+
+	KUNIT_EXPECT_TRUE(test, mask & BIT(hrc->max_tp_rate));
+	KUNIT_EXPECT_TRUE(test, mask & BIT(hrc->max_prob_rate));
+	KUNIT_EXPECT_FALSE(test, hrc->rates[HRC_TEST_MCS3].sampled);
+
+	/* a report for a rate the station lost is not counted */
+	rtw_hrc_feed(hrc, HRC_TEST_MCS3, 0, true, 0);
+	KUNIT_EXPECT_EQ(test, hrc->stray, 1);
+}
+
+static struct kunit_case rtw_hrc_test_cases[] = {
+	KUNIT_CASE(rtw_hrc_test_replay),
+	KUNIT_CASE(rtw_hrc_test_fail_streak),
+	KUNIT_CASE(rtw_hrc_test_sample),
+	KUNIT_CASE(rtw_hrc_test_set_rates),
+	{}
+};
+
+static struct kunit_suite rtw_hrc_test_suite = {
+	.name = "rtw88_hrc",
+	.test_cases = rtw_hrc_test_cases,
+};
+
+kunit_test_suites(&rtw_hrc_test_suite);
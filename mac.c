@@ -817,8 +817,7 @@ static int __rtw_download_firmware(struct rtw_dev *rtwdev,
 	/* reset desc and index */
 	rtw_hci_setup(rtwdev);
 
-	rtwdev->h2c.last_box_num = 0;
-	rtwdev->h2c.seq = 0;
+	rtw_fw_h2c_reset(rtwdev);
 
 	set_bit(RTW_FLAG_FW_RUNNING, rtwdev->flags);
 
@@ -995,8 +994,7 @@ static int __rtw_download_firmware_legacy(struct rtw_dev *rtwdev,
 	/* reset desc and index */
 	rtw_hci_setup(rtwdev);
 
-	rtwdev->h2c.last_box_num = 0;
-	rtwdev->h2c.seq = 0;
+	rtw_fw_h2c_reset(rtwdev);
 
 	set_bit(RTW_FLAG_FW_RUNNING, rtwdev->flags);
 
@@ -5,6 +5,7 @@
 #include "main.h"
 #include "sec.h"
 #include "tx.h"
+#include "rx.h"
 #include "fw.h"
 #include "mac.h"
 #include "coex.h"
@@ -801,6 +802,7 @@ static void rtw_ops_tx(struct ieee80211_hw *hw,
 
 	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags)) {
 		rtw_trace_ops_tx_mgmt(rtwdev, control, skb, true);
+		rtw_tx_stats_drop(rtwdev);
 		ieee80211_free_txskb(hw, skb);
 		return;
 	}
@@ -1125,8 +1127,11 @@ static void rtw_ops_remove_interface(struct ieee80211_hw *hw,
 	clear_bit(rtwvif->port, rtwdev->hw_port);
 	rtw_release_macid(rtwdev, rtwvif->mac_id);
 	rtw_recalc_lps(rtwdev, NULL);
+	rtw_rx_addr_match_update(rtwdev, NULL, NULL, vif);
 
 	mutex_unlock(&rtwdev->mutex);
+
+	synchronize_rcu();
 }
 
 static int rtw_ops_change_interface(struct ieee80211_hw *hw,
@@ -1403,6 +1408,8 @@ static void rtw_ops_bss_info_changed(struct ieee80211_hw *hw,
 			rtw_clear_op_chan(rtwdev);
 		else
 			rtw_store_op_chan(rtwdev, true);
+
+		rtw_rx_addr_match_update(rtwdev, NULL, NULL, NULL);
 	}
 
 	if (changed & BSS_CHANGED_BEACON_INT) {
@@ -1448,6 +1455,11 @@ static void rtw_ops_bss_info_changed(struct ieee80211_hw *hw,
 	if (changed & BSS_CHANGED_PS)
 		rtw_recalc_lps(rtwdev, NULL);
 
+	if (changed & (BSS_CHANGED_ASSOC | BSS_CHANGED_BSSID |
+		       BSS_CHANGED_BASIC_RATES | BSS_CHANGED_BEACON_INFO) &&
+	    rtw8723bs_sdio(rtwdev) && vif->type == NL80211_IFTYPE_STATION)
+		rtw_tx_8723bs_bss_cck_refresh(rtwdev, vif);
+
 	rtw_vif_port_config(rtwdev, rtwvif, config);
 
 	mutex_unlock(&rtwdev->mutex);
@@ -1542,6 +1554,9 @@ static int rtw_ops_sta_remove(struct ieee80211_hw *hw,
 	rtw_sta_remove(rtwdev, sta, true);
 	mutex_unlock(&rtwdev->mutex);
 
+	/* RX statistics may still hold the station from the old lookup */
+	synchronize_rcu();
+
 	return 0;
 }
 
@@ -1667,6 +1682,7 @@ static int rtw_ops_ampdu_action(struct ieee80211_hw *hw,
 	switch (action) {
 #endif
 	case IEEE80211_AMPDU_TX_START:
+		rtw_agg_event(sta, tid, RTW_AGG_EV_TX_START);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
 		return IEEE80211_AMPDU_TX_START_IMMEDIATE;
 #else
@@ -1677,13 +1693,18 @@ static int rtw_ops_ampdu_action(struct ieee80211_hw *hw,
 	case IEEE80211_AMPDU_TX_STOP_FLUSH:
 	case IEEE80211_AMPDU_TX_STOP_FLUSH_CONT:
 		clear_bit(RTW_TXQ_AMPDU, &rtwtxq->flags);
+		rtw_agg_event(sta, tid, RTW_AGG_EV_TX_STOP);
 		ieee80211_stop_tx_ba_cb_irqsafe(vif, sta->addr, tid);
 		break;
 	case IEEE80211_AMPDU_TX_OPERATIONAL:
 		set_bit(RTW_TXQ_AMPDU, &rtwtxq->flags);
+		rtw_agg_event(sta, tid, RTW_AGG_EV_TX_OPERATIONAL);
 		break;
 	case IEEE80211_AMPDU_RX_START:
+		rtw_agg_event(sta, tid, RTW_AGG_EV_RX_START);
+		break;
 	case IEEE80211_AMPDU_RX_STOP:
+		rtw_agg_event(sta, tid, RTW_AGG_EV_RX_STOP);
 		break;
 	default:
 		WARN_ON(1);
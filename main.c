@@ -15,11 +15,13 @@
 #include "reg.h"
 #include "efuse.h"
 #include "tx.h"
+#include "rx.h"
 #include "debug.h"
 #include "bf.h"
 #include "sar.h"
 #include "sdio.h"
 #include "led.h"
+#include "hrc.h"
 
 #define RTW_SCAN_SDIO_HISR_ERRS (REG_SDIO_HISR_RXERR | \
 				 REG_SDIO_HISR_TXFOVW | \
@@ -39,14 +41,46 @@ EXPORT_SYMBOL(rtw_debug_mask);
  * there is a tough reason to maintain rtw_edcca_enabled by device.
  */
 bool rtw_edcca_enabled = true;
+/* PHY status of every Nth data frame feeds the EVM/SNR averages used by
+ * dynamic mechanism, beacons are always sampled
+ */
+unsigned int rtw_phy_stat_sample = 1;
+/* Pack bursts of H2C packets into one HCI transfer, only for firmware
+ * that parses several packets behind one TX descriptor
+ */
+bool rtw_h2c_pkt_batch;
+/* Reuse the logical efuse map read by an earlier probe of the same device
+ * while rtw_core stays loaded. Off by default: a different card with the
+ * same leading efuse bytes swapped into the same slot would inherit the
+ * MAC address and calibration of the old one.
+ */
+bool rtw_efuse_cache;
+/* Keep the card powered with firmware and MAC/BB state in place across IPS,
+ * the next wake only restores TX/RF instead of a full power on
+ */
+bool rtw_ips_retention;
+/* Pick data rates on the host from TX reports instead of the firmware RA,
+ * only on chips rtw_hrc_supported() accepts
+ */
+bool rtw_host_rc;
 
 module_param_named(disable_lps_deep, rtw_disable_lps_deep_mode, bool, 0644);
 module_param_named(support_bf, rtw_bf_support, bool, 0644);
 module_param_named(debug_mask, rtw_debug_mask, uint, 0644);
+module_param_named(phy_stat_sample, rtw_phy_stat_sample, uint, 0644);
+module_param_named(h2c_pkt_batch, rtw_h2c_pkt_batch, bool, 0644);
+module_param_named(efuse_cache, rtw_efuse_cache, bool, 0644);
+module_param_named(ips_retention, rtw_ips_retention, bool, 0644);
+module_param_named(host_rc, rtw_host_rc, bool, 0644);
 
 MODULE_PARM_DESC(disable_lps_deep, "Set Y to disable Deep PS");
 MODULE_PARM_DESC(support_bf, "Set Y to enable beamformee support");
 MODULE_PARM_DESC(debug_mask, "Debugging mask");
+MODULE_PARM_DESC(phy_stat_sample, "Sample PHY status of every Nth data frame (0/1: all)");
+MODULE_PARM_DESC(h2c_pkt_batch, "Set Y to send H2C packets in batches (firmware must accept it)");
+MODULE_PARM_DESC(efuse_cache, "Set Y to reuse the efuse map of an earlier probe in the same slot (only if the card is never swapped)");
+MODULE_PARM_DESC(ips_retention, "Set Y to keep firmware loaded while idle (faster wake, more idle power)");
+MODULE_PARM_DESC(host_rc, "Set Y to select data rates in the driver instead of the firmware (8723BS only)");
 
 #define RTW8723BS_SCAN_IGI	0x1e
 
@@ -78,12 +112,6 @@ static const struct rtw8723bs_txagc_entry rtw8723bs_pg_txagc[] = {
 	{ DESC_RATEMCS7, 0x26 },
 };
 
-static bool rtw_is_8723bs_sdio(struct rtw_dev *rtwdev)
-{
-	return rtwdev->chip->id == RTW_CHIP_TYPE_8723B &&
-	       rtw_hci_type(rtwdev) == RTW_HCI_TYPE_SDIO;
-}
-
 static void rtw8723bs_reapply_pg_txagc(struct rtw_dev *rtwdev, u8 channel);
 
 static void rtw_scan_set_8723bs_igi(struct rtw_dev *rtwdev)
@@ -391,6 +419,166 @@ static void rtw_sw_beacon_loss_check(struct rtw_dev *rtwdev,
 	rtwdev->beacon_loss = received_beacons < expected_beacons / 2;
 }
 
+void rtw_traffic_stats_sum(struct rtw_dev *rtwdev,
+			   struct rtw_traffic_counters *sum)
+{
+	const struct rtw_pcpu_traffic_stats *pcpu;
+	struct rtw_traffic_counters snap;
+	const u64 *src = (const u64 *)&snap;
+	u64 *dst = (u64 *)sum;
+	unsigned int start;
+	int cpu, i;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for_each_possible_cpu(cpu) {
+		pcpu = per_cpu_ptr(rtwdev->stats.pcpu, cpu);
+		do {
+			start = u64_stats_fetch_begin(&pcpu->syncp);
+			snap = pcpu->cnt;
+		} while (u64_stats_fetch_retry(&pcpu->syncp, start));
+
+		for (i = 0; i < sizeof(snap) / sizeof(u64); i++)
+			dst[i] += src[i];
+	}
+}
+
+/* rounds between two runs of a task, with and without busy traffic */
+static const struct {
+	u8 busy;
+	u8 idle;
+} rtw_watch_dog_period[RTW_WATCH_DOG_TASK_NUM] = {
+	[RTW_WATCH_DOG_TRAFFIC]		= {1, 1},
+	[RTW_WATCH_DOG_COEX]		= {1, 2},
+	[RTW_WATCH_DOG_DIG]		= {1, RTW_WATCH_DOG_FA_PERIOD},
+	[RTW_WATCH_DOG_CCK_PD]		= {1, RTW_WATCH_DOG_FA_PERIOD},
+	[RTW_WATCH_DOG_RA]		= {1, 4},
+	[RTW_WATCH_DOG_PWR_TRACK]	= {4, 4},
+	[RTW_WATCH_DOG_TRACK]		= {1, 2},
+};
+
+static u32 rtw_watch_dog_task_period(struct rtw_dev *rtwdev,
+				     enum rtw_watch_dog_task task, bool busy)
+{
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	/* the thermal meter is triggered and read in two rounds */
+	if (task == RTW_WATCH_DOG_PWR_TRACK &&
+	    (dm_info->pwr_trk_triggered ||
+	     rtwdev->watch_dog_sched.thermal_changed))
+		return 1;
+
+	return busy ? rtw_watch_dog_period[task].busy :
+		      rtw_watch_dog_period[task].idle;
+}
+
+static bool rtw_watch_dog_task_needed(struct rtw_dev *rtwdev,
+				      enum rtw_watch_dog_task task)
+{
+	switch (task) {
+	case RTW_WATCH_DOG_COEX:
+		return rtwdev->efuse.btcoex;
+	case RTW_WATCH_DOG_CCK_PD:
+		return rtwdev->hal.current_band_type == RTW_BAND_2G;
+	case RTW_WATCH_DOG_RA:
+		return rtwdev->sta_cnt;
+	case RTW_WATCH_DOG_TRACK:
+		return rtw_phy_dm_track_supported(rtwdev);
+	default:
+		return true;
+	}
+}
+
+/* pick the tasks to run in this round, the others count as skipped.
+ * A change of the traffic state makes every needed task due at once.
+ */
+static void rtw_watch_dog_plan(struct rtw_dev *rtwdev, bool scanning,
+			       bool traffic_changed)
+{
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	bool busy = test_bit(RTW_FLAG_BUSY_TRAFFIC, rtwdev->flags);
+	enum rtw_watch_dog_task task;
+
+	sched->due = 0;
+
+	for (task = RTW_WATCH_DOG_COEX; task < RTW_WATCH_DOG_TASK_NUM; task++) {
+		if (scanning || !rtw_watch_dog_task_needed(rtwdev, task) ||
+		    (!traffic_changed && rtwdev->watch_dog_cnt %
+		     rtw_watch_dog_task_period(rtwdev, task, busy))) {
+			rtw_watch_dog_task_count(rtwdev, task, false);
+			continue;
+		}
+
+		__set_bit(task, &sched->due);
+	}
+}
+
+/* the hardware half of a watch dog round, runs once the chip is out of LPS */
+static void rtw_watch_dog_dm(struct rtw_dev *rtwdev)
+{
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	struct rtw_watch_dog_iter_data data = {};
+
+	if (rtw_watch_dog_task_due(rtwdev, RTW_WATCH_DOG_COEX)) {
+		rtw_coex_wl_status_check(rtwdev);
+		rtw_coex_query_bt_hid_list(rtwdev);
+		rtw_coex_active_query_bt_info(rtwdev);
+		rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_COEX, true);
+	}
+
+	rtw_phy_dynamic_mechanism(rtwdev);
+
+	if (sched->due)
+		rtw_hci_dynamic_rx_agg(rtwdev, sched->tx_unicast_mbps >= 1 ||
+					       sched->rx_unicast_mbps >= 1);
+
+	data.rtwdev = rtwdev;
+	/* rtw_iterate_vifs internally uses an atomic iterator which is needed
+	 * to avoid taking local->iflist_mtx mutex
+	 */
+	rtw_iterate_vifs(rtwdev, rtw_vif_watch_dog_iter, &data);
+
+	rtw_sw_beacon_loss_check(rtwdev, data.rtwvif, sched->received_beacons);
+
+	/* fw supports only one station associated to enter lps, if there are
+	 * more than two stations associated to the AP, then we can not enter
+	 * lps, because fw does not handle the overlapped beacon interval
+	 *
+	 * rtw_recalc_lps() iterate vifs and determine if driver can enter
+	 * ps by vif->type and vif->cfg.ps, all we need to do here is to
+	 * get that vif and check if the LPS policy lets the traffic sleep.
+	 */
+	if (rtwdev->ps_enabled && data.rtwvif && !sched->ps_active &&
+	    !rtwdev->beacon_loss && !rtwdev->ap_active)
+		rtw_enter_lps(rtwdev, data.rtwvif->port);
+}
+
+/* queued by rtw_lps_leave_done() for a round that had to wake the chip */
+static void rtw_watch_dog_dm_work(struct work_struct *work)
+{
+	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev,
+					      watch_dog_dm_work);
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+
+	mutex_lock(&rtwdev->mutex);
+
+	if (!READ_ONCE(sched->dm_pending) ||
+	    test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+		goto unlock;
+
+	WRITE_ONCE(sched->dm_pending, false);
+
+	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags) ||
+	    test_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags) ||
+	    test_bit(RTW_FLAG_SCANNING, rtwdev->flags))
+		goto unlock;
+
+	rtw_watch_dog_dm(rtwdev);
+
+unlock:
+	mutex_unlock(&rtwdev->mutex);
+}
+
 /* process TX/RX statistics periodically for hardware,
  * the information helps hardware to enhance performance
  */
@@ -398,21 +586,33 @@ static void rtw_watch_dog_work(struct work_struct *work)
 {
 	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev,
 					      watch_dog_work.work);
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
 	struct rtw_traffic_stats *stats = &rtwdev->stats;
-	struct rtw_watch_dog_iter_data data = {};
+	struct rtw_traffic_counters sum;
 	bool busy_traffic = test_bit(RTW_FLAG_BUSY_TRAFFIC, rtwdev->flags);
 	int received_beacons = rtwdev->dm_info.cur_pkt_count.num_bcn_pkt;
 	u32 tx_unicast_mbps, rx_unicast_mbps;
-	bool ps_active;
 
 	mutex_lock(&rtwdev->mutex);
 
 	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags))
 		goto unlock;
 
+	/* requeued by rtw_ips_retention_leave() */
+	if (test_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags))
+		goto unlock;
+
 	ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->watch_dog_work,
 				     RTW_WATCH_DOG_DELAY_TIME);
 
+	rtw_traffic_stats_sum(rtwdev, &sum);
+	stats->tx_unicast = sum.tx_unicast - stats->total.tx_unicast;
+	stats->rx_unicast = sum.rx_unicast - stats->total.rx_unicast;
+	stats->tx_cnt = sum.tx_cnt - stats->total.tx_cnt;
+	stats->rx_cnt = sum.rx_cnt - stats->total.rx_cnt;
+	stats->total = sum;
+	rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_TRAFFIC, true);
+
 	if (rtwdev->stats.tx_cnt > 100 || rtwdev->stats.rx_cnt > 100)
 		set_bit(RTW_FLAG_BUSY_TRAFFIC, rtwdev->flags);
 	else
@@ -421,12 +621,6 @@ static void rtw_watch_dog_work(struct work_struct *work)
 	if (busy_traffic != test_bit(RTW_FLAG_BUSY_TRAFFIC, rtwdev->flags))
 		rtw_coex_wl_status_change_notify(rtwdev, 0);
 
-	if (stats->tx_cnt > RTW_LPS_THRESHOLD ||
-	    stats->rx_cnt > RTW_LPS_THRESHOLD)
-		ps_active = true;
-	else
-		ps_active = false;
-
 	tx_unicast_mbps = stats->tx_unicast >> RTW_TP_SHIFT;
 	rx_unicast_mbps = stats->rx_unicast >> RTW_TP_SHIFT;
 
@@ -435,60 +629,41 @@ static void rtw_watch_dog_work(struct work_struct *work)
 	stats->tx_throughput = ewma_tp_read(&stats->tx_ewma_tp);
 	stats->rx_throughput = ewma_tp_read(&stats->rx_ewma_tp);
 
-	/* reset tx/rx statictics */
-	stats->tx_unicast = 0;
-	stats->rx_unicast = 0;
-	stats->tx_cnt = 0;
-	stats->rx_cnt = 0;
-
-	if (test_bit(RTW_FLAG_SCANNING, rtwdev->flags))
-		goto unlock;
-
-	/* make sure BB/RF is working for dynamic mech */
-	rtw_leave_lps(rtwdev);
-	rtw_coex_wl_status_check(rtwdev);
-	rtw_coex_query_bt_hid_list(rtwdev);
-	rtw_coex_active_query_bt_info(rtwdev);
+	/* a round still waiting on the last leave gives up its DM half */
+	WRITE_ONCE(sched->dm_pending, false);
 
-	rtw_phy_dynamic_mechanism(rtwdev);
+	sched->ps_active = !rtw_lps_policy_allow(rtwdev);
+	sched->tx_unicast_mbps = tx_unicast_mbps;
+	sched->rx_unicast_mbps = rx_unicast_mbps;
+	sched->received_beacons = received_beacons;
 
-	rtw_hci_dynamic_rx_agg(rtwdev,
-			       tx_unicast_mbps >= 1 || rx_unicast_mbps >= 1);
+	rtw_watch_dog_plan(rtwdev, test_bit(RTW_FLAG_SCANNING, rtwdev->flags),
+			   busy_traffic != test_bit(RTW_FLAG_BUSY_TRAFFIC,
+						    rtwdev->flags));
 
-	data.rtwdev = rtwdev;
-	/* rtw_iterate_vifs internally uses an atomic iterator which is needed
-	 * to avoid taking local->iflist_mtx mutex
-	 */
-	rtw_iterate_vifs(rtwdev, rtw_vif_watch_dog_iter, &data);
+	if (test_bit(RTW_FLAG_SCANNING, rtwdev->flags))
+		goto unlock;
 
-	rtw_sw_beacon_loss_check(rtwdev, data.rtwvif, received_beacons);
+	rtwdev->watch_dog_cnt++;
 
-	/* fw supports only one station associated to enter lps, if there are
-	 * more than two stations associated to the AP, then we can not enter
-	 * lps, because fw does not handle the overlapped beacon interval
-	 *
-	 * rtw_recalc_lps() iterate vifs and determine if driver can enter
-	 * ps by vif->type and vif->cfg.ps, all we need to do here is to
-	 * get that vif and check if device is having traffic more than the
-	 * threshold.
-	 */
-	/* On 8723BS the firmware's per-packet wake latency out of LPS throttles
-	 * bursty traffic hard (uplink TCP ~3x lower, latency spikes into the
-	 * 100s of ms). The stock check enters LPS after a single quiet 2s
-	 * window, which a normal bursty session hits constantly. Gate LPS on
-	 * the smoothed throughput instead so the chip only sleeps after
-	 * sustained idle and stays awake through an active session. Other chips
-	 * keep the normal behaviour.
+	/* make sure BB/RF is working for dynamic mech, stay asleep in the
+	 * rounds without any hardware task due unless traffic wants us awake.
+	 * Leaving is asynchronous, the DM half then runs from
+	 * watch_dog_dm_work once rtw_lps_leave_done() sees the ack.
 	 */
-	if (rtw_is_8723bs_sdio(rtwdev) &&
-	    (stats->tx_throughput || stats->rx_throughput))
-		ps_active = true;
+	if (sched->due || sched->ps_active) {
+		if (test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags))
+			sched->lps_leave_cnt++;
 
-	if (rtwdev->ps_enabled && data.rtwvif && !ps_active &&
-	    !rtwdev->beacon_loss && !rtwdev->ap_active)
-		rtw_enter_lps(rtwdev, data.rtwvif->port);
+		/* set first, the ack may come before rtw_leave_lps() returns */
+		WRITE_ONCE(sched->dm_pending, true);
+		rtw_leave_lps(rtwdev);
+		if (test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+			goto unlock;
+		WRITE_ONCE(sched->dm_pending, false);
+	}
 
-	rtwdev->watch_dog_cnt++;
+	rtw_watch_dog_dm(rtwdev);
 
 unlock:
 	mutex_unlock(&rtwdev->mutex);
@@ -502,10 +677,43 @@ static void rtw_c2h_work(struct work_struct *work)
 	skb_queue_walk_safe(&rtwdev->c2h_queue, skb, tmp) {
 		skb_unlink(skb, &rtwdev->c2h_queue);
 		rtw_fw_c2h_cmd_handle(rtwdev, skb);
-		dev_kfree_skb_any(skb);
 	}
 }
 
+static void rtw_c2h_hipri_work(struct work_struct *work)
+{
+	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev,
+					      c2h_hipri_work);
+	struct sk_buff *skb;
+
+	while ((skb = skb_dequeue(&rtwdev->c2h_hipri_queue)))
+		rtw_fw_c2h_cmd_handle_hipri(rtwdev, skb);
+}
+
+static void rtw_h2c_work(struct work_struct *work)
+{
+	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev, h2c.work);
+
+	mutex_lock(&rtwdev->mutex);
+	if (rtwdev->h2c.queue_len &&
+	    test_bit(RTW_FLAG_FW_RUNNING, rtwdev->flags)) {
+		rtw_leave_lps_deep(rtwdev);
+		rtw_fw_h2c_flush(rtwdev);
+	}
+	mutex_unlock(&rtwdev->mutex);
+}
+
+static void rtw_h2c_pkt_work(struct work_struct *work)
+{
+	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev,
+					      h2c.pkt_work.work);
+
+	mutex_lock(&rtwdev->mutex);
+	if (test_bit(RTW_FLAG_FW_RUNNING, rtwdev->flags))
+		rtw_fw_h2c_pkt_flush(rtwdev, RTW_H2C_PKT_FLUSH_DEADLINE);
+	mutex_unlock(&rtwdev->mutex);
+}
+
 static void rtw_ips_work(struct work_struct *work)
 {
 	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev, ips_work);
@@ -577,6 +785,8 @@ int rtw_sta_add(struct rtw_dev *rtwdev, struct ieee80211_sta *sta,
 	for (i = 0; i < ARRAY_SIZE(sta->txq); i++)
 		rtw_txq_init(rtwdev, sta->txq[i]);
 	INIT_WORK(&si->rc_work, rtw_sta_rc_work);
+	spin_lock_init(&si->hrc_lock);
+	rtw_hrc_init(&si->hrc, 0, 0);
 
 	rtw_update_sta_info(rtwdev, si, true);
 	if (rtw8723bs_defer_sta_media_status(rtwdev, sta, vif)) {
@@ -590,6 +800,8 @@ int rtw_sta_add(struct rtw_dev *rtwdev, struct ieee80211_sta *sta,
 			rtwvif->fw_media_connected = true;
 	}
 
+	rtw_rx_addr_match_update(rtwdev, si, NULL, NULL);
+
 	rtwdev->sta_cnt++;
 	rtwdev->beacon_loss = false;
 	rtw_dbg(rtwdev, RTW_DBG_STATE, "sta %pM joined with macid %d\n",
@@ -625,6 +837,9 @@ void rtw_sta_remove(struct rtw_dev *rtwdev, struct ieee80211_sta *sta,
 	for (i = 0; i < ARRAY_SIZE(sta->txq); i++)
 		rtw_txq_cleanup(rtwdev, sta->txq[i]);
 
+	rtw_rx_addr_match_update(rtwdev, NULL, si, NULL);
+	rtw_tx_tmpl_free(rtwdev, si);
+
 	kfree(si->mask);
 
 	rtwdev->sta_cnt--;
@@ -832,18 +1047,6 @@ void rtw_vif_assoc_changed(struct rtw_vif *rtwvif,
 	}
 }
 
-static void rtw_reset_key_iter(struct ieee80211_hw *hw,
-			       struct ieee80211_vif *vif,
-			       struct ieee80211_sta *sta,
-			       struct ieee80211_key_conf *key,
-			       void *data)
-{
-	struct rtw_dev *rtwdev = (struct rtw_dev *)data;
-	struct rtw_sec_desc *sec = &rtwdev->sec;
-
-	rtw_sec_clear_cam(rtwdev, sec, key->hw_key_idx);
-}
-
 static void rtw_reset_sta_iter(void *data, struct ieee80211_sta *sta)
 {
 	struct rtw_dev *rtwdev = (struct rtw_dev *)data;
@@ -898,9 +1101,7 @@ free:
 
 	WARN(1, "firmware crash, start reset and recover\n");
 
-	rcu_read_lock();
-	rtw_iterate_keys_rcu(rtwdev, NULL, rtw_reset_key_iter, rtwdev);
-	rcu_read_unlock();
+	rtw_sec_clear_cam_all(rtwdev);
 	rtw_iterate_stas_atomic(rtwdev, rtw_reset_sta_iter, rtwdev);
 	rtw_iterate_vifs_atomic(rtwdev, rtw_reset_vif_iter, rtwdev);
 	bitmap_zero(rtwdev->hw_port, RTW_PORT_NUM);
@@ -931,7 +1132,10 @@ static void rtw_txq_ba_iter(void *data, struct ieee80211_sta *sta)
 	tid = find_first_bit(si->tid_ba, IEEE80211_NUM_TIDS);
 	while (tid != IEEE80211_NUM_TIDS) {
 		clear_bit(tid, si->tid_ba);
+		rtw_agg_event(sta, tid, RTW_AGG_EV_REQUEST);
 		ret = ieee80211_start_tx_ba_session(sta, tid, 0);
+		if (ret)
+			rtw_agg_event(sta, tid, RTW_AGG_EV_REFUSED);
 		if (ret == -EINVAL) {
 			struct ieee80211_txq *txq;
 			struct rtw_txq *rtwtxq;
@@ -939,6 +1143,7 @@ static void rtw_txq_ba_iter(void *data, struct ieee80211_sta *sta)
 			txq = sta->txq[tid];
 			rtwtxq = (struct rtw_txq *)txq->drv_priv;
 			set_bit(RTW_TXQ_BLOCK_BA, &rtwtxq->flags);
+			rtw_agg_event(sta, tid, RTW_AGG_EV_BLOCKED);
 		}
 
 		tid = find_first_bit(si->tid_ba, IEEE80211_NUM_TIDS);
@@ -1054,6 +1259,7 @@ void rtw_update_channel(struct rtw_dev *rtwdev, u8 center_channel,
 	hal->current_band_type = band;
 	hal->sar_band = sar_band;
 }
+EXPORT_SYMBOL(rtw_update_channel);
 
 void rtw_get_channel_params(struct cfg80211_chan_def *chandef,
 			    struct rtw_channel_params *chan_params)
@@ -1110,7 +1316,10 @@ void rtw_set_channel(struct rtw_dev *rtwdev)
 	struct ieee80211_hw *hw = rtwdev->hw;
 	struct rtw_hal *hal = &rtwdev->hal;
 	struct rtw_channel_params ch_param;
+	struct rtw_txagc_count txagc = hal->txagc.total;
 	u8 center_chan, primary_chan, bandwidth, band;
+	u8 prev_chan = hal->current_channel;
+	ktime_t start;
 
 	rtw_get_channel_params(&hw->conf.chandef, &ch_param);
 	if (WARN(ch_param.center_chan == 0, "Invalid channel\n"))
@@ -1130,8 +1339,11 @@ void rtw_set_channel(struct rtw_dev *rtwdev)
 	if (rtwdev->scan_info.op_chan)
 		rtw_store_op_chan(rtwdev, true);
 
+	start = ktime_get();
 	chip->ops->set_channel(rtwdev, center_chan, bandwidth,
 			       hal->current_primary_channel_index);
+	rtw_phy_chan_switch_account(rtwdev, prev_chan, center_chan,
+				    ktime_us_delta(ktime_get(), start));
 
 	if (test_bit(RTW_FLAG_SCANNING, rtwdev->flags))
 		rtw_scan_dump_regs(rtwdev, "set_channel");
@@ -1149,6 +1361,10 @@ void rtw_set_channel(struct rtw_dev *rtwdev)
 
 	rtw8723bs_reapply_pg_txagc(rtwdev, center_chan);
 
+	hal->txagc.last_switch.writes = hal->txagc.total.writes - txagc.writes;
+	hal->txagc.last_switch.skips = hal->txagc.total.skips - txagc.skips;
+	hal->txagc.last_switch.reads = hal->txagc.total.reads - txagc.reads;
+
 	/* If the channel isn't set for scanning, most chips do RF calibration
 	 * in ieee80211_ops::mgd_prepare_tx(). 8723BS SDIO keeps staging's
 	 * power-on IQK shape and skips fresh auth-window IQK.
@@ -1762,6 +1978,10 @@ void rtw_update_sta_info(struct rtw_dev *rtwdev, struct rtw_sta_info *si,
 	si->vht_enable = is_vht_enable;
 	si->ra_mask = ra_mask;
 	si->rate_id = rate_id;
+	rtw_hrc_sta_update(rtwdev, si);
+
+	/* rate id, bandwidth and caps feed the cached TX template */
+	rtw_tx_tmpl_update(rtwdev, si);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 18, 0)
 	rtw_fw_send_ra_info(rtwdev, si, reset_ra_mask);
@@ -1812,7 +2032,65 @@ static enum rtw_lps_deep_mode rtw_update_lps_deep_mode(struct rtw_dev *rtwdev,
 	return LPS_DEEP_MODE_NONE;
 }
 
-int rtw_power_on(struct rtw_dev *rtwdev)
+/* Bring-up profiling. rtw_boot_begin() opens a record, rtw_boot_mark()
+ * charges the time and bus accesses since the previous mark to a stage and
+ * rtw_boot_end() files the record into the ring. A bring-up nested in
+ * another one (power on inside IPS leave) is charged to the outer record.
+ */
+static void rtw_boot_snapshot(struct rtw_dev *rtwdev)
+{
+	struct rtw_boot_profile *bp = &rtwdev->boot_profile;
+
+	bp->mark = ktime_get();
+	bp->reads = rtwdev->hci.reads;
+	bp->writes = rtwdev->hci.writes;
+	bp->xfers = rtwdev->hci.xfers;
+}
+
+void rtw_boot_begin(struct rtw_dev *rtwdev, enum rtw_boot_kind kind)
+{
+	struct rtw_boot_profile *bp = &rtwdev->boot_profile;
+
+	if (bp->depth++)
+		return;
+
+	memset(&bp->cur, 0, sizeof(bp->cur));
+	bp->cur.kind = kind;
+	rtw_boot_snapshot(rtwdev);
+	bp->start = bp->mark;
+}
+
+void rtw_boot_mark(struct rtw_dev *rtwdev, enum rtw_boot_stage stage)
+{
+	struct rtw_boot_profile *bp = &rtwdev->boot_profile;
+	struct rtw_boot_stage_rec *rec = &bp->cur.stage[stage];
+
+	if (!bp->depth)
+		return;
+
+	rec->us += ktime_us_delta(ktime_get(), bp->mark);
+	rec->reads += rtwdev->hci.reads - bp->reads;
+	rec->writes += rtwdev->hci.writes - bp->writes;
+	rec->xfers += rtwdev->hci.xfers - bp->xfers;
+	rtw_boot_snapshot(rtwdev);
+}
+
+void rtw_boot_end(struct rtw_dev *rtwdev, int ret)
+{
+	struct rtw_boot_profile *bp = &rtwdev->boot_profile;
+
+	if (!bp->depth || --bp->depth)
+		return;
+
+	bp->cur.ret = ret;
+	bp->cur.total_us = ktime_us_delta(ktime_get(), bp->start);
+	bp->ring[bp->head] = bp->cur;
+	bp->head = (bp->head + 1) % RTW_BOOT_PROFILE_NUM;
+	if (bp->cnt < RTW_BOOT_PROFILE_NUM)
+		bp->cnt++;
+}
+
+static int __rtw_power_on(struct rtw_dev *rtwdev)
 {
 
 	const struct rtw_chip_info *chip = rtwdev->chip;
@@ -1825,6 +2103,7 @@ int rtw_power_on(struct rtw_dev *rtwdev)
 		rtw_err(rtwdev, "failed to setup hci\n");
 		goto err;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_HCI_SETUP);
 
 	/* power on MAC before firmware downloaded */
 	ret = rtw_mac_power_on(rtwdev);
@@ -1832,18 +2111,21 @@ int rtw_power_on(struct rtw_dev *rtwdev)
 		rtw_err(rtwdev, "failed to power on mac\n");
 		goto err;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_MAC_POWER_ON);
 
 	ret = rtw_wait_firmware_completion(rtwdev);
 	if (ret) {
 		rtw_err(rtwdev, "failed to wait firmware completion\n");
 		goto err_off;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_FW_WAIT);
 
 	ret = rtw_download_firmware(rtwdev, fw);
 	if (ret) {
 		rtw_err(rtwdev, "failed to download firmware\n");
 		goto err_off;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_FW_DOWNLOAD);
 
 	/* config mac after firmware downloaded */
 	ret = rtw_mac_init(rtwdev);
@@ -1851,20 +2133,24 @@ int rtw_power_on(struct rtw_dev *rtwdev)
 		rtw_err(rtwdev, "failed to configure mac\n");
 		goto err_off;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_MAC_INIT);
 
 	chip->ops->phy_set_param(rtwdev);
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_PHY_SET_PARAM);
 
 	ret = rtw_mac_postinit(rtwdev);
 	if (ret) {
 		rtw_err(rtwdev, "failed to configure mac in postinit\n");
 		goto err_off;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_MAC_POSTINIT);
 
 	ret = rtw_hci_start(rtwdev);
 	if (ret) {
 		rtw_err(rtwdev, "failed to start hci\n");
 		goto err_off;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_HCI_START);
 
 
 	/* send H2C after HCI has started */
@@ -2020,6 +2306,8 @@ int rtw_power_on(struct rtw_dev *rtwdev)
 		}
 	}
 
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_RFK_COEX);
+
 	return 0;
 
 err_off:
@@ -2028,6 +2316,17 @@ err_off:
 err:
 	return ret;
 }
+
+int rtw_power_on(struct rtw_dev *rtwdev)
+{
+	int ret;
+
+	rtw_boot_begin(rtwdev, RTW_BOOT_POWER_ON);
+	ret = __rtw_power_on(rtwdev);
+	rtw_boot_end(rtwdev, ret);
+
+	return ret;
+}
 EXPORT_SYMBOL(rtw_power_on);
 
 void rtw_core_fw_scan_notify(struct rtw_dev *rtwdev, bool start)
@@ -2057,7 +2356,7 @@ void rtw_core_scan_start(struct rtw_dev *rtwdev, struct rtw_vif *rtwvif,
 	int ret = 0;
 
 
-	rtw_leave_lps(rtwdev);
+	rtw_leave_lps_sync(rtwdev);
 
 	if (hw_scan && (rtwdev->hw->conf.flags & IEEE80211_CONF_IDLE)) {
 		ret = rtw_leave_ips(rtwdev);
@@ -2209,6 +2508,7 @@ int rtw_core_start(struct rtw_dev *rtwdev)
 		return ret;
 
 	rtw_sec_enable_sec_engine(rtwdev);
+	rtw_sec_cam_restore(rtwdev);
 
 	rtwdev->lps_conf.deep_mode = rtw_update_lps_deep_mode(rtwdev, &rtwdev->fw);
 	rtwdev->lps_conf.wow_deep_mode = rtw_update_lps_deep_mode(rtwdev, &rtwdev->wow_fw);
@@ -2229,6 +2529,14 @@ void rtw_power_off(struct rtw_dev *rtwdev)
 	rtw_hci_stop(rtwdev);
 	rtw_coex_power_off_setting(rtwdev);
 	rtw_mac_power_off(rtwdev);
+	/* LCK and IQK state is lost with power, so is what the TXAGC,
+	 * channel and security CAM registers were programmed to
+	 */
+	rtw_phy_iqk_cache_flush(rtwdev);
+	rtw_phy_txagc_reset(rtwdev);
+	rtw_phy_chan_delta_invalidate(rtwdev);
+	rtw_phy_rf_shadow_invalidate(rtwdev);
+	rtw_sec_cam_invalidate(rtwdev);
 }
 EXPORT_SYMBOL(rtw_power_off);
 
@@ -2236,14 +2544,28 @@ void rtw_core_stop(struct rtw_dev *rtwdev)
 {
 	struct rtw_coex *coex = &rtwdev->coex;
 
+	if (test_bit(RTW_FLAG_FW_RUNNING, rtwdev->flags))
+		rtw_fw_h2c_barrier(rtwdev);
+
 	clear_bit(RTW_FLAG_RUNNING, rtwdev->flags);
 	clear_bit(RTW_FLAG_FW_RUNNING, rtwdev->flags);
+	clear_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags);
+	clear_bit(RTW_FLAG_LEISURE_PS_CPWM, rtwdev->flags);
+	WRITE_ONCE(rtwdev->watch_dog_sched.dm_pending, false);
+	ieee80211_purge_tx_queue(rtwdev->hw, &rtwdev->lps_tx_queue);
+	/* whatever retention IPS parked goes away with the power */
+	clear_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags);
 
 	mutex_unlock(&rtwdev->mutex);
 
 	cancel_work_sync(&rtwdev->c2h_work);
+	cancel_work_sync(&rtwdev->c2h_hipri_work);
+	cancel_work_sync(&rtwdev->h2c.work);
+	cancel_delayed_work_sync(&rtwdev->h2c.pkt_work);
 	cancel_work_sync(&rtwdev->update_beacon_work);
 	cancel_delayed_work_sync(&rtwdev->watch_dog_work);
+	cancel_work_sync(&rtwdev->watch_dog_dm_work);
+	cancel_delayed_work_sync(&rtwdev->lps_leave_work);
 	cancel_delayed_work_sync(&coex->bt_relink_work);
 	cancel_delayed_work_sync(&coex->bt_reenable_work);
 	cancel_delayed_work_sync(&coex->defreeze_work);
@@ -2830,6 +3152,7 @@ static int rtw_chip_board_info_setup(struct rtw_dev *rtwdev)
 	rtw_load_table(rtwdev, rfe_def->txpwr_lmt_tbl);
 	rtw_phy_tx_power_by_rate_config(hal);
 	rtw_phy_tx_power_limit_config(hal);
+	rtw_phy_tx_pwr_cache_flush(rtwdev);
 
 	return 0;
 }
@@ -2839,37 +3162,54 @@ int rtw_chip_info_setup(struct rtw_dev *rtwdev)
 
 	int ret;
 
+	/* bus specific setup since rtw_core_init() */
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_HCI_PROBE);
+
 	ret = rtw_chip_parameter_setup(rtwdev);
 	if (ret) {
 		rtw_err(rtwdev, "failed to setup chip parameters\n");
 		goto err_out;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_CHIP_PARAM);
 
 	ret = rtw_chip_efuse_info_setup(rtwdev);
 	if (ret) {
 		rtw_err(rtwdev, "failed to setup chip efuse info\n");
 		goto err_out;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_EFUSE);
 
 	ret = rtw_chip_board_info_setup(rtwdev);
 	if (ret) {
 		rtw_err(rtwdev, "failed to setup chip board info\n");
 		goto err_out;
 	}
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_BOARD_INFO);
+
+	rtw_boot_end(rtwdev, 0);
 
 	return 0;
 
 err_out:
+	rtw_boot_end(rtwdev, ret);
 	return ret;
 }
 EXPORT_SYMBOL(rtw_chip_info_setup);
 
-static void rtw_stats_init(struct rtw_dev *rtwdev)
+static int rtw_stats_init(struct rtw_dev *rtwdev)
 {
 	struct rtw_traffic_stats *stats = &rtwdev->stats;
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	int cpu;
 	int i;
 
+	stats->pcpu = alloc_percpu(struct rtw_pcpu_traffic_stats);
+	if (!stats->pcpu)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(stats->pcpu, cpu)->syncp);
+
 	ewma_tp_init(&stats->tx_ewma_tp);
 	ewma_tp_init(&stats->rx_ewma_tp);
 
@@ -2877,6 +3217,8 @@ static void rtw_stats_init(struct rtw_dev *rtwdev)
 		ewma_evm_init(&dm_info->ewma_evm[i]);
 	for (i = 0; i < RTW_SNR_NUM; i++)
 		ewma_snr_init(&dm_info->ewma_snr[i]);
+
+	return 0;
 }
 
 int rtw_core_init(struct rtw_dev *rtwdev)
@@ -2885,6 +3227,9 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 	struct rtw_coex *coex = &rtwdev->coex;
 	int ret;
 
+	/* closed by rtw_chip_info_setup() */
+	rtw_boot_begin(rtwdev, RTW_BOOT_PROBE);
+
 	INIT_LIST_HEAD(&rtwdev->rsvd_page_list);
 	INIT_LIST_HEAD(&rtwdev->txqs);
 
@@ -2899,10 +3244,13 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 	rtwdev->tx_wq = alloc_workqueue("rtw_tx_wq", WQ_UNBOUND | WQ_HIGHPRI, 0);
 	if (!rtwdev->tx_wq) {
 		rtw_warn(rtwdev, "alloc_workqueue rtw_tx_wq failed\n");
-		return -ENOMEM;
+		ret = -ENOMEM;
+		goto out_boot;
 	}
 
 	INIT_DELAYED_WORK(&rtwdev->watch_dog_work, rtw_watch_dog_work);
+	INIT_WORK(&rtwdev->watch_dog_dm_work, rtw_watch_dog_dm_work);
+	INIT_DELAYED_WORK(&rtwdev->lps_leave_work, rtw_lps_leave_work);
 	INIT_DELAYED_WORK(&coex->bt_relink_work, rtw_coex_bt_relink_work);
 	INIT_DELAYED_WORK(&coex->bt_reenable_work, rtw_coex_bt_reenable_work);
 	INIT_DELAYED_WORK(&coex->defreeze_work, rtw_coex_defreeze_work);
@@ -2914,31 +3262,42 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 	INIT_DELAYED_WORK(&coex->wl_ccklock_work, rtw_coex_wl_ccklock_work);
 	INIT_WORK(&rtwdev->tx_work, rtw_tx_work);
 	INIT_WORK(&rtwdev->c2h_work, rtw_c2h_work);
+	INIT_WORK(&rtwdev->c2h_hipri_work, rtw_c2h_hipri_work);
+	INIT_WORK(&rtwdev->h2c.work, rtw_h2c_work);
+	INIT_DELAYED_WORK(&rtwdev->h2c.pkt_work, rtw_h2c_pkt_work);
 	INIT_WORK(&rtwdev->ips_work, rtw_ips_work);
 	INIT_WORK(&rtwdev->fw_recovery_work, rtw_fw_recovery_work);
 	INIT_WORK(&rtwdev->update_beacon_work, rtw_fw_update_beacon_work);
 	INIT_WORK(&rtwdev->ba_work, rtw_txq_ba_work);
 	skb_queue_head_init(&rtwdev->c2h_queue);
+	skb_queue_head_init(&rtwdev->c2h_hipri_queue);
 	skb_queue_head_init(&rtwdev->coex.queue);
-	skb_queue_head_init(&rtwdev->tx_report.queue);
+	skb_queue_head_init(&rtwdev->lps_tx_queue);
 
 	spin_lock_init(&rtwdev->txq_lock);
 	spin_lock_init(&rtwdev->tx_report.q_lock);
 	spin_lock_init(&rtwdev->auth_sync.lock);
+	spin_lock_init(&rtwdev->c2h_stats.lock);
 
 	mutex_init(&rtwdev->mutex);
 	mutex_init(&rtwdev->hal.tx_power_mutex);
 
 	init_waitqueue_head(&rtwdev->coex.wait);
 	init_waitqueue_head(&rtwdev->auth_sync.wait);
-	init_completion(&rtwdev->lps_leave_check);
+	init_waitqueue_head(&rtwdev->lps_leave_wait);
 	init_completion(&rtwdev->fw_scan_density);
 
 	rtwdev->sec.total_cam_num = 32;
 	rtwdev->hal.current_channel = 1;
 	rtwdev->dm_info.fix_rate = U8_MAX;
+	rtwdev->host_rc = rtw_host_rc;
 
-	rtw_stats_init(rtwdev);
+	rtw_lps_policy_init(rtwdev);
+	ret = rtw_stats_init(rtwdev);
+	if (ret) {
+		rtw_warn(rtwdev, "failed to allocate traffic statistics\n");
+		goto out_wq;
+	}
 
 	/* default rx filter setting */
 	rtwdev->hal.rcr = BIT_APP_FCS | BIT_APP_MIC | BIT_APP_ICV |
@@ -2962,10 +3321,16 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 		}
 	}
 
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_CORE_INIT);
+
 	return 0;
 
 out:
+	free_percpu(rtwdev->stats.pcpu);
+out_wq:
 	destroy_workqueue(rtwdev->tx_wq);
+out_boot:
+	rtw_boot_end(rtwdev, ret);
 	return ret;
 }
 EXPORT_SYMBOL(rtw_core_init);
@@ -2975,7 +3340,6 @@ void rtw_core_deinit(struct rtw_dev *rtwdev)
 	struct rtw_fw_state *fw = &rtwdev->fw;
 	struct rtw_fw_state *wow_fw = &rtwdev->wow_fw;
 	struct rtw_rsvd_page *rsvd_pkt, *tmp;
-	unsigned long flags;
 
 	rtw_wait_firmware_completion(rtwdev);
 
@@ -2986,16 +3350,17 @@ void rtw_core_deinit(struct rtw_dev *rtwdev)
 		release_firmware(wow_fw->firmware);
 
 	destroy_workqueue(rtwdev->tx_wq);
+	rtw_rx_addr_match_deinit(rtwdev);
 # if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
 	timer_delete_sync(&rtwdev->tx_report.purge_timer);
 # else
 	del_timer_sync(&rtwdev->tx_report.purge_timer);
 # endif
-	spin_lock_irqsave(&rtwdev->tx_report.q_lock, flags);
-	skb_queue_purge(&rtwdev->tx_report.queue);
-	spin_unlock_irqrestore(&rtwdev->tx_report.q_lock, flags);
+	rtw_tx_report_purge(rtwdev);
+	free_percpu(rtwdev->stats.pcpu);
 	skb_queue_purge(&rtwdev->coex.queue);
 	skb_queue_purge(&rtwdev->c2h_queue);
+	skb_queue_purge(&rtwdev->c2h_hipri_queue);
 
 	list_for_each_entry_safe(rsvd_pkt, tmp, &rtwdev->rsvd_page_list,
 				 build_list) {
@@ -3167,9 +3532,6 @@ static void rtw_port_switch_iter(void *data, struct ieee80211_vif *vif)
 	rtw_dbg(rtwdev, RTW_DBG_STATE, "AP port switch from %d -> %d\n",
 		rtwvif_ap->port, rtwvif_target->port);
 
-	/* Leave LPS so the value swapped are not in PS mode */
-	rtw_leave_lps(rtwdev);
-
 	reg1 = &rtwvif_ap->conf->net_type;
 	reg2 = &rtwvif_target->conf->net_type;
 	rtw_swap_reg_mask(rtwdev, reg1, reg2);
@@ -3200,6 +3562,11 @@ void rtw_core_port_switch(struct rtw_dev *rtwdev, struct ieee80211_vif *vif)
 	if (vif->type != NL80211_IFTYPE_AP || rtwvif->port == RTW_PORT_0)
 		return;
 
+	/* Leave LPS so the value swapped are not in PS mode. Not from the
+	 * iterator, waiting drops the mutex the vif snapshot relies on.
+	 */
+	rtw_leave_lps_sync(rtwdev);
+
 	iter_data.rtwdev = rtwdev;
 	iter_data.rtwvif_ap = rtwvif;
 	rtw_iterate_vifs(rtwdev, rtw_port_switch_iter, &iter_data);
@@ -3287,6 +3654,12 @@ void rtw_set_ampdu_factor(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 		ops->set_ampdu_factor(rtwdev, factor);
 }
 
+static void __exit rtw_core_exit(void)
+{
+	rtw_efuse_cache_free();
+}
+module_exit(rtw_core_exit);
+
 MODULE_AUTHOR("Realtek Corporation");
 MODULE_DESCRIPTION("Realtek 802.11ac wireless core module");
 MODULE_LICENSE("Dual BSD/GPL");
@@ -22,8 +22,10 @@
 #include <linux/iopoll.h>
 #include <linux/interrupt.h>
 #include <linux/workqueue.h>
+#include <linux/u64_stats_sync.h>
 
 #include "util.h"
+#include "hrc_alg.h"
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4, 8, 0)
 #include <linux/etherdevice.h>
 #endif
@@ -107,6 +109,7 @@ static inline void fsleep(unsigned long usecs)
 
 #define RTW_MAX_MAC_ID_NUM		32
 #define RTW_MAX_SEC_CAM_NUM		32
+#define RTW_SEC_CAM_WORD_NUM		8
 #define MAX_PG_CAM_BACKUP_NUM		8
 
 #define RTW_SCAN_MAX_SSIDS		4
@@ -191,6 +194,11 @@ extern bool rtw_bf_support;
 extern bool rtw_disable_lps_deep_mode;
 extern unsigned int rtw_debug_mask;
 extern bool rtw_edcca_enabled;
+extern unsigned int rtw_phy_stat_sample;
+extern bool rtw_h2c_pkt_batch;
+extern bool rtw_efuse_cache;
+extern bool rtw_ips_retention;
+extern bool rtw_host_rc;
 extern const struct ieee80211_ops rtw_ops;
 
 #define RTW_MAX_CHANNEL_NUM_2G 14
@@ -216,6 +224,11 @@ struct rtw_hci {
 	u32 cpwm_addr;
 
 	u8 bulkout_num;
+
+	/* register accesses and block transfers, unlocked so approximate */
+	u32 reads;
+	u32 writes;
+	u32 xfers;
 };
 
 #define IS_CH_5G_BAND_1(channel) ((channel) >= 36 && (channel <= 48))
@@ -520,6 +533,9 @@ enum rtw_flags {
 	RTW_FLAG_POWERON,
 	RTW_FLAG_LEISURE_PS,
 	RTW_FLAG_LEISURE_PS_DEEP,
+	RTW_FLAG_LEISURE_PS_LEAVING,
+	/* the last deep PS enter request is not acked yet */
+	RTW_FLAG_LEISURE_PS_CPWM,
 	RTW_FLAG_DIG_DISABLE,
 	RTW_FLAG_BUSY_TRAFFIC,
 	RTW_FLAG_WOWLAN,
@@ -527,6 +543,7 @@ enum rtw_flags {
 	RTW_FLAG_RESTART_TRIGGERING,
 	RTW_FLAG_FORCE_LOWEST_RATE,
 	RTW_FLAG_SOFT_IPS,
+	RTW_FLAG_RETENTION_IPS,
 
 	NUM_OF_RTW_FLAGS,
 };
@@ -722,6 +739,14 @@ struct rtw_rf_sipi_addr {
 	u32 lssi_read_pi;
 };
 
+/* an RF register only the host writes, bits in @self_clear are cleared by
+ * the hardware (e.g. a calibration trigger) and make the copy unusable
+ */
+struct rtw_rf_shadow_def {
+	u8 addr;
+	u32 self_clear;
+};
+
 struct rtw_hw_reg_offset {
 	struct rtw_hw_reg hw_reg;
 	u8 offset;
@@ -785,6 +810,15 @@ struct rtw_tx_pkt_info {
 	bool bt_null;
 };
 
+/* frames of one hardware queue handed to the HCI in one go */
+#define RTW_TX_BATCH_MAX	16
+
+struct rtw_tx_batch {
+	struct sk_buff *skbs[RTW_TX_BATCH_MAX];
+	struct rtw_tx_pkt_info pkt_info[RTW_TX_BATCH_MAX];
+	u8 num;
+};
+
 struct rtw_rx_pkt_stat {
 	bool phy_status;
 	bool icv_err;
@@ -819,12 +853,51 @@ struct rtw_rx_pkt_stat {
 
 DECLARE_EWMA(tp, 10, 2);
 
+enum rtw_rate_class {
+	RTW_RATE_CLASS_CCK,
+	RTW_RATE_CLASS_OFDM,
+	RTW_RATE_CLASS_HT,
+	RTW_RATE_CLASS_VHT,
+
+	RTW_RATE_CLASS_NUM,
+};
+
+/* only u64 members, they are summed member by member */
+struct rtw_traffic_counters {
+	/* unicast data, bytes and packets */
+	u64 tx_unicast;
+	u64 rx_unicast;
+	u64 tx_cnt;
+	u64 rx_cnt;
+
+	u64 tx_ac_pkts[IEEE80211_NUM_ACS];
+	u64 tx_ac_bytes[IEEE80211_NUM_ACS];
+	u64 rx_ac_pkts[IEEE80211_NUM_ACS];
+	u64 rx_ac_bytes[IEEE80211_NUM_ACS];
+
+	u64 tx_rate_pkts[RTW_RATE_CLASS_NUM];
+	u64 rx_rate_pkts[RTW_RATE_CLASS_NUM];
+
+	u64 tx_drop;
+	u64 rx_drop;
+};
+
+struct rtw_pcpu_traffic_stats {
+	struct u64_stats_sync syncp;
+	struct rtw_traffic_counters cnt;
+};
+
 struct rtw_traffic_stats {
-	/* units in bytes */
+	/* updated lock-free from TX/RX, folded by the watch dog */
+	struct rtw_pcpu_traffic_stats __percpu *pcpu;
+	/* totals as of the last fold */
+	struct rtw_traffic_counters total;
+
+	/* units in bytes, during the last watch dog period */
 	u64 tx_unicast;
 	u64 rx_unicast;
 
-	/* count for packets */
+	/* count for packets, during the last watch dog period */
 	u64 tx_cnt;
 	u64 rx_cnt;
 
@@ -853,6 +926,46 @@ enum rtw_pwr_state {
 	RTW_ALL_ON	= 0xc,
 };
 
+enum rtw_lps_policy_type {
+	/* unicast packet count of the last watch dog round */
+	RTW_LPS_POLICY_TRAFFIC,
+	/* per-AC inter-packet gaps and idle timeouts */
+	RTW_LPS_POLICY_IDLE,
+
+	RTW_LPS_POLICY_NUM,
+};
+
+#define RTW_LPS_LEAVE_HIST_NUM	8
+
+struct rtw_lps_stats {
+	u32 enter_cnt;
+	u32 leave_cnt;
+	/* start of the current LPS period */
+	ktime_t enter_time;
+	u64 residency_us;
+	/* from the leave request to the firmware ack */
+	ktime_t leave_start;
+	u32 leave_last_us;
+	u32 leave_max_us;
+	u64 leave_sum_us;
+	u32 leave_hist[RTW_LPS_LEAVE_HIST_NUM];
+};
+
+struct rtw_lps_policy {
+	enum rtw_lps_policy_type type;
+	/* idle time before LPS, VO/VI use the longer rt_timeout_ms */
+	u32 idle_timeout_ms;
+	u32 rt_timeout_ms;
+	/* packets closer than this make an AC active */
+	u32 active_gap_ms;
+
+	/* updated from TX/RX without lock */
+	unsigned long last_active[IEEE80211_NUM_ACS];
+	unsigned long active_acs;
+
+	struct rtw_lps_stats stats;
+};
+
 struct rtw_lps_conf {
 	enum rtw_lps_mode mode;
 	enum rtw_lps_deep_mode deep_mode;
@@ -864,6 +977,10 @@ struct rtw_lps_conf {
 	u8 port_id;
 	bool sec_cam_backup;
 	bool pattern_cam_backup;
+	u8 leave_check_cnt;
+	/* CPWM before the pending enter request */
+	u8 cpwm_confirm;
+	struct rtw_lps_policy policy;
 };
 
 enum rtw_hw_key_type {
@@ -889,13 +1006,52 @@ struct rtw_sec_desc {
 	u32 total_cam_num;
 	struct rtw_cam_entry cam_table[RTW_MAX_SEC_CAM_NUM];
 	DECLARE_BITMAP(cam_map, RTW_MAX_SEC_CAM_NUM);
+
+	/* CAM words as last written, a word is trusted to match the hardware
+	 * only while its bit in cam_known is set
+	 */
+	u32 cam_shadow[RTW_MAX_SEC_CAM_NUM][RTW_SEC_CAM_WORD_NUM];
+	u8 cam_known[RTW_MAX_SEC_CAM_NUM];
+	struct {
+		u32 written;
+		u32 skipped;
+		u32 restored;
+	} cam_stats;
+};
+
+/* one slot per 6-bit tx report sequence number, see rtw_tx_report_enable() */
+#define RTW_TX_REPORT_SLOT_NUM	64
+#define RTW_TX_REPORT_SN_TO_SLOT(sn)	(((sn) >> 2) & (RTW_TX_REPORT_SLOT_NUM - 1))
+/* sequence numbers of reports host rate control asks for on its own */
+#define RTW_TX_REPORT_SN_HRC		BIT(7)
+
+struct rtw_tx_report_slot {
+	struct sk_buff *skb;
+	/* jiffies when the report is considered lost */
+	unsigned long expires;
+	ktime_t enqueued;
+	u8 sn;
+};
+
+struct rtw_tx_report_stats {
+	u32 matched;
+	u32 expired;
+	u32 overwritten;
+	u32 unmatched;
+	/* firmware report round-trip latency */
+	u64 latency_sum_us;
+	u32 latency_max_us;
+	u32 latency_last_us;
 };
 
 struct rtw_tx_report {
-	/* protect the tx report queue */
+	/* protect the tx report slots and stats */
 	spinlock_t q_lock;
-	struct sk_buff_head queue;
+	struct rtw_tx_report_slot slots[RTW_TX_REPORT_SLOT_NUM];
+	DECLARE_BITMAP(pending, RTW_TX_REPORT_SLOT_NUM);
+	struct rtw_tx_report_stats stats;
 	atomic_t sn;
+	atomic_t hrc_sn;
 	struct timer_list purge_timer;
 };
 
@@ -905,6 +1061,57 @@ struct rtw_ra_report {
 	u8 desc_rate;
 };
 
+enum rtw_agg_state {
+	RTW_AGG_IDLE,
+	RTW_AGG_REQUESTED,
+	RTW_AGG_STARTING,
+	RTW_AGG_OPERATIONAL,
+	RTW_AGG_BLOCKED,
+
+	RTW_AGG_STATE_NUM,
+};
+
+enum rtw_agg_event {
+	RTW_AGG_EV_REQUEST,
+	RTW_AGG_EV_REFUSED,
+	RTW_AGG_EV_BLOCKED,
+	RTW_AGG_EV_TX_START,
+	RTW_AGG_EV_TX_OPERATIONAL,
+	RTW_AGG_EV_TX_STOP,
+	RTW_AGG_EV_RX_START,
+	RTW_AGG_EV_RX_STOP,
+
+	RTW_AGG_EV_NUM,
+};
+
+/* BlockAck session telemetry of one TID, see rtw_agg_event(). It is
+ * updated from TX, ba_work and mac80211 without a common lock, plain
+ * counters that may lose an increment on a race are good enough here.
+ */
+struct rtw_agg_tid_stats {
+	u8 state;
+	bool rx_active;
+	u32 ev[RTW_AGG_EV_NUM];
+	u32 ampdu_frames;
+	u32 single_frames;
+};
+
+/* received A-MPDU lengths: 1, 2, 3-4, 5-8, ..., 65 and more MPDUs */
+#define RTW_RX_AGG_HIST_NUM	8
+
+/* An estimate, see rtw_rx_agg_account(). Only the RX path writes it, the
+ * debugfs reset races with it like the per TID counters do.
+ */
+struct rtw_rx_agg_hist {
+	u32 len[RTW_RX_AGG_HIST_NUM];
+	u16 run;
+	/* what the MPDUs of the current run have in common */
+	u8 ppdu_cnt;
+	u8 rate;
+	u8 ta[ETH_ALEN];
+	u32 tsf_low;
+};
+
 struct rtw_txq {
 	struct list_head list;
 	unsigned long flags;
@@ -912,6 +1119,20 @@ struct rtw_txq {
 
 DECLARE_EWMA(rssi, 10, 16);
 
+/* per-station data TX descriptor fields derived from the station caps,
+ * rebuilt by rtw_update_sta_info() under the mutex and published via RCU
+ */
+struct rtw_tx_tmpl {
+	struct rcu_head rcu;
+	u8 rate;
+	u8 rate_id;
+	u8 bw;
+	u8 ampdu_factor;
+	u8 ampdu_density;
+	bool stbc;
+	bool ldpc;
+};
+
 struct rtw_sta_info {
 	struct rtw_dev *rtwdev;
 	struct ieee80211_sta *sta;
@@ -936,6 +1157,13 @@ struct rtw_sta_info {
 	DECLARE_BITMAP(tid_ba, IEEE80211_NUM_TIDS);
 
 	struct rtw_ra_report ra_report;
+	/* protects hrc against the TX report path */
+	spinlock_t hrc_lock;
+	struct rtw_hrc hrc;
+
+	struct rtw_agg_tid_stats agg[IEEE80211_NUM_TIDS];
+
+	struct rtw_tx_tmpl __rcu *tx_tmpl;
 
 	bool use_cfg_mask;
 	struct cfg80211_bitrate_mask *mask;
@@ -971,6 +1199,22 @@ struct rtw_bf_info {
 	u8 cur_csi_rpt_rate;
 };
 
+enum rtw_bss_cck_state {
+	RTW_BSS_CCK_INVALID,
+	RTW_BSS_CCK_UNKNOWN,
+	RTW_BSS_CCK_SUPPORTED,
+	RTW_BSS_CCK_UNSUPPORTED,
+};
+
+/* CCK rates advertised by the BSS, looked up from the scan entry when the
+ * association changes so 8723BS SDIO TX does not parse IEs per frame
+ */
+struct rtw_bss_cck {
+	u8 bssid[ETH_ALEN];
+	u8 state;
+	u32 refresh_cnt;
+};
+
 struct rtw_vif {
 	enum rtw_net_type net_type;
 	u16 aid;
@@ -991,6 +1235,8 @@ struct rtw_vif {
 	struct rtw_traffic_stats stats;
 
 	struct rtw_bfee bfee;
+
+	struct rtw_bss_cck bss_cck;
 };
 
 struct rtw_regulatory {
@@ -1420,6 +1666,8 @@ struct rtw_chip_info {
 	u32 rf_base_addr[RTW_RF_PATH_MAX];
 	u32 rf_sipi_addr[RTW_RF_PATH_MAX];
 	const struct rtw_rf_sipi_addr *rf_sipi_read_addr;
+	const struct rtw_rf_shadow_def *rf_shadow_def;
+	u8 rf_shadow_def_num;
 	u8 fix_rf_phy_num;
 	const struct rtw_ltecoex_addr *ltecoex_addr;
 
@@ -1800,6 +2048,26 @@ struct rtw_pkt_count {
 DECLARE_EWMA(evm, 10, 4);
 DECLARE_EWMA(snr, 10, 4);
 
+#define RTW_RX_PHY_BATCH_MAX	256
+
+/* PHY status samples collected by the RX path and merged into dm_info
+ * once per RX batch, see rtw_rx_phy_stat_flush()
+ */
+struct rtw_rx_phy_batch {
+	struct rtw_pkt_count pkt_count;
+	DECLARE_BITMAP(rates, DESC_RATE_MAX);
+	u16 pkt_num;
+	u8 last_rate;
+
+	u32 evm_sum[RTW_EVM_NUM];
+	u16 evm_num[RTW_EVM_NUM];
+	s32 snr_sum[RTW_SNR_NUM];
+	u16 snr_num[RTW_SNR_NUM];
+
+	/* data frames seen since the last sampled one */
+	u32 skip_cnt;
+};
+
 struct rtw_iqk_info {
 	bool done;
 	struct {
@@ -1810,6 +2078,34 @@ struct rtw_iqk_info {
 	} result;
 };
 
+#define RTW_IQK_CACHE_NUM		8
+#define RTW_IQK_CACHE_RESULT_NR		8
+/* thermal meter units per cache bucket */
+#define RTW_IQK_CACHE_THERMAL_STEP	4
+
+struct rtw_iqk_cache_entry {
+	bool valid;
+	u8 ch_group;
+	u8 bw;
+	u8 thermal;
+	s32 result[RTW_IQK_CACHE_RESULT_NR];
+	/* how long the full calibration behind this entry took */
+	u32 cost_us;
+	unsigned long last_use;
+};
+
+/* IQK results keyed by (channel group, bandwidth, thermal bucket),
+ * dropped when the chip is powered off
+ */
+struct rtw_iqk_cache {
+	struct rtw_iqk_cache_entry ent[RTW_IQK_CACHE_NUM];
+	u32 hit;
+	u32 miss;
+	u32 forced;
+	u32 flush;
+	u64 saved_us;
+};
+
 enum rtw_rf_band {
 	RF_BAND_2G_CCK,
 	RF_BAND_2G_OFDM,
@@ -1937,6 +2233,7 @@ struct rtw_dm_info {
 
 	u32 dm_flags; /* enum rtw_dm_cap */
 	struct rtw_iqk_info iqk;
+	struct rtw_iqk_cache iqk_cache;
 	struct rtw_gapk_info gapk;
 	bool is_bt_iqk_timeout;
 
@@ -2118,6 +2415,116 @@ struct rtw_sar {
 	union rtw_sar_cfg cfg[RTW_RF_PATH_MAX][RTW_RATE_SECTION_NUM];
 };
 
+/* enough for two paths of VHT 2SS rates, four rates per register */
+#define RTW_TXAGC_SHADOW_NUM	48
+
+struct rtw_txagc_count {
+	u32 writes;
+	u32 skips;
+	u32 reads;
+};
+
+/* last image written to each TXAGC register, see rtw_phy_txagc_write() */
+struct rtw_txagc_shadow {
+	u32 addr[RTW_TXAGC_SHADOW_NUM];
+	u32 val[RTW_TXAGC_SHADOW_NUM];
+	u8 num;
+
+	struct rtw_txagc_count total;
+	/* what the last rtw_set_channel() cost */
+	struct rtw_txagc_count last_switch;
+};
+
+#define RTW_RF_SHADOW_NUM	8
+
+/* last value written to each rtw_chip_info::rf_shadow_def register */
+struct rtw_rf_shadow {
+	u32 val[RTW_RF_PATH_MAX][RTW_RF_SHADOW_NUM];
+	u8 valid[RTW_RF_PATH_MAX];
+
+	u32 hit;
+	u32 miss;
+	u32 invalidate;
+};
+
+#define RTW_CHAN_IMG_NUM	12
+
+enum rtw_chan_reg_type {
+	RTW_CHAN_REG_8,
+	RTW_CHAN_REG_32,
+	RTW_CHAN_REG_RF,
+};
+
+/* one register field programmed by set_channel, @mask 0 leaves a slot that
+ * this channel setting does not touch
+ */
+struct rtw_chan_reg {
+	u8 type;
+	u8 path;
+	u32 addr;
+	u32 mask;
+	u32 val;
+};
+
+/* the fields a chip programs for a channel, in a fixed slot order */
+struct rtw_chan_img {
+	struct rtw_chan_reg reg[RTW_CHAN_IMG_NUM];
+	u8 num;
+};
+
+/* log2 buckets of 128us, the last one is open ended */
+#define RTW_CHAN_SW_HIST_NUM	8
+#define RTW_CHAN_SW_PAIR_NUM	32
+
+struct rtw_chan_sw_pair {
+	u8 from;
+	u8 to;
+	u32 count;
+	u32 total_us;
+	u32 max_us;
+};
+
+struct rtw_chan_delta {
+	/* cleared whenever the hardware may not hold @cur anymore */
+	bool valid;
+	struct rtw_chan_img cur;
+
+	u32 full;
+	u32 delta;
+	u32 writes;
+	u32 skips;
+
+	u32 hist[RTW_CHAN_SW_HIST_NUM];
+	struct rtw_chan_sw_pair pair[RTW_CHAN_SW_PAIR_NUM];
+	/* switches between pairs that found no free slot */
+	u32 pair_overflow;
+};
+
+/* one entry per channel of a full 2.4G + 5G scan at a single bandwidth */
+#define RTW_TX_PWR_CACHE_NUM	48
+
+/* tx_pwr_tbl rows computed by rtw_phy_set_tx_power_level() for one key */
+struct rtw_tx_pwr_cache_entry {
+	bool valid;
+	u8 band;
+	u8 channel;
+	u8 primary;
+	u8 bw;
+	u8 regd;
+	u8 sar_band;
+	s8 remnant_cck;
+	s8 remnant_ofdm[RTW_RF_PATH_MAX];
+	unsigned long last_use;
+	s8 tbl[RTW_RF_PATH_MAX][DESC_RATE_MAX];
+};
+
+struct rtw_tx_pwr_cache {
+	struct rtw_tx_pwr_cache_entry ent[RTW_TX_PWR_CACHE_NUM];
+	u32 hit;
+	u32 miss;
+	u32 flush;
+};
+
 struct rtw_hal {
 	u32 rcr;
 
@@ -2172,6 +2579,10 @@ struct rtw_hal {
 			  [RTW_MAX_CHANNEL_NUM_5G];
 	s8 tx_pwr_tbl[RTW_RF_PATH_MAX]
 		     [DESC_RATE_MAX];
+	struct rtw_txagc_shadow txagc;
+	struct rtw_tx_pwr_cache tx_pwr_cache;
+	struct rtw_chan_delta chan_delta;
+	struct rtw_rf_shadow rf_shadow;
 
 	enum rtw_sar_bands sar_band;
 	struct rtw_sar sar;
@@ -2227,6 +2638,253 @@ struct rtw_auth_sync {
 	u32 seen_count;
 };
 
+#define RTW_RX_MATCH_HASH_BITS	6
+#define RTW_RX_MATCH_HASH_SIZE	BIT(RTW_RX_MATCH_HASH_BITS)
+#define RTW_RX_MATCH_HASH_EMPTY	0xff
+
+struct rtw_rx_match_vif {
+	u8 bssid[ETH_ALEN];
+	u8 addr[ETH_ALEN];
+	struct rtw_vif *rtwvif;
+};
+
+struct rtw_rx_match_sta {
+	u8 addr[ETH_ALEN];
+	struct rtw_vif *rtwvif;
+	struct rtw_sta_info *si;
+};
+
+/* RCU published snapshot of (BSSID, own address) -> vif and
+ * (peer address, vif) -> station used by RX statistics
+ */
+struct rtw_rx_match_table {
+	struct rcu_head rcu;
+	struct rtw_rx_match_vif vifs[RTW_PORT_NUM];
+	struct rtw_rx_match_sta stas[RTW_MAX_MAC_ID_NUM];
+	u8 sta_hash[RTW_RX_MATCH_HASH_SIZE];
+	u8 vif_num;
+	u8 sta_num;
+};
+
+/* periodic jobs of the watch dog, each one is either run or skipped in
+ * every watch dog round
+ */
+enum rtw_watch_dog_task {
+	RTW_WATCH_DOG_TRAFFIC,
+	RTW_WATCH_DOG_COEX,
+	RTW_WATCH_DOG_DIG,
+	RTW_WATCH_DOG_CCK_PD,
+	RTW_WATCH_DOG_RA,
+	RTW_WATCH_DOG_PWR_TRACK,
+	RTW_WATCH_DOG_TRACK,
+
+	RTW_WATCH_DOG_TASK_NUM,
+};
+
+/* idle rounds between two false alarm reads, DIG and CCK PD share them */
+#define RTW_WATCH_DOG_FA_PERIOD		2
+
+struct rtw_watch_dog_task_stats {
+	u32 run;
+	u32 skip;
+};
+
+struct rtw_watch_dog_sched {
+	/* BIT(enum rtw_watch_dog_task) of the tasks due in this round */
+	unsigned long due;
+	struct rtw_watch_dog_task_stats stats[RTW_WATCH_DOG_TASK_NUM];
+	/* rounds that had to wake the chip up */
+	u32 lps_leave_cnt;
+
+	/* watch dog round of the last false alarm counter read */
+	u32 fa_round;
+
+	/* inputs of the last DIG and CCK PD runs */
+	u32 dig_fa;
+	u8 dig_min_rssi;
+	bool dig_linked;
+	u32 cck_fa;
+	u8 cck_min_rssi;
+	u8 cck_igi;
+	bool cck_assoc;
+
+	/* thermal meter moved at the last power tracking */
+	bool thermal_changed;
+
+	/* the DM half of this round waits for the LPS leave ack */
+	bool dm_pending;
+	/* traffic accounting of this round, for the DM half */
+	bool ps_active;
+	u32 tx_unicast_mbps;
+	u32 rx_unicast_mbps;
+	int received_beacons;
+};
+
+#define RTW_H2C_BOX_NUM		4
+#define RTW_H2C_QUEUE_LEN	16
+#define RTW_H2C_LAT_NUM		16
+/* four H2C_PKT_SIZE packets per HCI transfer */
+#define RTW_H2C_PKT_BATCH_SIZE	128
+#define RTW_H2C_PKT_BATCH_DEADLINE_MS	2
+
+enum rtw_h2c_pkt_flush {
+	RTW_H2C_PKT_FLUSH_SIZE,
+	RTW_H2C_PKT_FLUSH_BARRIER,
+	RTW_H2C_PKT_FLUSH_DEADLINE,
+
+	RTW_H2C_PKT_FLUSH_NUM,
+};
+
+/* H2C waiting in rtwdev->h2c.queue for a free mail box */
+struct rtw_h2c_entry {
+	u32 w0;
+	u32 w1;
+	ktime_t submit;
+};
+
+/* submit to mail box write latency of one H2C command id */
+struct rtw_h2c_lat {
+	u8 cmd_id;
+	u32 cnt;
+	u64 sum_us;
+	u32 max_us;
+};
+
+struct rtw_h2c_stats {
+	u32 queued;
+	u32 direct;
+	u32 coalesced;
+	u32 max_depth;
+	u32 hmetfr_reads;
+	u32 box_waits;
+	u32 fail;
+	struct rtw_h2c_lat lat[RTW_H2C_LAT_NUM];
+
+	u32 pkt_sent;
+	u32 pkt_xfers;
+	u32 pkt_flush[RTW_H2C_PKT_FLUSH_NUM];
+};
+
+/* where a C2H event is handled, see rtw_fw_c2h_cmd_rx_irqsafe() */
+enum rtw_c2h_class {
+	RTW_C2H_CLASS_WORK,	/* c2h_work, under rtwdev->mutex */
+	RTW_C2H_CLASS_HIPRI,	/* c2h_hipri_work on tx_wq, no mutex */
+	RTW_C2H_CLASS_ATOMIC,	/* right away in the RX path */
+
+	RTW_C2H_CLASS_NUM,
+};
+
+#define RTW_C2H_STATS_NUM	16
+
+/* rx to handler latency of one C2H id (and sub id for C2H_HALMAC) */
+struct rtw_c2h_stats_entry {
+	u8 id;
+	u8 sub_id;
+	u8 class;
+	u32 cnt;
+	u64 sum_us;
+	u32 max_us;
+};
+
+struct rtw_c2h_stats {
+	spinlock_t lock;
+	u32 class_cnt[RTW_C2H_CLASS_NUM];
+	u32 unhandled;
+	struct rtw_c2h_stats_entry ent[RTW_C2H_STATS_NUM];
+};
+
+enum rtw_boot_kind {
+	RTW_BOOT_PROBE,
+	RTW_BOOT_POWER_ON,
+	RTW_BOOT_IPS_LEAVE,
+
+	RTW_BOOT_KIND_NUM,
+};
+
+enum rtw_boot_stage {
+	RTW_BOOT_STAGE_CORE_INIT,
+	RTW_BOOT_STAGE_HCI_PROBE,
+	RTW_BOOT_STAGE_CHIP_PARAM,
+	RTW_BOOT_STAGE_EFUSE,
+	RTW_BOOT_STAGE_BOARD_INFO,
+	RTW_BOOT_STAGE_HCI_SETUP,
+	RTW_BOOT_STAGE_MAC_POWER_ON,
+	RTW_BOOT_STAGE_FW_WAIT,
+	RTW_BOOT_STAGE_FW_DOWNLOAD,
+	RTW_BOOT_STAGE_MAC_INIT,
+	RTW_BOOT_STAGE_PHY_SET_PARAM,
+	RTW_BOOT_STAGE_MAC_POSTINIT,
+	RTW_BOOT_STAGE_HCI_START,
+	RTW_BOOT_STAGE_RFK_COEX,
+	RTW_BOOT_STAGE_IPS_RESTORE,
+
+	RTW_BOOT_STAGE_NUM,
+};
+
+#define RTW_BOOT_PROFILE_NUM	8
+
+struct rtw_boot_stage_rec {
+	u32 us;
+	u32 reads;
+	u32 writes;
+	u32 xfers;
+};
+
+struct rtw_boot_rec {
+	u8 kind;
+	int ret;
+	u32 total_us;
+	struct rtw_boot_stage_rec stage[RTW_BOOT_STAGE_NUM];
+};
+
+/* the last RTW_BOOT_PROFILE_NUM bring-ups, see rtw_boot_begin() */
+struct rtw_boot_profile {
+	struct rtw_boot_rec ring[RTW_BOOT_PROFILE_NUM];
+	u8 head;
+	u8 cnt;
+
+	/* the bring-up in progress */
+	struct rtw_boot_rec cur;
+	u8 depth;
+	ktime_t start;
+	ktime_t mark;
+	u32 reads;
+	u32 writes;
+	u32 xfers;
+};
+
+enum rtw_ips_wake {
+	RTW_IPS_WAKE_FULL,
+	RTW_IPS_WAKE_SOFT,
+	RTW_IPS_WAKE_RETENTION,
+	RTW_IPS_WAKE_FALLBACK,
+
+	RTW_IPS_WAKE_NUM,
+};
+
+struct rtw_ips_wake_stat {
+	u32 cnt;
+	u32 last_us;
+	u32 max_us;
+	u64 total_us;
+};
+
+/* what rtw_enter_ips() parked when the card stays powered in IPS */
+struct rtw_ips_state {
+	u8 txpause;
+	u32 rf_mode[RTW_RF_PATH_MAX];
+
+	struct rtw_ips_wake_stat wake[RTW_IPS_WAKE_NUM];
+};
+
+/* preallocated snapshots for rtw_iterate_stas()/rtw_iterate_vifs() */
+struct rtw_iter_snapshot {
+	struct ieee80211_sta *stas[RTW_MAX_MAC_ID_NUM];
+	struct ieee80211_vif *vifs[RTW_PORT_NUM];
+	bool stas_busy;
+	bool vifs_busy;
+};
+
 struct rtw_dev {
 	struct ieee80211_hw *hw;
 	struct device *dev;
@@ -2250,16 +2908,29 @@ struct rtw_dev {
 
 	/* ensures exclusive access from mac80211 callbacks */
 	struct mutex mutex;
+	/* protected by mutex */
+	struct rtw_iter_snapshot iter_snapshot;
+	struct rtw_rx_match_table __rcu *rx_match;
+	/* only touched by the HCI RX path */
+	struct rtw_rx_phy_batch rx_phy_batch;
 
 	/* watch dog every 2 sec */
 	struct delayed_work watch_dog_work;
+	struct work_struct watch_dog_dm_work;
 	u32 watch_dog_cnt;
+	/* protected by mutex */
+	struct rtw_watch_dog_sched watch_dog_sched;
 
 	struct list_head rsvd_page_list;
 
 	/* c2h cmd queue & handler work */
 	struct sk_buff_head c2h_queue;
 	struct work_struct c2h_work;
+	struct sk_buff_head c2h_hipri_queue;
+	struct work_struct c2h_hipri_work;
+	struct rtw_c2h_stats c2h_stats;
+	struct rtw_boot_profile boot_profile;
+	struct rtw_ips_state ips;
 	struct work_struct ips_work;
 	struct work_struct fw_recovery_work;
 	struct work_struct update_beacon_work;
@@ -2270,20 +2941,43 @@ struct rtw_dev {
 	struct workqueue_struct *tx_wq;
 	struct work_struct tx_work;
 	struct work_struct ba_work;
+	/* per hardware queue, protected by txq_lock */
+	struct rtw_tx_batch tx_batch[RTK_MAX_TX_QUEUE_NUM];
 
 	struct rtw_tx_report tx_report;
+	/* rate picked by hrc.c instead of the firmware */
+	bool host_rc;
+	struct rtw_rx_agg_hist rx_agg;
 
 	struct {
 		/* indicate the mail box to use with fw */
 		u8 last_box_num;
+		/* HMETFR bits as of the last read plus boxes written since */
+		u8 box_busy;
 		u32 seq;
+
+		/* coalescable commands, drained by work under rtwdev->mutex */
+		struct rtw_h2c_entry queue[RTW_H2C_QUEUE_LEN];
+		u8 queue_head;
+		u8 queue_len;
+		struct work_struct work;
+		struct rtw_h2c_stats stats;
+
+		/* H2C packets waiting to go out in one HCI transfer */
+		u8 pkt_buf[RTW_H2C_PKT_BATCH_SIZE];
+		u32 pkt_len;
+		struct delayed_work pkt_work;
 	} h2c;
 
 	/* lps power state & handler work */
 	struct rtw_lps_conf lps_conf;
 	bool ps_enabled;
 	bool beacon_loss;
-	struct completion lps_leave_check;
+	/* completes a leave request, see rtw_lps_leave_done() */
+	struct delayed_work lps_leave_work;
+	wait_queue_head_t lps_leave_wait;
+	/* frames from rtw_tx() held until the leave is done */
+	struct sk_buff_head lps_tx_queue;
 
 	struct rtw_debugfs *debugfs;
 
@@ -2346,6 +3040,57 @@ static inline void rtw_chip_efuse_grant_off(struct rtw_dev *rtwdev)
 		rtwdev->chip->ops->efuse_grant(rtwdev, false);
 }
 
+static inline enum rtw_rate_class rtw_desc_rate_class(u8 rate)
+{
+	if (rate <= DESC_RATE11M)
+		return RTW_RATE_CLASS_CCK;
+	if (rate <= DESC_RATE54M)
+		return RTW_RATE_CLASS_OFDM;
+	if (rate <= DESC_RATEMCS31)
+		return RTW_RATE_CLASS_HT;
+	return RTW_RATE_CLASS_VHT;
+}
+
+/* returns with the per-CPU counters of this CPU open for update */
+static inline struct rtw_pcpu_traffic_stats *
+rtw_traffic_stats_begin(struct rtw_dev *rtwdev, unsigned long *flags)
+{
+	struct rtw_pcpu_traffic_stats *pcpu;
+
+	/* TX and RX may update from different contexts on the same CPU */
+	local_irq_save(*flags);
+	pcpu = this_cpu_ptr(rtwdev->stats.pcpu);
+	u64_stats_update_begin(&pcpu->syncp);
+
+	return pcpu;
+}
+
+static inline void rtw_traffic_stats_end(struct rtw_pcpu_traffic_stats *pcpu,
+					 unsigned long flags)
+{
+	u64_stats_update_end(&pcpu->syncp);
+	local_irq_restore(flags);
+}
+
+static inline bool rtw_watch_dog_task_due(struct rtw_dev *rtwdev,
+					  enum rtw_watch_dog_task task)
+{
+	return test_bit(task, &rtwdev->watch_dog_sched.due);
+}
+
+static inline void rtw_watch_dog_task_count(struct rtw_dev *rtwdev,
+					    enum rtw_watch_dog_task task,
+					    bool run)
+{
+	struct rtw_watch_dog_task_stats *stats;
+
+	stats = &rtwdev->watch_dog_sched.stats[task];
+	if (run)
+		stats->run++;
+	else
+		stats->skip++;
+}
+
 static inline bool rtw_chip_wcpu_8051(struct rtw_dev *rtwdev)
 {
 	return rtwdev->chip->wlan_cpu == RTW_WCPU_8051;
@@ -2429,6 +3174,8 @@ void rtw_tx_report_purge_timer(struct timer_list *t);
 #endif
 void rtw_update_sta_info(struct rtw_dev *rtwdev, struct rtw_sta_info *si,
 			 bool reset_ra_mask);
+void rtw_traffic_stats_sum(struct rtw_dev *rtwdev,
+			   struct rtw_traffic_counters *sum);
 void rtw_core_scan_start(struct rtw_dev *rtwdev, struct rtw_vif *rtwvif,
 			 const u8 *mac_addr, bool hw_scan);
 void rtw_core_scan_complete(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
@@ -2451,6 +3198,9 @@ void rtw_sta_remove(struct rtw_dev *rtwdev, struct ieee80211_sta *sta,
 void rtw_fw_recovery(struct rtw_dev *rtwdev);
 int rtw_wait_firmware_completion(struct rtw_dev *rtwdev);
 int rtw_power_on(struct rtw_dev *rtwdev);
+void rtw_boot_begin(struct rtw_dev *rtwdev, enum rtw_boot_kind kind);
+void rtw_boot_mark(struct rtw_dev *rtwdev, enum rtw_boot_stage stage);
+void rtw_boot_end(struct rtw_dev *rtwdev, int ret);
 void rtw_core_fw_scan_notify(struct rtw_dev *rtwdev, bool start);
 int rtw_dump_fw(struct rtw_dev *rtwdev, const u32 ocp_src, u32 size,
 		u32 fwcd_item);
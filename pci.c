@@ -1086,8 +1086,10 @@ static u32 rtw_pci_rx_napi(struct rtw_dev *rtwdev, struct rtw_pci *rtwpci,
 		 */
 		new_len = pkt_stat.pkt_len + pkt_offset;
 		new = dev_alloc_skb(new_len);
-		if (WARN_ONCE(!new, "rx routine starvation\n"))
+		if (WARN_ONCE(!new, "rx routine starvation\n")) {
+			rtw_rx_stats_drop(rtwdev);
 			goto next_rp;
+		}
 
 		/* put the DMA data including rx_desc from phy to new skb */
 		skb_put_data(new, skb->data, new_len);
@@ -1099,8 +1101,8 @@ static u32 rtw_pci_rx_napi(struct rtw_dev *rtwdev, struct rtw_pci *rtwpci,
 			skb_pull(new, pkt_offset);
 
 			rtw_update_rx_freq_for_invalid(rtwdev, new, &rx_status, &pkt_stat);
-			rtw_rx_stats(rtwdev, pkt_stat.vif, new);
 			memcpy(new->cb, &rx_status, sizeof(rx_status));
+			rtw_rx_stats(rtwdev, pkt_stat.vif, new);
 			ieee80211_rx_napi(rtwdev->hw, NULL, new, napi);
 			rx_done++;
 		}
@@ -1121,6 +1123,7 @@ next_rp:
 	 */
 	ring->r.wp = cur_rp;
 	rtw_write16(rtwdev, RTK_PCI_RXBD_IDX_MPDUQ, ring->r.rp);
+	rtw_rx_phy_stat_flush(rtwdev);
 
 	return rx_done;
 }
@@ -370,8 +370,10 @@ static u32 rtw_pci_old_rx_napi(struct rtw_dev *rtwdev,
 
 		new_len = pkt_stat.pkt_len + pkt_offset;
 		new = dev_alloc_skb(new_len);
-		if (WARN_ONCE(!new, "rx routine starvation\n"))
+		if (WARN_ONCE(!new, "rx routine starvation\n")) {
+			rtw_rx_stats_drop(rtwdev);
 			goto next_rp;
+		}
 
 		skb_put_data(new, skb->data, new_len);
 
@@ -381,8 +383,8 @@ static u32 rtw_pci_old_rx_napi(struct rtw_dev *rtwdev,
 			/* remove phy_status */
 			skb_pull(new, pkt_offset);
 
-			rtw_rx_stats(rtwdev, pkt_stat.vif, new);
 			memcpy(new->cb, &rx_status, sizeof(rx_status));
+			rtw_rx_stats(rtwdev, pkt_stat.vif, new);
 			ieee80211_rx_napi(rtwdev->hw, NULL, new, &rtwpci->napi);
 			rx_done++;
 		}
@@ -409,6 +411,7 @@ next_rp:
 	}
 
 	ring->r.rp = cur_rp;
+	rtw_rx_phy_stat_flush(rtwdev);
 
 	return rx_done;
 }
@@ -286,8 +286,25 @@ void rtw_phy_dig_write(struct rtw_dev *rtwdev, u8 igi)
 static void rtw_phy_stat_false_alarm(struct rtw_dev *rtwdev)
 {
 	const struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	u32 rounds;
 
 	chip->ops->false_alarm_statistics(rtwdev);
+
+	/* The counters are cleared on read, but the DIG and CCK PD thresholds
+	 * are per watch dog round. Idle rounds skip the read, so bring the
+	 * counts back to one round.
+	 */
+	rounds = clamp_t(u32, rtwdev->watch_dog_cnt - sched->fa_round, 1,
+			 RTW_WATCH_DOG_FA_PERIOD);
+	sched->fa_round = rtwdev->watch_dog_cnt;
+	if (rounds == 1)
+		return;
+
+	dm_info->cck_fa_cnt /= rounds;
+	dm_info->ofdm_fa_cnt /= rounds;
+	dm_info->total_fa_cnt /= rounds;
 }
 
 #define RA_FLOOR_TABLE_SIZE	7
@@ -316,6 +333,7 @@ static u8 rtw_phy_get_rssi_level(u8 old_level, u8 rssi)
 struct rtw_phy_stat_iter_data {
 	struct rtw_dev *rtwdev;
 	u8 min_rssi;
+	bool report;
 };
 
 static void rtw_phy_stat_rssi_iter(void *data, struct ieee80211_sta *sta)
@@ -328,7 +346,8 @@ static void rtw_phy_stat_rssi_iter(void *data, struct ieee80211_sta *sta)
 	rssi = ewma_rssi_read(&si->avg_rssi);
 	si->rssi_level = rtw_phy_get_rssi_level(si->rssi_level, rssi);
 
-	rtw_fw_send_rssi_info(rtwdev, si);
+	if (iter_data->report)
+		rtw_fw_send_rssi_info(rtwdev, si);
 
 	iter_data->min_rssi = min_t(u8, rssi, iter_data->min_rssi);
 }
@@ -340,6 +359,8 @@ static void rtw_phy_stat_rssi(struct rtw_dev *rtwdev)
 
 	data.rtwdev = rtwdev;
 	data.min_rssi = U8_MAX;
+	/* a round that lets the chip sleep does not wake it for the report */
+	data.report = !test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags);
 	rtw_iterate_stas(rtwdev, rtw_phy_stat_rssi_iter, &data);
 
 	dm_info->pre_min_rssi = dm_info->min_rssi;
@@ -354,13 +375,6 @@ static void rtw_phy_stat_rate_cnt(struct rtw_dev *rtwdev)
 	memset(&dm_info->cur_pkt_count, 0, sizeof(dm_info->cur_pkt_count));
 }
 
-static void rtw_phy_statistics(struct rtw_dev *rtwdev)
-{
-	rtw_phy_stat_rssi(rtwdev);
-	rtw_phy_stat_false_alarm(rtwdev);
-	rtw_phy_stat_rate_cnt(rtwdev);
-}
-
 #define DIG_PERF_FA_TH_LOW			250
 #define DIG_PERF_FA_TH_HIGH			500
 #define DIG_PERF_FA_TH_EXTRA_HIGH		750
@@ -847,22 +861,138 @@ static void rtw_phy_ra_track(struct rtw_dev *rtwdev)
 	rtw_phy_rrsr_update(rtwdev);
 }
 
-void rtw_phy_dynamic_mechanism(struct rtw_dev *rtwdev)
+/* DIG would compute the same IGI again: same inputs as in its last run,
+ * and that run did not move the IGI
+ */
+static bool rtw_phy_dig_settled(struct rtw_dev *rtwdev)
 {
-	/* for further calculation */
-	rtw_phy_statistics(rtwdev);
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	return dm_info->total_fa_cnt == sched->dig_fa &&
+	       dm_info->min_rssi == sched->dig_min_rssi &&
+	       !!rtwdev->sta_cnt == sched->dig_linked &&
+	       dm_info->igi_history[0] == dm_info->igi_history[1] &&
+	       !rtwdev->beacon_loss;
+}
+
+static void rtw_phy_dm_dig(struct rtw_dev *rtwdev)
+{
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	if (rtw_phy_dig_settled(rtwdev)) {
+		rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_DIG, false);
+		return;
+	}
+
+	sched->dig_fa = dm_info->total_fa_cnt;
+	sched->dig_min_rssi = dm_info->min_rssi;
+	sched->dig_linked = !!rtwdev->sta_cnt;
+
 	rtw_phy_dig(rtwdev);
+	rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_DIG, true);
+}
+
+static bool rtw_phy_cck_pd_settled(struct rtw_dev *rtwdev)
+{
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	if (rtwdev->hal.current_band_type != RTW_BAND_2G)
+		return true;
+
+	return dm_info->cck_fa_cnt == sched->cck_fa &&
+	       dm_info->cck_fa_avg == dm_info->cck_fa_cnt &&
+	       dm_info->min_rssi == sched->cck_min_rssi &&
+	       dm_info->igi_history[0] == sched->cck_igi &&
+	       rtw_is_assoc(rtwdev) == sched->cck_assoc;
+}
+
+static void rtw_phy_dm_cck_pd(struct rtw_dev *rtwdev)
+{
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	if (rtw_phy_cck_pd_settled(rtwdev)) {
+		rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_CCK_PD, false);
+		return;
+	}
+
+	sched->cck_fa = dm_info->cck_fa_cnt;
+	sched->cck_min_rssi = dm_info->min_rssi;
+	sched->cck_igi = dm_info->igi_history[0];
+	sched->cck_assoc = rtw_is_assoc(rtwdev);
+
 	rtw_phy_cck_pd(rtwdev);
-	rtw_phy_ra_track(rtwdev);
+	rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_CCK_PD, true);
+}
+
+static void rtw_phy_dm_pwr_track(struct rtw_dev *rtwdev)
+{
+	struct rtw_watch_dog_sched *sched = &rtwdev->watch_dog_sched;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	u8 thermal = dm_info->thermal_avg[RF_PATH_A];
+
+	rtw_phy_pwr_track(rtwdev);
+	rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_PWR_TRACK, true);
+
+	/* trigger only rounds leave the last result in place */
+	if (!dm_info->pwr_trk_triggered)
+		sched->thermal_changed =
+			thermal != dm_info->thermal_avg[RF_PATH_A];
+}
+
+bool rtw_phy_dm_track_supported(struct rtw_dev *rtwdev)
+{
+	const struct rtw_chip_info *chip = rtwdev->chip;
+
+	return chip->path_div_supported || chip->ops->cfo_track ||
+	       chip->ops->dpk_track || chip->ops->adaptivity ||
+	       rtw_fw_feature_check(&rtwdev->fw, FW_FEATURE_ADAPTIVITY);
+}
+
+static void rtw_phy_dm_track(struct rtw_dev *rtwdev)
+{
 	rtw_phy_tx_path_diversity(rtwdev);
 	rtw_phy_cfo_track(rtwdev);
 	rtw_phy_dpk_track(rtwdev);
-	rtw_phy_pwr_track(rtwdev);
 
 	if (rtw_fw_feature_check(&rtwdev->fw, FW_FEATURE_ADAPTIVITY))
 		rtw_fw_adaptivity(rtwdev);
 	else
 		rtw_phy_adaptivity(rtwdev);
+
+	rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_TRACK, true);
+}
+
+/* runs the dynamic mechanism tasks marked due by the watch dog, tasks
+ * whose inputs did not change since their last run are skipped
+ */
+void rtw_phy_dynamic_mechanism(struct rtw_dev *rtwdev)
+{
+	bool dig = rtw_watch_dog_task_due(rtwdev, RTW_WATCH_DOG_DIG);
+	bool cck_pd = rtw_watch_dog_task_due(rtwdev, RTW_WATCH_DOG_CCK_PD);
+	bool ra = rtw_watch_dog_task_due(rtwdev, RTW_WATCH_DOG_RA);
+
+	/* for further calculation */
+	rtw_phy_stat_rssi(rtwdev);
+	if (dig || cck_pd)
+		rtw_phy_stat_false_alarm(rtwdev);
+	rtw_phy_stat_rate_cnt(rtwdev);
+
+	if (dig)
+		rtw_phy_dm_dig(rtwdev);
+	if (cck_pd)
+		rtw_phy_dm_cck_pd(rtwdev);
+	if (ra) {
+		rtw_phy_ra_track(rtwdev);
+		rtw_watch_dog_task_count(rtwdev, RTW_WATCH_DOG_RA, true);
+	}
+	if (rtw_watch_dog_task_due(rtwdev, RTW_WATCH_DOG_PWR_TRACK))
+		rtw_phy_dm_pwr_track(rtwdev);
+	if (rtw_watch_dog_task_due(rtwdev, RTW_WATCH_DOG_TRACK))
+		rtw_phy_dm_track(rtwdev);
 }
 
 #define FRAC_BITS 3
@@ -1050,15 +1180,57 @@ u32 rtw_phy_read_rf_sipi(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 }
 EXPORT_SYMBOL(rtw_phy_read_rf_sipi);
 
+static int rtw_phy_rf_shadow_slot(struct rtw_dev *rtwdev, u32 addr)
+{
+	const struct rtw_chip_info *chip = rtwdev->chip;
+	int i;
+
+	for (i = 0; i < chip->rf_shadow_def_num; i++)
+		if (chip->rf_shadow_def[i].addr == addr)
+			return i;
+
+	return -1;
+}
+
+static void rtw_phy_rf_shadow_update(struct rtw_dev *rtwdev,
+				     enum rtw_rf_path rf_path, int slot,
+				     u32 data)
+{
+	const struct rtw_rf_shadow_def *def = &rtwdev->chip->rf_shadow_def[slot];
+	struct rtw_rf_shadow *shadow = &rtwdev->hal.rf_shadow;
+
+	if (data & def->self_clear) {
+		shadow->valid[rf_path] &= ~BIT(slot);
+		return;
+	}
+
+	shadow->val[rf_path][slot] = data & RFREG_MASK;
+	shadow->valid[rf_path] |= BIT(slot);
+}
+
+/* forget every RF value written so far, the RF may have changed behind the
+ * host: power cycles, calibration engines or firmware owned states
+ */
+void rtw_phy_rf_shadow_invalidate(struct rtw_dev *rtwdev)
+{
+	struct rtw_rf_shadow *shadow = &rtwdev->hal.rf_shadow;
+
+	memset(shadow->valid, 0, sizeof(shadow->valid));
+	shadow->invalidate++;
+}
+EXPORT_SYMBOL(rtw_phy_rf_shadow_invalidate);
+
 bool rtw_phy_write_rf_reg_sipi(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 			       u32 addr, u32 mask, u32 data)
 {
 	struct rtw_hal *hal = &rtwdev->hal;
+	struct rtw_rf_shadow *shadow = &hal->rf_shadow;
 	const struct rtw_chip_info *chip = rtwdev->chip;
 	const u32 *sipi_addr = chip->rf_sipi_addr;
 	u32 data_and_addr;
 	u32 old_data = 0;
 	u32 shift;
+	int slot;
 
 	if (rf_path >= hal->rf_phy_num) {
 		rtw_err(rtwdev, "unsupported rf path (%d)\n", rf_path);
@@ -1067,9 +1239,19 @@ bool rtw_phy_write_rf_reg_sipi(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 
 	addr &= 0xff;
 	mask &= RFREG_MASK;
+	slot = rtw_phy_rf_shadow_slot(rtwdev, addr);
 
 	if (mask != RFREG_MASK) {
-		old_data = chip->ops->read_rf(rtwdev, rf_path, addr, RFREG_MASK);
+		if (slot >= 0 && shadow->valid[rf_path] & BIT(slot)) {
+			/* no SIPI readback, the host wrote this value */
+			old_data = shadow->val[rf_path][slot];
+			shadow->hit++;
+		} else {
+			old_data = chip->ops->read_rf(rtwdev, rf_path, addr,
+						      RFREG_MASK);
+			if (slot >= 0)
+				shadow->miss++;
+		}
 
 		if (old_data == INV_RF_DATA) {
 			rtw_err(rtwdev, "Write fail, rf is disabled\n");
@@ -1086,6 +1268,9 @@ bool rtw_phy_write_rf_reg_sipi(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 
 	udelay(13);
 
+	if (slot >= 0)
+		rtw_phy_rf_shadow_update(rtwdev, rf_path, slot, data);
+
 	return true;
 }
 EXPORT_SYMBOL(rtw_phy_write_rf_reg_sipi);
@@ -1172,6 +1357,7 @@ void rtw_phy_setup_phy_cond(struct rtw_dev *rtwdev, u32 pkg)
 	rtw_dbg(rtwdev, RTW_DBG_PHY, "phy cond=0x%08x cond2=0x%08x\n",
 		*((u32 *)&hal->phy_cond), *((u32 *)&hal->phy_cond2));
 }
+EXPORT_SYMBOL(rtw_phy_setup_phy_cond);
 
 static bool check_positive(struct rtw_dev *rtwdev, struct rtw_phy_cond cond,
 			   struct rtw_phy_cond2 cond2)
@@ -2390,17 +2576,212 @@ static void rtw_phy_set_tx_power_level_by_path(struct rtw_dev *rtwdev,
 		rtw_phy_set_tx_power_index_by_rs(rtwdev, ch, path, rs);
 }
 
-void rtw_phy_set_tx_power_level(struct rtw_dev *rtwdev, u8 channel)
+/* Program the bits in @mask of a TXAGC register to @data (already shifted
+ * into place). The image is kept so that writes that would not change the
+ * register are skipped and partially owned registers are read only once.
+ */
+void rtw_phy_txagc_write(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 data)
 {
-	const struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_txagc_shadow *txagc = &rtwdev->hal.txagc;
+	u32 val;
+	int i;
+
+	for (i = 0; i < txagc->num; i++)
+		if (txagc->addr[i] == addr)
+			break;
+
+	if (i == txagc->num) {
+		if (i == RTW_TXAGC_SHADOW_NUM) {
+			WARN_ONCE(1, "txagc shadow full\n");
+			rtw_write32_mask(rtwdev, addr, mask, data >> __ffs(mask));
+			txagc->total.reads++;
+			txagc->total.writes++;
+			return;
+		}
+
+		if (mask == MASKDWORD) {
+			txagc->val[i] = ~data;
+		} else {
+			txagc->val[i] = rtw_read32(rtwdev, addr);
+			txagc->total.reads++;
+		}
+		txagc->addr[i] = addr;
+		txagc->num++;
+	}
+
+	val = (txagc->val[i] & ~mask) | (data & mask);
+	if (val == txagc->val[i]) {
+		txagc->total.skips++;
+		return;
+	}
+
+	rtw_write32(rtwdev, addr, val);
+	txagc->val[i] = val;
+	txagc->total.writes++;
+}
+EXPORT_SYMBOL(rtw_phy_txagc_write);
+
+/* forget the images, the registers went back to their defaults */
+void rtw_phy_txagc_reset(struct rtw_dev *rtwdev)
+{
+	rtwdev->hal.txagc.num = 0;
+}
+EXPORT_SYMBOL(rtw_phy_txagc_reset);
+
+static bool rtw_phy_tx_pwr_cache_match(struct rtw_dev *rtwdev,
+				       const struct rtw_tx_pwr_cache_entry *ent,
+				       u8 channel, u8 regd)
+{
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
 	struct rtw_hal *hal = &rtwdev->hal;
 	u8 path;
 
+	/* the 20M and 40M limits are looked up around the primary channel */
+	if (!ent->valid || ent->channel != channel ||
+	    ent->primary != hal->primary_channel ||
+	    ent->band != hal->current_band_type ||
+	    ent->bw != hal->current_band_width ||
+	    ent->regd != regd || ent->sar_band != hal->sar_band ||
+	    ent->remnant_cck != dm_info->txagc_remnant_cck)
+		return false;
+
+	for (path = 0; path < hal->rf_path_num; path++)
+		if (ent->remnant_ofdm[path] != dm_info->txagc_remnant_ofdm[path])
+			return false;
+
+	return true;
+}
+
+/* copy the rate sections rtw_phy_set_tx_power_level_by_path() computes,
+ * CCK entries are left alone outside of 2.4G like the uncached path does
+ */
+static void rtw_phy_tx_pwr_cache_copy(struct rtw_dev *rtwdev,
+				      struct rtw_tx_pwr_cache_entry *ent,
+				      bool restore)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+	u8 path, rs, rate;
+	int i;
+
+	for (path = 0; path < hal->rf_path_num; path++) {
+		if (hal->current_band_type == RTW_BAND_2G)
+			rs = RTW_RATE_SECTION_CCK;
+		else
+			rs = RTW_RATE_SECTION_OFDM;
+
+		for (; rs < RTW_RATE_SECTION_NUM; rs++) {
+			for (i = 0; i < rtw_rate_size[rs]; i++) {
+				rate = rtw_rate_section[rs][i];
+				if (restore)
+					hal->tx_pwr_tbl[path][rate] =
+						ent->tbl[path][rate];
+				else
+					ent->tbl[path][rate] =
+						hal->tx_pwr_tbl[path][rate];
+			}
+		}
+	}
+}
+
+static bool rtw_phy_tx_pwr_cache_load(struct rtw_dev *rtwdev, u8 channel,
+				      u8 regd)
+{
+	struct rtw_tx_pwr_cache *cache = &rtwdev->hal.tx_pwr_cache;
+	struct rtw_tx_pwr_cache_entry *ent;
+	int i;
+
+	for (i = 0; i < RTW_TX_PWR_CACHE_NUM; i++) {
+		ent = &cache->ent[i];
+		if (!rtw_phy_tx_pwr_cache_match(rtwdev, ent, channel, regd))
+			continue;
+
+		rtw_phy_tx_pwr_cache_copy(rtwdev, ent, true);
+		ent->last_use = jiffies;
+		cache->hit++;
+		return true;
+	}
+
+	cache->miss++;
+
+	return false;
+}
+
+static void rtw_phy_tx_pwr_cache_store(struct rtw_dev *rtwdev, u8 channel,
+				       u8 regd)
+{
+	struct rtw_tx_pwr_cache *cache = &rtwdev->hal.tx_pwr_cache;
+	struct rtw_tx_pwr_cache_entry *ent, *victim = &cache->ent[0];
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_hal *hal = &rtwdev->hal;
+	int i;
+
+	/* a free slot first, then the least recently used */
+	for (i = 0; i < RTW_TX_PWR_CACHE_NUM; i++) {
+		ent = &cache->ent[i];
+		if (!ent->valid) {
+			victim = ent;
+			break;
+		}
+		if (time_before(ent->last_use, victim->last_use))
+			victim = ent;
+	}
+
+	victim->valid = true;
+	victim->band = hal->current_band_type;
+	victim->channel = channel;
+	victim->primary = hal->primary_channel;
+	victim->bw = hal->current_band_width;
+	victim->regd = regd;
+	victim->sar_band = hal->sar_band;
+	victim->remnant_cck = dm_info->txagc_remnant_cck;
+	memcpy(victim->remnant_ofdm, dm_info->txagc_remnant_ofdm,
+	       sizeof(victim->remnant_ofdm));
+	victim->last_use = jiffies;
+	rtw_phy_tx_pwr_cache_copy(rtwdev, victim, false);
+}
+
+/* drop every computed row, the tables, the regulatory domain or the SAR
+ * configuration behind them changed
+ */
+void rtw_phy_tx_pwr_cache_flush(struct rtw_dev *rtwdev)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+	struct rtw_tx_pwr_cache *cache = &hal->tx_pwr_cache;
+	int i;
+
 	mutex_lock(&hal->tx_power_mutex);
+	for (i = 0; i < RTW_TX_PWR_CACHE_NUM; i++)
+		cache->ent[i].valid = false;
+	cache->flush++;
+	mutex_unlock(&hal->tx_power_mutex);
+}
+EXPORT_SYMBOL(rtw_phy_tx_pwr_cache_flush);
+
+/* fill hal->tx_pwr_tbl for @channel, computing only what is not cached */
+void rtw_phy_calc_tx_power_level(struct rtw_dev *rtwdev, u8 channel)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+	u8 regd = rtw_regd_get(rtwdev);
+	u8 path;
+
+	lockdep_assert_held(&hal->tx_power_mutex);
+
+	if (rtw_phy_tx_pwr_cache_load(rtwdev, channel, regd))
+		return;
 
 	for (path = 0; path < hal->rf_path_num; path++)
 		rtw_phy_set_tx_power_level_by_path(rtwdev, channel, path);
+	rtw_phy_tx_pwr_cache_store(rtwdev, channel, regd);
+}
+EXPORT_SYMBOL(rtw_phy_calc_tx_power_level);
 
+void rtw_phy_set_tx_power_level(struct rtw_dev *rtwdev, u8 channel)
+{
+	const struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_hal *hal = &rtwdev->hal;
+
+	mutex_lock(&hal->tx_power_mutex);
+	rtw_phy_calc_tx_power_level(rtwdev, channel);
 	chip->ops->set_tx_power_index(rtwdev);
 	mutex_unlock(&hal->tx_power_mutex);
 }
@@ -2438,6 +2819,7 @@ void rtw_phy_tx_power_by_rate_config(struct rtw_hal *hal)
 			rtw_phy_tx_power_by_rate_config_by_path(hal, path, rs,
 				rtw_rate_size[rs], rtw_rate_section[rs]);
 }
+EXPORT_SYMBOL(rtw_phy_tx_power_by_rate_config);
 
 static void
 __rtw_phy_tx_power_limit_config(struct rtw_hal *hal, u8 regd, u8 bw, u8 rs)
@@ -2468,6 +2850,7 @@ void rtw_phy_tx_power_limit_config(struct rtw_hal *hal)
 			for (rs = 0; rs < RTW_RATE_SECTION_NUM; rs++)
 				__rtw_phy_tx_power_limit_config(hal, regd, bw, rs);
 }
+EXPORT_SYMBOL(rtw_phy_tx_power_limit_config);
 
 static void rtw_phy_init_tx_power_limit(struct rtw_dev *rtwdev,
 					u8 regd, u8 bw, u8 rs)
@@ -2505,6 +2888,7 @@ void rtw_phy_init_tx_power(struct rtw_dev *rtwdev)
 				rtw_phy_init_tx_power_limit(rtwdev, regd, bw,
 							    rs);
 }
+EXPORT_SYMBOL(rtw_phy_init_tx_power);
 
 void rtw_phy_config_swing_table(struct rtw_dev *rtwdev,
 				struct rtw_swing_table *swing_table)
@@ -2671,6 +3055,227 @@ bool rtw_phy_pwrtrack_need_iqk(struct rtw_dev *rtwdev)
 }
 EXPORT_SYMBOL(rtw_phy_pwrtrack_need_iqk);
 
+static u8 rtw_phy_iqk_cache_ch_group(u8 channel)
+{
+	if (channel <= 3)
+		return 0;
+	if (channel <= 9)
+		return 1;
+	if (channel <= 14)
+		return 2;
+
+	return 3 + (channel - 36) / 32;
+}
+
+struct rtw_iqk_cache_entry *rtw_phy_iqk_cache_lookup(struct rtw_dev *rtwdev,
+						     u8 thermal)
+{
+	struct rtw_iqk_cache *cache = &rtwdev->dm_info.iqk_cache;
+	struct rtw_hal *hal = &rtwdev->hal;
+	u8 ch_group = rtw_phy_iqk_cache_ch_group(hal->current_channel);
+	u8 bucket = thermal / RTW_IQK_CACHE_THERMAL_STEP;
+	struct rtw_iqk_cache_entry *ent;
+	int i;
+
+	for (i = 0; i < RTW_IQK_CACHE_NUM; i++) {
+		ent = &cache->ent[i];
+		if (ent->valid && ent->ch_group == ch_group &&
+		    ent->bw == hal->current_band_width &&
+		    ent->thermal == bucket)
+			return ent;
+	}
+
+	cache->miss++;
+
+	return NULL;
+}
+EXPORT_SYMBOL(rtw_phy_iqk_cache_lookup);
+
+void rtw_phy_iqk_cache_hit(struct rtw_dev *rtwdev,
+			   struct rtw_iqk_cache_entry *ent, u32 cost_us)
+{
+	struct rtw_iqk_cache *cache = &rtwdev->dm_info.iqk_cache;
+
+	cache->hit++;
+	if (ent->cost_us > cost_us)
+		cache->saved_us += ent->cost_us - cost_us;
+	ent->last_use = jiffies;
+}
+EXPORT_SYMBOL(rtw_phy_iqk_cache_hit);
+
+void rtw_phy_iqk_cache_store(struct rtw_dev *rtwdev, u8 thermal,
+			     const s32 *result, u32 cost_us)
+{
+	struct rtw_iqk_cache *cache = &rtwdev->dm_info.iqk_cache;
+	struct rtw_hal *hal = &rtwdev->hal;
+	u8 ch_group = rtw_phy_iqk_cache_ch_group(hal->current_channel);
+	u8 bucket = thermal / RTW_IQK_CACHE_THERMAL_STEP;
+	struct rtw_iqk_cache_entry *ent, *victim = &cache->ent[0];
+	int i;
+
+	/* same key first, then a free slot, then the least recently used */
+	for (i = 0; i < RTW_IQK_CACHE_NUM; i++) {
+		ent = &cache->ent[i];
+		if (ent->valid && ent->ch_group == ch_group &&
+		    ent->bw == hal->current_band_width &&
+		    ent->thermal == bucket) {
+			victim = ent;
+			break;
+		}
+		if (!ent->valid) {
+			if (victim->valid)
+				victim = ent;
+			continue;
+		}
+		if (victim->valid && time_before(ent->last_use, victim->last_use))
+			victim = ent;
+	}
+
+	victim->valid = true;
+	victim->ch_group = ch_group;
+	victim->bw = hal->current_band_width;
+	victim->thermal = bucket;
+	memcpy(victim->result, result, sizeof(victim->result));
+	victim->cost_us = cost_us;
+	victim->last_use = jiffies;
+}
+EXPORT_SYMBOL(rtw_phy_iqk_cache_store);
+
+void rtw_phy_iqk_cache_flush(struct rtw_dev *rtwdev)
+{
+	struct rtw_iqk_cache *cache = &rtwdev->dm_info.iqk_cache;
+	int i;
+
+	for (i = 0; i < RTW_IQK_CACHE_NUM; i++)
+		cache->ent[i].valid = false;
+	cache->flush++;
+}
+EXPORT_SYMBOL(rtw_phy_iqk_cache_flush);
+
+void rtw_phy_chan_img_add(struct rtw_chan_img *img, u8 type, u8 path,
+			  u32 addr, u32 mask, u32 val)
+{
+	struct rtw_chan_reg *reg;
+
+	if (WARN_ON(img->num >= RTW_CHAN_IMG_NUM))
+		return;
+
+	reg = &img->reg[img->num++];
+	reg->type = type;
+	reg->path = path;
+	reg->addr = addr;
+	reg->mask = mask;
+	reg->val = val;
+}
+EXPORT_SYMBOL(rtw_phy_chan_img_add);
+
+static void rtw_phy_chan_reg_write(struct rtw_dev *rtwdev,
+				   const struct rtw_chan_reg *reg)
+{
+	switch (reg->type) {
+	case RTW_CHAN_REG_8:
+		if (reg->mask == MASKBYTE0)
+			rtw_write8(rtwdev, reg->addr, reg->val);
+		else
+			rtw_write8_mask(rtwdev, reg->addr, reg->mask, reg->val);
+		break;
+	case RTW_CHAN_REG_32:
+		if (reg->mask == MASKDWORD)
+			rtw_write32(rtwdev, reg->addr, reg->val);
+		else
+			rtw_write32_mask(rtwdev, reg->addr, reg->mask, reg->val);
+		break;
+	case RTW_CHAN_REG_RF:
+		rtw_write_rf(rtwdev, reg->path, reg->addr, reg->mask, reg->val);
+		break;
+	}
+}
+
+/* Program @img, writing only the fields that differ from what the previous
+ * channel left in the hardware. Without a known previous state every field
+ * is written.
+ */
+void rtw_phy_chan_img_apply(struct rtw_dev *rtwdev,
+			    const struct rtw_chan_img *img)
+{
+	struct rtw_chan_delta *cd = &rtwdev->hal.chan_delta;
+	const struct rtw_chan_reg *reg;
+	struct rtw_chan_reg *cur;
+	bool full;
+	int i;
+
+	full = !cd->valid || cd->cur.num != img->num;
+
+	for (i = 0; i < img->num; i++) {
+		reg = &img->reg[i];
+		cur = &cd->cur.reg[i];
+
+		if (!reg->mask) {
+			/* not programmed, the field is unknown after a
+			 * full reprogram and untouched otherwise
+			 */
+			if (full)
+				cur->mask = 0;
+			continue;
+		}
+
+		if (!full && cur->type == reg->type && cur->path == reg->path &&
+		    cur->addr == reg->addr && cur->mask == reg->mask &&
+		    cur->val == reg->val) {
+			cd->skips++;
+			continue;
+		}
+
+		rtw_phy_chan_reg_write(rtwdev, reg);
+		*cur = *reg;
+		cd->writes++;
+	}
+
+	cd->cur.num = img->num;
+	cd->valid = true;
+	if (full)
+		cd->full++;
+	else
+		cd->delta++;
+}
+EXPORT_SYMBOL(rtw_phy_chan_img_apply);
+
+/* the next channel switch reprograms everything */
+void rtw_phy_chan_delta_invalidate(struct rtw_dev *rtwdev)
+{
+	rtwdev->hal.chan_delta.valid = false;
+}
+EXPORT_SYMBOL(rtw_phy_chan_delta_invalidate);
+
+void rtw_phy_chan_switch_account(struct rtw_dev *rtwdev, u8 from, u8 to,
+				 u32 us)
+{
+	struct rtw_chan_delta *cd = &rtwdev->hal.chan_delta;
+	struct rtw_chan_sw_pair *pair;
+	int i;
+
+	cd->hist[min_t(u32, fls(us >> 7), RTW_CHAN_SW_HIST_NUM - 1)]++;
+
+	for (i = 0; i < RTW_CHAN_SW_PAIR_NUM; i++) {
+		pair = &cd->pair[i];
+		if (!pair->count) {
+			pair->from = from;
+			pair->to = to;
+			break;
+		}
+		if (pair->from == from && pair->to == to)
+			break;
+	}
+	if (i == RTW_CHAN_SW_PAIR_NUM) {
+		cd->pair_overflow++;
+		return;
+	}
+
+	pair->count++;
+	pair->total_us += us;
+	pair->max_us = max(pair->max_us, us);
+}
+
 static void rtw_phy_set_tx_path_by_reg(struct rtw_dev *rtwdev,
 				       enum rtw_bb_path tx_path_sel_1ss)
 {
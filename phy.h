@@ -22,6 +22,7 @@ extern const u8 rtw_rate_size[];
 
 void rtw_phy_init(struct rtw_dev *rtwdev);
 void rtw_phy_dynamic_mechanism(struct rtw_dev *rtwdev);
+bool rtw_phy_dm_track_supported(struct rtw_dev *rtwdev);
 u8 rtw_phy_rf_power_2_rssi(s8 *rf_power, u8 path_num);
 u32 rtw_phy_read_rf(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 		    u32 addr, u32 mask);
@@ -50,6 +51,18 @@ void rtw_phy_load_tables(struct rtw_dev *rtwdev);
 u8 rtw_phy_get_tx_power_index(struct rtw_dev *rtwdev, u8 rf_path, u8 rate,
 			      enum rtw_bandwidth bw, u8 channel, u8 regd);
 void rtw_phy_set_tx_power_level(struct rtw_dev *rtwdev, u8 channel);
+void rtw_phy_calc_tx_power_level(struct rtw_dev *rtwdev, u8 channel);
+void rtw_phy_tx_pwr_cache_flush(struct rtw_dev *rtwdev);
+void rtw_phy_rf_shadow_invalidate(struct rtw_dev *rtwdev);
+void rtw_phy_chan_img_add(struct rtw_chan_img *img, u8 type, u8 path,
+			  u32 addr, u32 mask, u32 val);
+void rtw_phy_chan_img_apply(struct rtw_dev *rtwdev,
+			    const struct rtw_chan_img *img);
+void rtw_phy_chan_delta_invalidate(struct rtw_dev *rtwdev);
+void rtw_phy_chan_switch_account(struct rtw_dev *rtwdev, u8 from, u8 to,
+				 u32 us);
+void rtw_phy_txagc_write(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 data);
+void rtw_phy_txagc_reset(struct rtw_dev *rtwdev);
 void rtw_phy_tx_power_by_rate_config(struct rtw_hal *hal);
 void rtw_phy_tx_power_limit_config(struct rtw_hal *hal);
 void rtw_phy_pwrtrack_avg(struct rtw_dev *rtwdev, u8 thermal, u8 path);
@@ -61,6 +74,13 @@ s8 rtw_phy_pwrtrack_get_pwridx(struct rtw_dev *rtwdev,
 			       u8 tbl_path, u8 therm_path, u8 delta);
 bool rtw_phy_pwrtrack_need_lck(struct rtw_dev *rtwdev);
 bool rtw_phy_pwrtrack_need_iqk(struct rtw_dev *rtwdev);
+struct rtw_iqk_cache_entry *rtw_phy_iqk_cache_lookup(struct rtw_dev *rtwdev,
+						     u8 thermal);
+void rtw_phy_iqk_cache_hit(struct rtw_dev *rtwdev,
+			   struct rtw_iqk_cache_entry *ent, u32 cost_us);
+void rtw_phy_iqk_cache_store(struct rtw_dev *rtwdev, u8 thermal,
+			     const s32 *result, u32 cost_us);
+void rtw_phy_iqk_cache_flush(struct rtw_dev *rtwdev);
 void rtw_phy_config_swing_table(struct rtw_dev *rtwdev,
 				struct rtw_swing_table *swing_table);
 void rtw_phy_set_edcca_th(struct rtw_dev *rtwdev, u8 l2h, u8 h2l);
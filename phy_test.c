@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#include <linux/module.h>
+#include <kunit/test.h>
+#include "main.h"
+#include "phy.h"
+
+/* the chip headers clash with each other, only their specs are needed */
+extern const struct rtw_chip_info rtw8703b_hw_spec;
+extern const struct rtw_chip_info rtw8723b_hw_spec;
+extern const struct rtw_chip_info rtw8723d_hw_spec;
+extern const struct rtw_chip_info rtw8812a_hw_spec;
+extern const struct rtw_chip_info rtw8814a_hw_spec;
+extern const struct rtw_chip_info rtw8821a_hw_spec;
+extern const struct rtw_chip_info rtw8821c_hw_spec;
+extern const struct rtw_chip_info rtw8822b_hw_spec;
+extern const struct rtw_chip_info rtw8822c_hw_spec;
+
+static const struct rtw_chip_info *rtw_phy_test_chips[] = {
+	&rtw8703b_hw_spec,
+	&rtw8723b_hw_spec,
+	&rtw8723d_hw_spec,
+	&rtw8812a_hw_spec,
+	&rtw8814a_hw_spec,
+	&rtw8821a_hw_spec,
+	&rtw8821c_hw_spec,
+	&rtw8822b_hw_spec,
+	&rtw8822c_hw_spec,
+};
+
+static void rtw_phy_test_chip_desc(const struct rtw_chip_info **chip,
+				   char *desc)
+{
+	snprintf(desc, KUNIT_PARAM_DESC_SIZE, "%s", (*chip)->fw_name);
+}
+
+KUNIT_ARRAY_PARAM(rtw_phy_test_chip, rtw_phy_test_chips,
+		  rtw_phy_test_chip_desc);
+
+struct rtw_phy_test_chan {
+	u8 center;
+	u8 primary;
+};
+
+/* at most RTW_TX_PWR_CACHE_NUM channels per bandwidth, so that a second
+ * pass over one bandwidth is served from the cache alone
+ */
+struct rtw_phy_test_group {
+	u8 bw;
+	int num;
+	struct rtw_phy_test_chan chan[RTW_TX_PWR_CACHE_NUM];
+};
+
+static void rtw_phy_test_add(struct rtw_phy_test_group *grp, u8 center,
+			     u8 primary)
+{
+	if (WARN_ON(grp->num == RTW_TX_PWR_CACHE_NUM))
+		return;
+
+	grp->chan[grp->num].center = center;
+	grp->chan[grp->num].primary = primary;
+	grp->num++;
+}
+
+static void rtw_phy_test_fill_group(const struct rtw_chip_info *chip,
+				    struct rtw_phy_test_group *grp, u8 bw)
+{
+	static const u8 ch_5g_20m[] = {
+		36, 40, 44, 48, 52, 56, 60, 64,
+		100, 104, 108, 112, 116, 120, 124, 128, 132, 136, 140, 144,
+		149, 153, 157, 161, 165,
+	};
+	static const u8 ch_5g_40m[] = {
+		38, 46, 54, 62, 102, 110, 118, 126, 134, 142, 151, 159,
+	};
+	static const u8 ch_5g_80m[] = {
+		42, 58, 106, 122, 138, 155,
+	};
+	bool has_5g = chip->band & RTW_BAND_5G;
+	u8 ch;
+	int i;
+
+	grp->bw = bw;
+	grp->num = 0;
+
+	switch (bw) {
+	case RTW_CHANNEL_WIDTH_20:
+		for (ch = 1; ch <= 14; ch++)
+			rtw_phy_test_add(grp, ch, ch);
+		for (i = 0; has_5g && i < ARRAY_SIZE(ch_5g_20m); i++)
+			rtw_phy_test_add(grp, ch_5g_20m[i], ch_5g_20m[i]);
+		break;
+	case RTW_CHANNEL_WIDTH_40:
+		/* both primary channels of each center */
+		for (ch = 3; ch <= 11; ch++) {
+			rtw_phy_test_add(grp, ch, ch - 2);
+			rtw_phy_test_add(grp, ch, ch + 2);
+		}
+		for (i = 0; has_5g && i < ARRAY_SIZE(ch_5g_40m); i++) {
+			ch = ch_5g_40m[i];
+			rtw_phy_test_add(grp, ch, ch - 2);
+			rtw_phy_test_add(grp, ch, ch + 2);
+		}
+		break;
+	case RTW_CHANNEL_WIDTH_80:
+		for (i = 0; has_5g && i < ARRAY_SIZE(ch_5g_80m); i++) {
+			ch = ch_5g_80m[i];
+			rtw_phy_test_add(grp, ch, ch - 6);
+			rtw_phy_test_add(grp, ch, ch - 2);
+			rtw_phy_test_add(grp, ch, ch + 2);
+			rtw_phy_test_add(grp, ch, ch + 6);
+		}
+		break;
+	}
+}
+
+/* the board setup rtw_chip_board_info_setup() does, on a made up efuse */
+static struct rtw_dev *rtw_phy_test_setup(struct kunit *test,
+					  const struct rtw_chip_info *chip)
+{
+	const struct rtw_rfe_def *rfe_def;
+	struct rtw_dev *rtwdev;
+	struct rtw_hal *hal;
+	u8 *efuse_pwr;
+	int path, i;
+
+	rtwdev = kunit_kzalloc(test, sizeof(*rtwdev), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, rtwdev);
+
+	hal = &rtwdev->hal;
+	rtwdev->chip = chip;
+	mutex_init(&hal->tx_power_mutex);
+
+	rfe_def = rtw_get_rfe_def(rtwdev);
+	if (!rfe_def || !rfe_def->phy_pg_tbl || !rfe_def->txpwr_lmt_tbl)
+		kunit_skip(test, "no TX power tables for rfe 0");
+
+	for (path = 0; path < RTW_RF_PATH_MAX && chip->rf_tbl[path]; path++)
+		;
+	hal->rf_path_num = path;
+
+	/* a pattern that differs between paths, groups and rate sections */
+	for (path = 0; path < RTW_RF_PATH_MAX; path++) {
+		efuse_pwr = (u8 *)&rtwdev->efuse.txpwr_idx_table[path];
+		for (i = 0; i < sizeof(rtwdev->efuse.txpwr_idx_table[path]); i++)
+			efuse_pwr[i] = 0x20 + (i * 7 + path * 3) % 16;
+	}
+
+	rtw_phy_setup_phy_cond(rtwdev, hal->pkg_type);
+	rtw_phy_init_tx_power(rtwdev);
+	rtw_load_table(rtwdev, rfe_def->phy_pg_tbl);
+	rtw_load_table(rtwdev, rfe_def->txpwr_lmt_tbl);
+	rtw_phy_tx_power_by_rate_config(hal);
+	rtw_phy_tx_power_limit_config(hal);
+
+	return rtwdev;
+}
+
+static void rtw_phy_test_set_chan(struct rtw_dev *rtwdev, u8 bw,
+				  const struct rtw_phy_test_chan *chan)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+	u8 band = chan->center > 14 ? RTW_BAND_5G : RTW_BAND_2G;
+
+	rtw_update_channel(rtwdev, chan->center, chan->primary, band, bw);
+
+	/* unwritten entries must come out the same on both paths */
+	memset(hal->tx_pwr_tbl, 0xff, sizeof(hal->tx_pwr_tbl));
+
+	mutex_lock(&hal->tx_power_mutex);
+	rtw_phy_calc_tx_power_level(rtwdev, hal->current_channel);
+	mutex_unlock(&hal->tx_power_mutex);
+}
+
+static void rtw_phy_test_expect_tbl(struct kunit *test,
+				    struct rtw_dev *rtwdev, u8 bw,
+				    const struct rtw_phy_test_chan *chan,
+				    s8 (*ref)[DESC_RATE_MAX])
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+	u8 path, rate;
+
+	for (path = 0; path < hal->rf_path_num; path++) {
+		for (rate = 0; rate < DESC_RATE_MAX; rate++) {
+			if (hal->tx_pwr_tbl[path][rate] == ref[path][rate])
+				continue;
+
+			KUNIT_FAIL(test,
+				   "ch %u/%u bw %u regd %u sar_band %u path %u rate 0x%02x: cached %d computed %d\n",
+				   chan->center, chan->primary, bw,
+				   rtw_regd_get(rtwdev), hal->sar_band, path,
+				   rate, hal->tx_pwr_tbl[path][rate],
+				   ref[path][rate]);
+			return;
+		}
+	}
+}
+
+/* compute every channel of @grp from an empty cache, then walk the group
+ * twice more, first filling the cache and then only hitting it, and expect
+ * the very same rows each time
+ */
+static void rtw_phy_test_group(struct kunit *test, struct rtw_dev *rtwdev,
+			       const struct rtw_phy_test_group *grp,
+			       s8 (*ref)[RTW_RF_PATH_MAX][DESC_RATE_MAX])
+{
+	struct rtw_tx_pwr_cache *cache = &rtwdev->hal.tx_pwr_cache;
+	const struct rtw_phy_test_chan *chan;
+	u32 hit;
+	int pass, i;
+
+	for (i = 0; i < grp->num; i++) {
+		rtw_phy_tx_pwr_cache_flush(rtwdev);
+		rtw_phy_test_set_chan(rtwdev, grp->bw, &grp->chan[i]);
+		memcpy(ref[i], rtwdev->hal.tx_pwr_tbl, sizeof(ref[i]));
+	}
+
+	rtw_phy_tx_pwr_cache_flush(rtwdev);
+
+	for (pass = 0; pass < 2; pass++) {
+		hit = cache->hit;
+
+		for (i = 0; i < grp->num; i++) {
+			chan = &grp->chan[i];
+			rtw_phy_test_set_chan(rtwdev, grp->bw, chan);
+			rtw_phy_test_expect_tbl(test, rtwdev, grp->bw, chan,
+						ref[i]);
+		}
+
+		/* no two channels of a group may share an entry */
+		KUNIT_EXPECT_EQ(test, cache->hit - hit, pass ? (u32)grp->num : 0);
+	}
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+static void rtw_phy_test_set_sar(struct rtw_dev *rtwdev, bool on)
+{
+	struct rtw_sar *sar = &rtwdev->hal.sar;
+	u8 path, rs, band;
+
+	memset(sar, 0, sizeof(*sar));
+	if (!on)
+		return;
+
+	/* low enough to win against the by-rate offset on some rates */
+	sar->src = RTW_SAR_SOURCE_COMMON;
+	for (path = 0; path < RTW_RF_PATH_MAX; path++)
+		for (rs = 0; rs < RTW_RATE_SECTION_NUM; rs++)
+			for (band = 0; band < RTW_SAR_BAND_NR; band++)
+				sar->cfg[path][rs].common[band] =
+					(path + rs * 3 + band * 5) % 8 - 6;
+}
+#else
+static void rtw_phy_test_set_sar(struct rtw_dev *rtwdev, bool on)
+{
+}
+#endif
+
+static void rtw_phy_test_tx_pwr_cache(struct kunit *test)
+{
+	const struct rtw_chip_info * const *chip = test->param_value;
+	struct rtw_regulatory regulatory = {};
+	struct rtw_phy_test_group *grp;
+	struct rtw_dev *rtwdev;
+	s8 (*ref)[RTW_RF_PATH_MAX][DESC_RATE_MAX];
+	u8 regd, bw;
+	int sar;
+
+	rtwdev = rtw_phy_test_setup(test, *chip);
+	rtwdev->regd.regulatory = &regulatory;
+
+	grp = kunit_kzalloc(test, sizeof(*grp), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, grp);
+	ref = kunit_kcalloc(test, RTW_TX_PWR_CACHE_NUM, sizeof(*ref),
+			    GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ref);
+
+	for (sar = 0; sar < 2; sar++) {
+		rtw_phy_test_set_sar(rtwdev, sar);
+
+		for (regd = 0; regd <= RTW_REGD_WW; regd++) {
+			regulatory.txpwr_regd_2g = regd;
+			regulatory.txpwr_regd_5g = regd;
+
+			for (bw = RTW_CHANNEL_WIDTH_20;
+			     bw <= RTW_CHANNEL_WIDTH_80; bw++) {
+				rtw_phy_test_fill_group(*chip, grp, bw);
+				if (grp->num)
+					rtw_phy_test_group(test, rtwdev, grp,
+							   ref);
+			}
+		}
+	}
+}
+
+static struct kunit_case rtw_phy_test_cases[] = {
+	KUNIT_CASE_PARAM(rtw_phy_test_tx_pwr_cache,
+			 rtw_phy_test_chip_gen_params),
+	{}
+};
+
+static struct kunit_suite rtw_phy_test_suite = {
+	.name = "rtw88_phy",
+	.test_cases = rtw_phy_test_cases,
+};
+
+kunit_test_suites(&rtw_phy_test_suite);
+
+MODULE_AUTHOR("Realtek Corporation");
+MODULE_DESCRIPTION("Realtek 802.11n/ac wireless KUnit tests");
+MODULE_LICENSE("Dual BSD/GPL");
@@ -9,6 +9,7 @@
 #include "mac.h"
 #include "coex.h"
 #include "debug.h"
+#include "phy.h"
 
 static int rtw_ips_pwr_up(struct rtw_dev *rtwdev)
 {
@@ -93,6 +94,117 @@ static int rtw_ips_pwr_up(struct rtw_dev *rtwdev)
 	return ret;
 }
 
+static bool rtw_ips_retention_allowed(struct rtw_dev *rtwdev)
+{
+	if (!rtw_ips_retention)
+		return false;
+
+	/* a crashed firmware or a suspend has to go through power off */
+	if (test_bit(RTW_FLAG_RESTARTING, rtwdev->flags) ||
+	    test_bit(RTW_FLAG_WOWLAN, rtwdev->flags))
+		return false;
+
+	return test_bit(RTW_FLAG_FW_RUNNING, rtwdev->flags);
+}
+
+/* Retention IPS keeps the card in the active power state, so firmware, MAC
+ * and BB/RF tables survive. Only TX and the RF front end are parked, the
+ * wake restores them instead of running the whole power on.
+ */
+static void rtw_ips_retention_enter(struct rtw_dev *rtwdev)
+{
+	struct rtw_ips_state *ips = &rtwdev->ips;
+	u8 path;
+
+	rtw_fw_h2c_barrier(rtwdev);
+
+	ips->txpause = rtw_read8(rtwdev, REG_TXPAUSE);
+	rtw_write8(rtwdev, REG_TXPAUSE, 0xff);
+
+	for (path = 0; path < rtwdev->hal.rf_path_num; path++) {
+		ips->rf_mode[path] = rtw_read_rf(rtwdev, path, RF_MODE,
+						 RFREG_MASK);
+		rtw_write_rf(rtwdev, path, RF_MODE, RF_MODE_MASK,
+			     RF_MODE_STANDBY);
+	}
+
+	rtw_hci_link_ps(rtwdev, true);
+	set_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags);
+
+	/* nothing to track with the RF parked, the watch dog also stops
+	 * itself if it is already running, rtwdev->mutex is held here
+	 */
+	cancel_delayed_work(&rtwdev->watch_dog_work);
+}
+
+/* The firmware must still report ready and have drained every H2C box,
+ * otherwise the card lost power or the firmware stalled while parked.
+ */
+static bool rtw_ips_retention_valid(struct rtw_dev *rtwdev)
+{
+	u32 val32;
+
+	val32 = rtw_read32(rtwdev, REG_MCUFW_CTRL);
+	if (val32 == 0 || val32 == 0xffffffff || val32 == 0xeaeaeaea)
+		return false;
+
+	if (rtw_chip_wcpu_8051(rtwdev)) {
+		if ((val32 & FW_READY_LEGACY) != FW_READY_LEGACY)
+			return false;
+	} else if ((val32 & FW_READY_MASK) != FW_READY) {
+		return false;
+	}
+
+	return !(rtw_read8(rtwdev, REG_HMETFR) & BIT_INT_BOX_ALL);
+}
+
+static int rtw_ips_retention_leave(struct rtw_dev *rtwdev)
+{
+	struct rtw_ips_state *ips = &rtwdev->ips;
+	u8 path;
+
+	clear_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags);
+	rtw_hci_link_ps(rtwdev, false);
+
+	if (!rtw_ips_retention_valid(rtwdev)) {
+		rtw_warn(rtwdev, "firmware lost in retention IPS, power on again\n");
+		rtw_core_stop(rtwdev);
+		return -EAGAIN;
+	}
+
+	for (path = 0; path < rtwdev->hal.rf_path_num; path++)
+		rtw_write_rf(rtwdev, path, RF_MODE, RFREG_MASK,
+			     ips->rf_mode[path]);
+	rtw_write8(rtwdev, REG_TXPAUSE, ips->txpause);
+
+	/* RF was touched behind the caches, reprogram the whole channel */
+	rtw_phy_chan_delta_invalidate(rtwdev);
+	rtw_phy_rf_shadow_invalidate(rtwdev);
+
+	rtw_coex_ips_notify(rtwdev, COEX_IPS_LEAVE);
+	rtw_set_channel(rtwdev);
+
+	ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->watch_dog_work,
+				     RTW_WATCH_DOG_DELAY_TIME);
+
+	return 0;
+}
+
+static void rtw_ips_wake_account(struct rtw_dev *rtwdev,
+				 enum rtw_ips_wake wake, ktime_t start)
+{
+	struct rtw_ips_wake_stat *stat = &rtwdev->ips.wake[wake];
+	u32 us = ktime_us_delta(ktime_get(), start);
+
+	stat->cnt++;
+	stat->last_us = us;
+	stat->total_us += us;
+	if (us > stat->max_us)
+		stat->max_us = us;
+
+	rtw_dbg(rtwdev, RTW_DBG_PS, "IPS wake (%d) took %u us\n", wake, us);
+}
+
 int rtw_enter_ips(struct rtw_dev *rtwdev)
 {
 	if (!test_bit(RTW_FLAG_POWERON, rtwdev->flags))
@@ -119,6 +231,11 @@ int rtw_enter_ips(struct rtw_dev *rtwdev)
 
 	rtw_coex_ips_notify(rtwdev, COEX_IPS_ENTER);
 
+	if (rtw_ips_retention_allowed(rtwdev)) {
+		rtw_ips_retention_enter(rtwdev);
+		return 0;
+	}
+
 	rtw_core_stop(rtwdev);
 	rtw_hci_link_ps(rtwdev, true);
 
@@ -134,11 +251,24 @@ static void rtw_restore_port_cfg_iter(void *data, struct ieee80211_vif *vif)
 	rtw_vif_port_config(rtwdev, rtwvif, config);
 }
 
-int rtw_leave_ips(struct rtw_dev *rtwdev)
+static int __rtw_leave_ips(struct rtw_dev *rtwdev, enum rtw_ips_wake *wake)
 {
 	int ret;
 
+	*wake = RTW_IPS_WAKE_FULL;
+
+	if (test_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags)) {
+		*wake = RTW_IPS_WAKE_RETENTION;
+		ret = rtw_ips_retention_leave(rtwdev);
+		if (!ret) {
+			rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_IPS_RESTORE);
+			return 0;
+		}
+		*wake = RTW_IPS_WAKE_FALLBACK;
+	}
+
 	if (test_bit(RTW_FLAG_SOFT_IPS, rtwdev->flags)) {
+		*wake = RTW_IPS_WAKE_SOFT;
 		/*
 		 * 8723BS SDIO soft IPS: the chip was never powered off.
 		 * Clear the soft-IPS flag and refresh the active WLAN
@@ -151,6 +281,10 @@ int rtw_leave_ips(struct rtw_dev *rtwdev)
 		rtw_coex_write_scbd(rtwdev,
 				    COEX_SCBD_ACTIVE | COEX_SCBD_ONOFF, true);
 		rtw_coex_8723bs_scan_workaround(rtwdev);
+		/* reprogram the whole channel image on the next switch */
+		rtw_phy_chan_delta_invalidate(rtwdev);
+		rtw_phy_rf_shadow_invalidate(rtwdev);
+		rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_IPS_RESTORE);
 		return 0;
 	}
 
@@ -166,15 +300,97 @@ int rtw_leave_ips(struct rtw_dev *rtwdev)
 	}
 
 	rtw_iterate_vifs(rtwdev, rtw_restore_port_cfg_iter, rtwdev);
+	rtw_boot_mark(rtwdev, RTW_BOOT_STAGE_IPS_RESTORE);
 
 	return 0;
 }
 
-void rtw_power_mode_change(struct rtw_dev *rtwdev, bool enter)
+int rtw_leave_ips(struct rtw_dev *rtwdev)
 {
-	u8 request, confirm, polling;
+	enum rtw_ips_wake wake;
+	ktime_t start;
 	int ret;
 
+	/* nothing to wake, keep it out of the boot profile */
+	if (!test_bit(RTW_FLAG_SOFT_IPS, rtwdev->flags) &&
+	    !test_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags) &&
+	    test_bit(RTW_FLAG_POWERON, rtwdev->flags))
+		return 0;
+
+	start = ktime_get();
+	rtw_boot_begin(rtwdev, RTW_BOOT_IPS_LEAVE);
+	ret = __rtw_leave_ips(rtwdev, &wake);
+	rtw_boot_end(rtwdev, ret);
+
+	if (!ret)
+		rtw_ips_wake_account(rtwdev, wake, start);
+
+	return ret;
+}
+
+/* Every RPWM request is acked by a CPWM toggle. Entering deep PS goes on
+ * without the ack, the CPWM interrupt collects it through
+ * rtw_power_mode_ack(), or the next request checks it. Leaving is acked
+ * before the MAC is touched again: PCIe requests come with irq_lock held
+ * and poll atomically, the other buses sleep between the reads.
+ */
+static int rtw_power_mode_wait_ack(struct rtw_dev *rtwdev, u8 confirm)
+{
+	u8 polling;
+
+	if (rtw_hci_type(rtwdev) == RTW_HCI_TYPE_PCIE)
+		return read_poll_timeout_atomic(rtw_read8, polling,
+						(polling ^ confirm) & BIT_RPWM_TOGGLE,
+						100, 15000, true, rtwdev,
+						rtwdev->hci.cpwm_addr);
+
+	return read_poll_timeout(rtw_read8, polling,
+				 (polling ^ confirm) & BIT_RPWM_TOGGLE,
+				 RTW_CPWM_POLL_US, 15000, true, rtwdev,
+				 rtwdev->hci.cpwm_addr);
+}
+
+static void rtw_power_mode_ack_failed(struct rtw_dev *rtwdev, bool enter)
+{
+	/* Hit here means that driver failed to get an ack from firmware.
+	 * The reason could be that hardware is locked at Deep sleep,
+	 * so most of the hardware circuits are not working, even
+	 * register read/write; or firmware is locked in some state and
+	 * cannot get the request. It should be treated as fatal error
+	 * and requires an entire analysis about the firmware/hardware.
+	 */
+	WARN(1, "firmware failed to ack driver for %s Deep Power mode\n",
+	     enter ? "entering" : "leaving");
+	rtw_fw_dump_dbg_info(rtwdev);
+}
+
+/* CPWM interrupt, may complete a pending enter request */
+void rtw_power_mode_ack(struct rtw_dev *rtwdev)
+{
+	u8 cpwm;
+
+	if (!test_bit(RTW_FLAG_LEISURE_PS_CPWM, rtwdev->flags))
+		return;
+
+	cpwm = rtw_read8(rtwdev, rtwdev->hci.cpwm_addr);
+	if ((cpwm ^ READ_ONCE(rtwdev->lps_conf.cpwm_confirm)) &
+	    BIT_RPWM_TOGGLE)
+		clear_bit(RTW_FLAG_LEISURE_PS_CPWM, rtwdev->flags);
+}
+EXPORT_SYMBOL(rtw_power_mode_ack);
+
+void rtw_power_mode_change(struct rtw_dev *rtwdev, bool enter)
+{
+	struct rtw_lps_conf *conf = &rtwdev->lps_conf;
+	u8 request, confirm;
+
+	/* a new request must not take the ack of the last one */
+	if (test_bit(RTW_FLAG_LEISURE_PS_CPWM, rtwdev->flags)) {
+		if (rtw_power_mode_wait_ack(rtwdev, conf->cpwm_confirm))
+			rtw_power_mode_ack_failed(rtwdev, true);
+		clear_bit(RTW_FLAG_LEISURE_PS_CPWM, rtwdev->flags);
+	}
+
 	request = rtw_read8(rtwdev, rtwdev->hci.rpwm_addr);
 	confirm = rtw_read8(rtwdev, rtwdev->hci.cpwm_addr);
 
@@ -191,25 +407,19 @@ void rtw_power_mode_change(struct rtw_dev *rtwdev, bool enter)
 	if (rtw_fw_feature_check(&rtwdev->fw, FW_FEATURE_TX_WAKE))
 		request |= POWER_TX_WAKE;
 
+	if (enter) {
+		WRITE_ONCE(conf->cpwm_confirm, confirm);
+		set_bit(RTW_FLAG_LEISURE_PS_CPWM, rtwdev->flags);
+	}
+
 	rtw_write8(rtwdev, rtwdev->hci.rpwm_addr, request);
 
+	if (enter)
+		return;
+
 	/* Check firmware get the power requset and ack via cpwm register */
-	ret = read_poll_timeout_atomic(rtw_read8, polling,
-				       (polling ^ confirm) & BIT_RPWM_TOGGLE,
-				       100, 15000, true, rtwdev,
-				       rtwdev->hci.cpwm_addr);
-	if (ret) {
-		/* Hit here means that driver failed to get an ack from firmware.
-		 * The reason could be that hardware is locked at Deep sleep,
-		 * so most of the hardware circuits are not working, even
-		 * register read/write; or firmware is locked in some state and
-		 * cannot get the request. It should be treated as fatal error
-		 * and requires an entire analysis about the firmware/hardware.
-		 */
-		WARN(1, "firmware failed to ack driver for %s Deep Power mode\n",
-		     enter ? "entering" : "leaving");
-		rtw_fw_dump_dbg_info(rtwdev);
-	}
+	if (rtw_power_mode_wait_ack(rtwdev, confirm))
+		rtw_power_mode_ack_failed(rtwdev, false);
 }
 EXPORT_SYMBOL(rtw_power_mode_change);
 
@@ -218,77 +428,152 @@ static void __rtw_leave_lps_deep(struct rtw_dev *rtwdev)
 	rtw_hci_deep_ps(rtwdev, false);
 }
 
-static int __rtw_fw_leave_lps_check_reg(struct rtw_dev *rtwdev)
+/* Leaving LPS completes asynchronously. Firmware sends a null packet to
+ * inform the AP, and once the AP acks it, restores REG_TCR (and reports
+ * C2H_LPS_STATUS if supported). TX frames with the PS bit could go out
+ * before that, so the TX work holds the queued frames, and rtw_tx() the
+ * frames handed to it directly, while RTW_FLAG_LEISURE_PS_LEAVING is set.
+ * The TX work, and the DM half of a watch dog round waiting on the leave,
+ * are kicked on the ack. Callers that program the hardware right after
+ * leaving use rtw_leave_lps_sync() instead.
+ *
+ * Without the C2H, lps_leave_work polls REG_TCR every
+ * RTW_LPS_LEAVE_POLL_MS. With it, the work is only a timeout. If there
+ * is no ack within LEAVE_LPS_TIMEOUT, REG_TCR is restored directly.
+ */
+static const u32 rtw_lps_leave_hist_us[RTW_LPS_LEAVE_HIST_NUM - 1] = {
+	1000, 2000, 5000, 10000, 20000, 50000, 100000,
+};
+
+static bool rtw_fw_lps_c2h(struct rtw_dev *rtwdev)
 {
+	struct rtw_fw_state *fw;
+
+	if (test_bit(RTW_FLAG_WOWLAN, rtwdev->flags))
+		fw = &rtwdev->wow_fw;
+	else
+		fw = &rtwdev->fw;
+
+	return rtw_fw_feature_check(fw, FW_FEATURE_LPS_C2H);
+}
+
+static void rtw_lps_stats_leave_done(struct rtw_dev *rtwdev)
+{
+	struct rtw_lps_stats *stats = &rtwdev->lps_conf.policy.stats;
+	u32 leave_us;
 	int i;
 
-	/* Driver needs to wait for firmware to leave LPS state
-	 * successfully. Firmware will send null packet to inform AP,
-	 * and see if AP sends an ACK back, then firmware will restore
-	 * the REG_TCR register.
-	 *
-	 * If driver does not wait for firmware, null packet with
-	 * PS bit could be sent due to incorrect REG_TCR setting.
-	 *
-	 * In our test, 100ms should be enough for firmware to finish
-	 * the flow. If REG_TCR Register is still incorrect after 100ms,
-	 * just modify it directly, and throw a warn message.
-	 */
-	for (i = 0 ; i < LEAVE_LPS_TRY_CNT; i++) {
-		if (rtw_read32_mask(rtwdev, REG_TCR, BIT_PWRMGT_HWDATA_EN) == 0)
-			return 0;
-		msleep(20);
-	}
+	leave_us = ktime_us_delta(ktime_get(), stats->leave_start);
+	stats->leave_last_us = leave_us;
+	stats->leave_max_us = max(stats->leave_max_us, leave_us);
+	stats->leave_sum_us += leave_us;
 
-	return -EBUSY;
+	for (i = 0; i < ARRAY_SIZE(rtw_lps_leave_hist_us); i++)
+		if (leave_us < rtw_lps_leave_hist_us[i])
+			break;
+	stats->leave_hist[i]++;
 }
 
-static  int __rtw_fw_leave_lps_check_c2h(struct rtw_dev *rtwdev)
+/* firmware is out of LPS, may be called from C2H in atomic context */
+void rtw_lps_leave_done(struct rtw_dev *rtwdev)
 {
-	if (wait_for_completion_timeout(&rtwdev->lps_leave_check,
-					LEAVE_LPS_TIMEOUT))
-		return 0;
-	return -EBUSY;
+	if (!test_and_clear_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+		return;
+
+	/* a stale timeout must not hit the next leave */
+	cancel_delayed_work(&rtwdev->lps_leave_work);
+	rtw_lps_stats_leave_done(rtwdev);
+	wake_up(&rtwdev->lps_leave_wait);
+	queue_work(rtwdev->tx_wq, &rtwdev->tx_work);
+	if (READ_ONCE(rtwdev->watch_dog_sched.dm_pending))
+		ieee80211_queue_work(rtwdev->hw, &rtwdev->watch_dog_dm_work);
 }
 
-static void rtw_fw_leave_lps_check(struct rtw_dev *rtwdev)
+/* drop a pending leave check, e.g. when entering LPS again */
+static void rtw_lps_leave_cancel(struct rtw_dev *rtwdev)
 {
-	bool ret = false;
-	struct rtw_fw_state *fw;
+	if (!test_and_clear_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+		return;
 
-	if (test_bit(RTW_FLAG_WOWLAN, rtwdev->flags))
-		fw = &rtwdev->wow_fw;
-	else
-		fw = &rtwdev->fw;
+	/* back in LPS, the DM of this round is skipped */
+	WRITE_ONCE(rtwdev->watch_dog_sched.dm_pending, false);
+	cancel_delayed_work(&rtwdev->lps_leave_work);
+	queue_work(rtwdev->tx_wq, &rtwdev->tx_work);
+}
 
-	if (rtw_fw_feature_check(fw, FW_FEATURE_LPS_C2H))
-		ret = __rtw_fw_leave_lps_check_c2h(rtwdev);
-	else
-		ret = __rtw_fw_leave_lps_check_reg(rtwdev);
+/* true once the leave is done, polls REG_TCR for firmware without C2H */
+static bool rtw_lps_leave_acked(struct rtw_dev *rtwdev)
+{
+	if (!test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+		return true;
 
-	if (ret) {
-		rtw_write32_clr(rtwdev, REG_TCR, BIT_PWRMGT_HWDATA_EN);
-		rtw_warn_once(rtwdev, "firmware failed to leave lps state\n");
-		rtw_fw_dump_dbg_info(rtwdev);
+	if (rtw_fw_lps_c2h(rtwdev) ||
+	    rtw_read32_mask(rtwdev, REG_TCR, BIT_PWRMGT_HWDATA_EN))
+		return false;
+
+	rtw_lps_leave_done(rtwdev);
+	return true;
+}
+
+static void rtw_lps_leave_timeout(struct rtw_dev *rtwdev)
+{
+	rtw_write32_clr(rtwdev, REG_TCR, BIT_PWRMGT_HWDATA_EN);
+	rtw_warn_once(rtwdev, "firmware failed to leave lps state\n");
+	rtw_fw_dump_dbg_info(rtwdev);
+	rtw_lps_leave_done(rtwdev);
+}
+
+void rtw_lps_leave_work(struct work_struct *work)
+{
+	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev,
+					      lps_leave_work.work);
+	struct rtw_lps_conf *conf = &rtwdev->lps_conf;
+
+	mutex_lock(&rtwdev->mutex);
+
+	if (rtw_lps_leave_acked(rtwdev))
+		goto unlock;
+
+	if (!rtw_fw_lps_c2h(rtwdev) &&
+	    ++conf->leave_check_cnt < LEAVE_LPS_TRY_CNT) {
+		ieee80211_queue_delayed_work(rtwdev->hw,
+					     &rtwdev->lps_leave_work,
+					     msecs_to_jiffies(RTW_LPS_LEAVE_POLL_MS));
+		goto unlock;
 	}
+
+	rtw_lps_leave_timeout(rtwdev);
+
+unlock:
+	mutex_unlock(&rtwdev->mutex);
 }
 
-static void rtw_fw_leave_lps_check_prepare(struct rtw_dev *rtwdev)
+static void rtw_lps_leave_check_start(struct rtw_dev *rtwdev)
 {
-	struct rtw_fw_state *fw;
+	struct rtw_lps_conf *conf = &rtwdev->lps_conf;
+	unsigned long delay;
 
-	if (test_bit(RTW_FLAG_WOWLAN, rtwdev->flags))
-		fw = &rtwdev->wow_fw;
+	conf->leave_check_cnt = 0;
+	conf->policy.stats.leave_start = ktime_get();
+	set_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags);
+
+	if (rtw_fw_lps_c2h(rtwdev))
+		delay = LEAVE_LPS_TIMEOUT;
 	else
-		fw = &rtwdev->fw;
+		delay = msecs_to_jiffies(RTW_LPS_LEAVE_POLL_MS);
 
-	if (rtw_fw_feature_check(fw, FW_FEATURE_LPS_C2H))
-		reinit_completion(&rtwdev->lps_leave_check);
+	/* drop a check still pending from an earlier leave */
+	cancel_delayed_work(&rtwdev->lps_leave_work);
+	ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->lps_leave_work, delay);
 }
 
 static void rtw_leave_lps_core(struct rtw_dev *rtwdev)
 {
 	struct rtw_lps_conf *conf = &rtwdev->lps_conf;
+	struct rtw_lps_stats *stats = &conf->policy.stats;
+
+	stats->leave_cnt++;
+	stats->residency_us += ktime_us_delta(ktime_get(), stats->enter_time);
 
 	conf->state = RTW_ALL_ON;
 	conf->awake_interval = 1;
@@ -296,11 +581,12 @@ static void rtw_leave_lps_core(struct rtw_dev *rtwdev)
 	conf->smart_ps = 0;
 
 	rtw_hci_link_ps(rtwdev, false);
-	rtw_fw_leave_lps_check_prepare(rtwdev);
+	rtw_lps_leave_check_start(rtwdev);
 	rtw_fw_set_pwr_mode(rtwdev);
-	rtw_fw_leave_lps_check(rtwdev);
 
 	clear_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags);
+	/* the firmware drove the RF while we were asleep */
+	rtw_phy_rf_shadow_invalidate(rtwdev);
 
 	rtw_coex_lps_notify(rtwdev, COEX_LPS_DISABLE);
 }
@@ -334,6 +620,8 @@ static void rtw_enter_lps_core(struct rtw_dev *rtwdev)
 {
 	struct rtw_lps_conf *conf = &rtwdev->lps_conf;
 
+	rtw_lps_leave_cancel(rtwdev);
+
 	conf->state = RTW_RF_OFF;
 	conf->awake_interval = 1;
 	conf->rlbm = 1;
@@ -345,6 +633,9 @@ static void rtw_enter_lps_core(struct rtw_dev *rtwdev)
 	rtw_hci_link_ps(rtwdev, true);
 
 	set_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags);
+
+	conf->policy.stats.enter_cnt++;
+	conf->policy.stats.enter_time = ktime_get();
 }
 
 static void __rtw_enter_lps(struct rtw_dev *rtwdev, u8 port_id)
@@ -397,6 +688,32 @@ void rtw_leave_lps(struct rtw_dev *rtwdev)
 	__rtw_leave_lps(rtwdev);
 }
 
+/* Leave LPS and wait for the firmware ack, for callers that go on to
+ * program BB/RF or switch channels right away. The mutex is dropped
+ * while waiting, so the leave check and the other users of the device
+ * can run; state read before the call may have changed on return.
+ */
+void rtw_leave_lps_sync(struct rtw_dev *rtwdev)
+{
+	lockdep_assert_held(&rtwdev->mutex);
+
+	rtw_leave_lps(rtwdev);
+
+	if (!test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+		return;
+
+	mutex_unlock(&rtwdev->mutex);
+	/* lps_leave_work ends the leave within LEAVE_LPS_TIMEOUT */
+	wait_event_timeout(rtwdev->lps_leave_wait,
+			   !test_bit(RTW_FLAG_LEISURE_PS_LEAVING,
+				     rtwdev->flags),
+			   2 * LEAVE_LPS_TIMEOUT);
+	mutex_lock(&rtwdev->mutex);
+
+	if (test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+		rtw_lps_leave_timeout(rtwdev);
+}
+
 void rtw_leave_lps_deep(struct rtw_dev *rtwdev)
 {
 	lockdep_assert_held(&rtwdev->mutex);
@@ -404,6 +721,112 @@ void rtw_leave_lps_deep(struct rtw_dev *rtwdev)
 	__rtw_leave_lps_deep(rtwdev);
 }
 
+static bool rtw_lps_policy_traffic(struct rtw_dev *rtwdev)
+{
+	struct rtw_traffic_stats *stats = &rtwdev->stats;
+
+	if (stats->tx_cnt > RTW_LPS_THRESHOLD ||
+	    stats->rx_cnt > RTW_LPS_THRESHOLD)
+		return false;
+
+	/* On 8723BS the firmware's per-packet wake latency out of LPS
+	 * throttles bursty traffic hard (uplink TCP ~3x lower, latency spikes
+	 * into the 100s of ms). A single quiet 2s window is hit constantly by
+	 * a normal bursty session, so gate LPS on the smoothed throughput
+	 * instead and only sleep after sustained idle.
+	 */
+	if (rtw_is_8723bs_sdio(rtwdev) &&
+	    (stats->tx_throughput || stats->rx_throughput))
+		return false;
+
+	return true;
+}
+
+/* an active AC turns idle after no frame for its timeout */
+static void rtw_lps_policy_age(struct rtw_dev *rtwdev)
+{
+	struct rtw_lps_policy *policy = &rtwdev->lps_conf.policy;
+	unsigned long now = jiffies;
+	u32 timeout_ms;
+	u8 ac;
+
+	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++) {
+		if (!test_bit(ac, &policy->active_acs))
+			continue;
+
+		timeout_ms = policy->idle_timeout_ms;
+		if (ac == IEEE80211_AC_VO || ac == IEEE80211_AC_VI)
+			timeout_ms = max(timeout_ms, policy->rt_timeout_ms);
+
+		if (time_before(now, READ_ONCE(policy->last_active[ac]) +
+				     msecs_to_jiffies(timeout_ms)))
+			continue;
+
+		clear_bit(ac, &policy->active_acs);
+	}
+}
+
+static bool rtw_lps_policy_idle(struct rtw_dev *rtwdev)
+{
+	return !READ_ONCE(rtwdev->lps_conf.policy.active_acs);
+}
+
+static const struct rtw_lps_policy_ops {
+	const char *name;
+	bool (*allow)(struct rtw_dev *rtwdev);
+} rtw_lps_policy_ops[RTW_LPS_POLICY_NUM] = {
+	[RTW_LPS_POLICY_TRAFFIC] = {
+		.name = "traffic",
+		.allow = rtw_lps_policy_traffic,
+	},
+	[RTW_LPS_POLICY_IDLE] = {
+		.name = "idle",
+		.allow = rtw_lps_policy_idle,
+	},
+};
+
+void rtw_lps_policy_init(struct rtw_dev *rtwdev)
+{
+	struct rtw_lps_policy *policy = &rtwdev->lps_conf.policy;
+
+	policy->type = RTW_LPS_POLICY_TRAFFIC;
+	policy->idle_timeout_ms = RTW_LPS_IDLE_TIMEOUT_MS;
+	policy->rt_timeout_ms = RTW_LPS_RT_TIMEOUT_MS;
+	policy->active_gap_ms = RTW_LPS_ACTIVE_GAP_MS;
+}
+
+/* called once per watch dog round, whether the traffic allows LPS */
+bool rtw_lps_policy_allow(struct rtw_dev *rtwdev)
+{
+	struct rtw_lps_policy *policy = &rtwdev->lps_conf.policy;
+
+	rtw_lps_policy_age(rtwdev);
+
+	return rtw_lps_policy_ops[policy->type].allow(rtwdev);
+}
+
+const char *rtw_lps_policy_name(enum rtw_lps_policy_type type)
+{
+	if (type >= RTW_LPS_POLICY_NUM)
+		return "unknown";
+
+	return rtw_lps_policy_ops[type].name;
+}
+
+int rtw_lps_policy_set(struct rtw_dev *rtwdev, const char *name)
+{
+	int i;
+
+	for (i = 0; i < RTW_LPS_POLICY_NUM; i++) {
+		if (sysfs_streq(name, rtw_lps_policy_ops[i].name)) {
+			rtwdev->lps_conf.policy.type = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
 struct rtw_vif_recalc_lps_iter_data {
 	struct rtw_dev *rtwdev;
 	struct ieee80211_vif *found_vif;
@@ -7,6 +7,10 @@
 
 #define RTW_LPS_THRESHOLD	50
 
+#define RTW_LPS_IDLE_TIMEOUT_MS	2000
+#define RTW_LPS_RT_TIMEOUT_MS	5000
+#define RTW_LPS_ACTIVE_GAP_MS	200
+
 #define POWER_MODE_ACK		BIT(6)
 #define POWER_MODE_PG		BIT(4)
 #define POWER_TX_WAKE		BIT(1)
@@ -14,15 +18,45 @@
 
 #define LEAVE_LPS_TRY_CNT	5
 #define LEAVE_LPS_TIMEOUT	msecs_to_jiffies(100)
+#define RTW_LPS_LEAVE_POLL_MS	20
+#define RTW_CPWM_POLL_US	100
 
 int rtw_enter_ips(struct rtw_dev *rtwdev);
 int rtw_leave_ips(struct rtw_dev *rtwdev);
 
 void rtw_power_mode_change(struct rtw_dev *rtwdev, bool enter);
+void rtw_power_mode_ack(struct rtw_dev *rtwdev);
 void rtw_enter_lps(struct rtw_dev *rtwdev, u8 port_id);
 void rtw_leave_lps(struct rtw_dev *rtwdev);
+void rtw_leave_lps_sync(struct rtw_dev *rtwdev);
 void rtw_leave_lps_deep(struct rtw_dev *rtwdev);
+void rtw_lps_leave_done(struct rtw_dev *rtwdev);
+void rtw_lps_leave_work(struct work_struct *work);
 enum rtw_lps_deep_mode rtw_get_lps_deep_mode(struct rtw_dev *rtwdev);
 void rtw_recalc_lps(struct rtw_dev *rtwdev, struct ieee80211_vif *new_vif);
+void rtw_lps_policy_init(struct rtw_dev *rtwdev);
+bool rtw_lps_policy_allow(struct rtw_dev *rtwdev);
+const char *rtw_lps_policy_name(enum rtw_lps_policy_type type);
+int rtw_lps_policy_set(struct rtw_dev *rtwdev, const char *name);
+
+/* unicast data of @ac seen, two frames within active_gap_ms make the AC
+ * active until it stays idle for the policy timeout
+ */
+static inline void rtw_lps_policy_activity(struct rtw_dev *rtwdev, u8 ac)
+{
+	struct rtw_lps_policy *policy = &rtwdev->lps_conf.policy;
+	unsigned long now = jiffies;
+	unsigned long last;
+
+	last = READ_ONCE(policy->last_active[ac]);
+	if (last == now)
+		return;
+
+	WRITE_ONCE(policy->last_active[ac], now);
+
+	if (!test_bit(ac, &policy->active_acs) &&
+	    time_before(now, last + msecs_to_jiffies(policy->active_gap_ms)))
+		set_bit(ac, &policy->active_acs);
+}
 
 #endif
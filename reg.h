@@ -970,6 +970,8 @@
 #define BIT_USB3_PHY_ADR_MASK	GENMASK(5, 0)
 
 #define RF_MODE		0x00
+#define RF_MODE_MASK	GENMASK(19, 16)
+#define RF_MODE_STANDBY	0x1
 #define RF_MODOPT	0x01
 #define RF_WLINT	0x01
 #define RF_WLSEL	0x02
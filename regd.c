@@ -487,6 +487,7 @@ void rtw_regd_notifier(struct wiphy *wiphy, struct regulatory_request *request)
 			  request->initiator);
 
 	rtw_phy_adaptivity_set_mode(rtwdev);
+	rtw_phy_tx_pwr_cache_flush(rtwdev);
 	rtw_phy_set_tx_power_level(rtwdev, hal->current_channel);
 	mutex_unlock(&rtwdev->mutex);
 }
@@ -2123,60 +2123,44 @@ static void rtw8723b_reassert_rx_path(struct rtw_dev *rtwdev, const char *tag)
  * hal/rtl8723b/rtl8723b_phycfg.c: phy_PostSetBwMode8723B
  * hal/rtl8723b/rtl8723b_rf6052.c: PHY_RF6052SetBandwidth8723B
  */
-static void rtw8723b_set_channel_rf(struct rtw_dev *rtwdev, u8 channel, u8 bw)
+static void rtw8723b_chan_img_rf(struct rtw_dev *rtwdev,
+				 struct rtw_chan_img *img, u8 channel, u8 bw)
 {
-
-	/* NOTE: this func is ready! */
-
-	u32 rf_cfgch_a;
-	u32 rf_cfgch_b = 0;
-
-	rf_cfgch_a = rtw_read_rf(rtwdev, RF_PATH_A, RF_CFGCH, RFREG_MASK);
-	if (rtwdev->hal.rf_path_num > 1)
-		rf_cfgch_b = rtw_read_rf(rtwdev, RF_PATH_B, RF_CFGCH, RFREG_MASK);
-
-	// DEBUG
-
-	rf_cfgch_a &= ~RFCFGCH_CHANNEL_MASK;
-	if (rtwdev->hal.rf_path_num > 1)
-		rf_cfgch_b &= ~RFCFGCH_CHANNEL_MASK;
-
-	rf_cfgch_a |= (channel & RFCFGCH_CHANNEL_MASK);
-	if (rtwdev->hal.rf_path_num > 1)
-		rf_cfgch_b |= (channel & RFCFGCH_CHANNEL_MASK);
-
-	rf_cfgch_a &= ~RFCFGCH_BW_MASK;
+	u32 rf_cfgch = channel & RFCFGCH_CHANNEL_MASK;
+	u8 path;
 
 	switch (bw) {
 	case RTW_CHANNEL_WIDTH_20:
-		rf_cfgch_a |= RFCFGCH_BW_20M;
+		rf_cfgch |= RFCFGCH_BW_20M;
 		break;
 	case RTW_CHANNEL_WIDTH_40:
-		rf_cfgch_a |= RFCFGCH_BW_40M;
+		rf_cfgch |= RFCFGCH_BW_40M;
 		break;
 	default:
 		break;
 	}
 
-	if (rtwdev->hal.rf_path_num > 1) {
-		/* the vendor driver writes A value also to B */
-		rf_cfgch_b = rf_cfgch_a;
-	}
-
-
-	rtw_write_rf(rtwdev, RF_PATH_A, RF_CFGCH, RFREG_MASK, rf_cfgch_a);
-	if (rtwdev->hal.rf_path_num > 1)
-		rtw_write_rf(rtwdev, RF_PATH_B, RF_CFGCH, RFREG_MASK, rf_cfgch_b);
-
-	rf_cfgch_a = rtw_read_rf(rtwdev, RF_PATH_A, RF_CFGCH, RFREG_MASK);
-	if (rtwdev->hal.rf_path_num > 1)
-		rf_cfgch_b = rtw_read_rf(rtwdev, RF_PATH_B, RF_CFGCH, RFREG_MASK);
-
+	/* the vendor driver writes A value also to B */
+	for (path = RF_PATH_A; path <= RF_PATH_B; path++)
+		rtw_phy_chan_img_add(img, RTW_CHAN_REG_RF, path, RF_CFGCH,
+				     path < rtwdev->hal.rf_path_num ?
+				     RFCFGCH_CHANNEL_MASK | RFCFGCH_BW_MASK : 0,
+				     rf_cfgch);
 
 	/* NOTE: not called in vendor driver */
 	// rtw8723b_spur_cal(rtwdev, channel);
+}
 
-
+/* what rtw_set_channel_mac() programs on a WCPU_8051 chip */
+static void rtw8723b_chan_img_mac(struct rtw_chan_img *img, u8 bw,
+				  u8 primary_ch_idx)
+{
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_8, 0, REG_DATA_SC, MASKBYTE0,
+			     BIT_TXSC_20M(primary_ch_idx) | BIT_TXSC_40M(0));
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_32, 0, REG_WMAC_TRXPTCL_CTL,
+			     BIT_RFMOD,
+			     bw == RTW_CHANNEL_WIDTH_40 ?
+			     BIT_RFMOD_40M >> __ffs(BIT_RFMOD) : 0);
 }
 
 /* based on vendor functions
@@ -2184,45 +2168,44 @@ static void rtw8723b_set_channel_rf(struct rtw_dev *rtwdev, u8 channel, u8 bw)
  * hal/rtl8723b/rtl8723b_phycfg.c: phy_PostSetBwMode8723B
  * hal/rtl8723b/rtl8723b_rf6052.c: PHY_RF6052SetBandwidth8723B
  */
-static void rtw8723b_set_channel_bb(struct rtw_dev *rtwdev, u8 bw,
-				    u8 primary_ch_idx)
-{
-	/* NOTE: this func is ready! */
-
-
-	switch (bw) {
-	case RTW_CHANNEL_WIDTH_20:
-		rtw_write32_mask(rtwdev, REG_FPGA0_RFMOD, BIT_MASK_RFMOD, 0x0);
-		rtw_write32_mask(rtwdev, REG_FPGA1_RFMOD, BIT_MASK_RFMOD, 0x0);
-		rtw_write32_mask(rtwdev, REG_OFDM0_TX_PSD_NOISE,
-				 GENMASK(31, 30), 0x0);
-		break;
-	case RTW_CHANNEL_WIDTH_40:
-		rtw_write32_mask(rtwdev, REG_FPGA0_RFMOD, BIT_MASK_RFMOD, 0x1);
-		rtw_write32_mask(rtwdev, REG_FPGA1_RFMOD, BIT_MASK_RFMOD, 0x1);
-		rtw_write32_mask(rtwdev, REG_CCK0_SYS, BIT_CCK_SIDE_BAND,
-				 primary_ch_idx == RTW_SC_20_UPPER ? 1 : 0);
-		rtw_write32_mask(rtwdev, REG_OFDM_FA_RSTD_11N, 0xc00,
-				 primary_ch_idx == RTW_SC_20_UPPER ? 2 : 1);
-		rtw_write32_mask(rtwdev, REG_BB_PWR_SAV5_11N, GENMASK(27, 26),
-				 primary_ch_idx == RTW_SC_20_UPPER ? 1 : 2);
-		break;
-	default:
-		break;
-	}
+static void rtw8723b_chan_img_bb(struct rtw_chan_img *img, u8 bw,
+				 u8 primary_ch_idx)
+{
+	bool bw20 = bw == RTW_CHANNEL_WIDTH_20;
+	bool bw40 = bw == RTW_CHANNEL_WIDTH_40;
+	bool upper = primary_ch_idx == RTW_SC_20_UPPER;
+
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_32, 0, REG_FPGA0_RFMOD,
+			     bw20 || bw40 ? BIT_MASK_RFMOD : 0, bw40);
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_32, 0, REG_FPGA1_RFMOD,
+			     bw20 || bw40 ? BIT_MASK_RFMOD : 0, bw40);
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_32, 0, REG_OFDM0_TX_PSD_NOISE,
+			     bw20 ? GENMASK(31, 30) : 0, 0x0);
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_32, 0, REG_CCK0_SYS,
+			     bw40 ? BIT_CCK_SIDE_BAND : 0, upper ? 1 : 0);
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_32, 0, REG_OFDM_FA_RSTD_11N,
+			     bw40 ? 0xc00 : 0, upper ? 2 : 1);
+	rtw_phy_chan_img_add(img, RTW_CHAN_REG_32, 0, REG_BB_PWR_SAV5_11N,
+			     bw40 ? GENMASK(27, 26) : 0, upper ? 1 : 2);
 }
 
 static void rtw8723b_set_channel(struct rtw_dev *rtwdev, u8 channel,
 				 u8 bw, u8 primary_chan_idx)
 {
+	struct rtw_chan_img img = {};
+
 	/* NOTE: this func is ready! */
 
 
 	rtw8723b_dump_bb_rf(rtwdev, "before_set_channel", channel, bw);
 
-	rtw8723b_set_channel_rf(rtwdev, channel, bw);
-	rtw_set_channel_mac(rtwdev, channel, bw, primary_chan_idx);
-	rtw8723b_set_channel_bb(rtwdev, bw, primary_chan_idx);
+	/* RF, then MAC, then BB like the vendor driver; fields left as the
+	 * previous channel programmed them are not written again
+	 */
+	rtw8723b_chan_img_rf(rtwdev, &img, channel, bw);
+	rtw8723b_chan_img_mac(&img, bw, primary_chan_idx);
+	rtw8723b_chan_img_bb(&img, bw, primary_chan_idx);
+	rtw_phy_chan_img_apply(rtwdev, &img);
 	rtw8723b_reassert_rx_path(rtwdev, "set_channel");
 
 	if (rtw8723b_sdio_needs_rx_path_fix(rtwdev)) {
@@ -2975,17 +2958,38 @@ void rtw8723b_iqk_one_round(struct rtw_dev *rtwdev, s32 result[][IQK_NR], u8 t,
 /* vendor hal/phydm/halrf/rtl8723b/halrf_8723b_ce.c
  * function: phy_iq_calibrate_8723b / _phy_iq_calibrate_8723b
  */
-static void rtw8723b_phy_calibration(struct rtw_dev *rtwdev)
+static u8 rtw8723b_iqk_thermal(struct rtw_dev *rtwdev)
 {
+	if (rtwdev->efuse.thermal_meter[0] == 0xff)
+		return 0;
+
+	return rtw_read_rf(rtwdev, RF_PATH_A, RF_T_METER, 0xfc00);
+}
 
+static void rtw8723b_iqk_set_result(struct rtw_dev *rtwdev, const s32 result[])
+{
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	dm_info->iqk.result.s1_x = result[IQK_S1_TX_X];
+	dm_info->iqk.result.s1_y = result[IQK_S1_TX_Y];
+	dm_info->iqk.result.s0_x = result[IQK_S0_TX_X];
+	dm_info->iqk.result.s0_y = result[IQK_S0_TX_Y];
+	dm_info->iqk.done = true;
+}
+
+static void rtw8723b_phy_calibration_full(struct rtw_dev *rtwdev, u8 thermal)
+{
+
 	struct rtw8723x_iqk_backup_regs backup;
 	s32 result[IQK_ROUND_SIZE][IQK_NR];
 	u8 final_candidate = IQK_ROUND_INVALID;
+	ktime_t start = ktime_get();
 	u32 bt_control;
 	bool good;
 	u8 i, j;
 
+	BUILD_BUG_ON(IQK_NR != RTW_IQK_CACHE_RESULT_NR);
+
 	rtw_dbg(rtwdev, RTW_DBG_RFK, "[IQK] Start!\n");
 	if (rtw8723b_sdio_needs_rx_path_fix(rtwdev))
 		rtw_info(rtwdev,
@@ -3071,13 +3075,18 @@ iqk_done:
 	if (result[final_candidate][IQK_S0_TX_X])
 		rtw8723b_iqk_fill_b_matrix(rtwdev, result[final_candidate]);
 
-	dm_info->iqk.result.s1_x = result[final_candidate][IQK_S1_TX_X];
-	dm_info->iqk.result.s1_y = result[final_candidate][IQK_S1_TX_Y];
-	dm_info->iqk.result.s0_x = result[final_candidate][IQK_S0_TX_X];
-	dm_info->iqk.result.s0_y = result[final_candidate][IQK_S0_TX_Y];
-	dm_info->iqk.done = true;
+	rtw8723b_iqk_set_result(rtwdev, result[final_candidate]);
+	rtw_phy_iqk_cache_store(rtwdev, thermal, result[final_candidate],
+				ktime_us_delta(ktime_get(), start));
 
 out:
+	/* IQK borrows BB and RF registers the channel image also owns, and
+	 * the calibration engines may have updated RF registers themselves,
+	 * whether or not a candidate was found
+	 */
+	rtw_phy_chan_delta_invalidate(rtwdev);
+	rtw_phy_rf_shadow_invalidate(rtwdev);
+
 	/* restore RF path */
 	rtw_write32(rtwdev, REG_BB_SEL_BTG, backup.bb_sel_btg);
 
@@ -3139,6 +3148,42 @@ out:
 	rtw8723b_inform_rfk_status(rtwdev, false);
 }
 
+/* Reconnects to the same channel re-run the calibration, the matrices of
+ * a previous run at a similar temperature are just as good and only take
+ * a handful of register writes.
+ */
+static bool rtw8723b_iqk_cache_apply(struct rtw_dev *rtwdev, u8 thermal)
+{
+	struct rtw_iqk_cache_entry *ent;
+	ktime_t start = ktime_get();
+
+	ent = rtw_phy_iqk_cache_lookup(rtwdev, thermal);
+	if (!ent)
+		return false;
+
+	rtw8723b_iqk_fill_a_matrix(rtwdev, ent->result);
+	rtw8723b_iqk_fill_b_matrix(rtwdev, ent->result);
+	rtw8723b_iqk_set_result(rtwdev, ent->result);
+
+	rtw_phy_iqk_cache_hit(rtwdev, ent, ktime_us_delta(ktime_get(), start));
+
+	rtw_dbg(rtwdev, RTW_DBG_RFK,
+		"[IQK] cache hit ch_group %u bw %u thermal %u\n",
+		ent->ch_group, ent->bw, thermal);
+
+	return true;
+}
+
+static void rtw8723b_phy_calibration(struct rtw_dev *rtwdev)
+{
+	u8 thermal = rtw8723b_iqk_thermal(rtwdev);
+
+	if (rtw8723b_iqk_cache_apply(rtwdev, thermal))
+		return;
+
+	rtw8723b_phy_calibration_full(rtwdev, thermal);
+}
+
 static void rtw8723b_pwrtrack_set_ofdm_pwr(struct rtw_dev *rtwdev, s8 swing_idx,
 					   s8 txagc_idx)
 {
@@ -3308,8 +3353,11 @@ static void rtw8723b_phy_pwrtrack(struct rtw_dev *rtwdev)
 	//rtw8723x_pwrtrack_set_xtal(rtwdev, RF_PATH_A, delta);
 
 iqk:
-	if (do_iqk)
-		rtw8723b_phy_calibration(rtwdev);
+	/* thermal drifted past iqk_threshold, the cached result is stale */
+	if (do_iqk) {
+		dm_info->iqk_cache.forced++;
+		rtw8723b_phy_calibration_full(rtwdev, thermal_value);
+	}
 }
 
 static void rtw8723b_pwr_track(struct rtw_dev *rtwdev)
@@ -3767,6 +3815,15 @@ static const struct rtw_chip_ops rtw8723b_ops = {
 	.coex_set_wl_rx_gain	= rtw8723b_coex_set_wl_rx_gain,
 };
 
+/* RF registers only the host writes, masked writes to them skip the SIPI
+ * readback. RF_WLINT and RF_AC are left out, firmware and coex move them.
+ */
+static const struct rtw_rf_shadow_def rtw8723b_rf_shadow_def[] = {
+	{RF_CFGCH, BIT_LCK},
+	{RF_LUTWE, 0},
+	{0xed, 0},
+};
+
 const struct rtw_chip_info rtw8723b_hw_spec = {
 	.ops = &rtw8723b_ops,
 	.id = RTW_CHIP_TYPE_8723B,
@@ -3849,6 +3906,8 @@ const struct rtw_chip_info rtw8723b_hw_spec = {
 
 	.rf_sipi_addr = {0x840, 0x844},
 	.rf_sipi_read_addr = rtw8723x_common.rf_sipi_addr,
+	.rf_shadow_def = rtw8723b_rf_shadow_def,
+	.rf_shadow_def_num = ARRAY_SIZE(rtw8723b_rf_shadow_def),
 
 	.fix_rf_phy_num = 2,
 
@@ -393,8 +393,39 @@ static void __rtw8723x_cfg_ldo25(struct rtw_dev *rtwdev, bool enable)
 	rtw_write8(rtwdev, REG_LDO_EFUSE_CTRL + 3, ldo_pwr);
 }
 
+#define RTW8723X_TXAGC_REG_NUM	6
+
+struct rtw8723x_txagc_image {
+	u32 addr[RTW8723X_TXAGC_REG_NUM];
+	u32 mask[RTW8723X_TXAGC_REG_NUM];
+	u32 data[RTW8723X_TXAGC_REG_NUM];
+	int num;
+};
+
+static void rtw8723x_txagc_image_add(struct rtw8723x_txagc_image *img,
+				     const struct rtw_hw_reg *txagc, u8 pwr)
+{
+	int i;
+
+	for (i = 0; i < img->num; i++)
+		if (img->addr[i] == txagc->addr)
+			break;
+
+	if (i == img->num) {
+		if (WARN_ON(i == RTW8723X_TXAGC_REG_NUM))
+			return;
+		img->addr[i] = txagc->addr;
+		img->num++;
+	}
+
+	img->mask[i] |= txagc->mask;
+	img->data[i] &= ~txagc->mask;
+	img->data[i] |= ((u32)pwr << __ffs(txagc->mask)) & txagc->mask;
+}
+
 static void
-rtw8723x_set_tx_power_index_by_rate(struct rtw_dev *rtwdev, u8 path, u8 rs)
+rtw8723x_set_tx_power_index_by_rate(struct rtw_dev *rtwdev, u8 path, u8 rs,
+				    struct rtw8723x_txagc_image *img)
 {
 	struct rtw_hal *hal = &rtwdev->hal;
 	const struct rtw_hw_reg *txagc;
@@ -415,18 +446,29 @@ rtw8723x_set_tx_power_index_by_rate(struct rtw_dev *rtwdev, u8 path, u8 rs)
 			continue;
 		}
 
-		rtw_write32_mask(rtwdev, txagc->addr, txagc->mask, pwr_index);
+		rtw8723x_txagc_image_add(img, txagc, pwr_index);
 	}
 }
 
+/* four rates share a register, so build each register image first and
+ * hand whole images to rtw_phy_txagc_write()
+ */
 static void __rtw8723x_set_tx_power_index(struct rtw_dev *rtwdev)
 {
 	struct rtw_hal *hal = &rtwdev->hal;
-	int rs, path;
+	struct rtw8723x_txagc_image img;
+	int rs, path, i;
 
 	for (path = 0; path < hal->rf_path_num; path++) {
+		memset(&img, 0, sizeof(img));
+
 		for (rs = 0; rs <= RTW_RATE_SECTION_HT_1S; rs++)
-			rtw8723x_set_tx_power_index_by_rate(rtwdev, path, rs);
+			rtw8723x_set_tx_power_index_by_rate(rtwdev, path, rs,
+							    &img);
+
+		for (i = 0; i < img.num; i++)
+			rtw_phy_txagc_write(rtwdev, img.addr[i], img.mask[i],
+					    img.data[i]);
 	}
 }
 
@@ -696,8 +696,9 @@ rtw8821c_set_tx_power_index_by_rate(struct rtw_dev *rtwdev, u8 path,
 		*phy_pwr_idx |= ((u32)pwr_index << (shift * 8));
 		if (shift == 0x3 || rate == DESC_RATEVHT1SS_MCS9) {
 			rate_idx = rate & 0xfc;
-			rtw_write32(rtwdev, offset_txagc[path] + rate_idx,
-				    *phy_pwr_idx);
+			rtw_phy_txagc_write(rtwdev,
+					    offset_txagc[path] + rate_idx,
+					    MASKDWORD, *phy_pwr_idx);
 			*phy_pwr_idx = 0;
 		}
 	}
@@ -2728,9 +2728,9 @@ static void rtw8822c_set_tx_power_diff(struct rtw_dev *rtwdev, u8 rate,
 		      (pwr_idx[2] << 16) |
 		      (pwr_idx[3] << 24);
 
-	rtw_write32_mask(rtwdev, 0x1c90, BIT(15), 0x0);
-	rtw_write32_mask(rtwdev, offset_txagc + rate_idx, MASKDWORD,
-			 phy_pwr_idx);
+	/* 0x1c90[15] was cleared by rtw8822c_set_write_tx_power_ref() */
+	rtw_phy_txagc_write(rtwdev, offset_txagc + rate_idx, MASKDWORD,
+			    phy_pwr_idx);
 }
 
 static void rtw8822c_set_tx_power_index(struct rtw_dev *rtwdev)
@@ -758,6 +758,9 @@ void rtw88xxa_power_off(struct rtw_dev *rtwdev,
 	if (ori_fsmc0 & APS_FSMCO_HW_POWERDOWN)
 		rtw_write16_set(rtwdev, REG_APS_FSMCO, APS_FSMCO_HW_POWERDOWN);
 
+	rtw_phy_txagc_reset(rtwdev);
+	rtw_sec_cam_invalidate(rtwdev);
+
 	clear_bit(RTW_FLAG_POWERON, rtwdev->flags);
 }
 EXPORT_SYMBOL(rtw88xxa_power_off);
@@ -1610,8 +1613,9 @@ rtw88xxa_set_tx_power_index_by_rate(struct rtw_dev *rtwdev, u8 path,
 			if (rate >= DESC_RATEVHT1SS_MCS0)
 				rate_idx -= 0x10;
 
-			rtw_write32_mask(rtwdev, offset_txagc[path] + rate_idx,
-					 mask, *phy_pwr_idx);
+			rtw_phy_txagc_write(rtwdev,
+					    offset_txagc[path] + rate_idx,
+					    mask, *phy_pwr_idx);
 
 			*phy_pwr_idx = 0;
 		}
@@ -8,11 +8,37 @@
 #include "debug.h"
 #include "fw.h"
 
+static enum rtw_rate_class
+rtw_rx_status_rate_class(struct ieee80211_rx_status *rx_status)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 12, 0)
+	if (rx_status->encoding == RX_ENC_VHT)
+		return RTW_RATE_CLASS_VHT;
+	if (rx_status->encoding == RX_ENC_HT)
+		return RTW_RATE_CLASS_HT;
+#else
+	if (rx_status->flag & RX_FLAG_VHT)
+		return RTW_RATE_CLASS_VHT;
+	if (rx_status->flag & RX_FLAG_HT)
+		return RTW_RATE_CLASS_HT;
+#endif
+	if (rx_status->band == NL80211_BAND_2GHZ &&
+	    rx_status->rate_idx <= DESC_RATE11M - DESC_RATE1M)
+		return RTW_RATE_CLASS_CCK;
+
+	return RTW_RATE_CLASS_OFDM;
+}
+
+/* expects the rx_status to be already copied into skb->cb */
 void rtw_rx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 		  struct sk_buff *skb)
 {
+	struct rtw_pcpu_traffic_stats *pcpu;
+	enum rtw_rate_class rate_class;
 	struct ieee80211_hdr *hdr;
 	struct rtw_vif *rtwvif;
+	unsigned long flags;
+	u8 ac = IEEE80211_AC_BE;
 	__le16 fc;
 
 	hdr = (struct ieee80211_hdr *)skb->data;
@@ -23,8 +49,21 @@ void rtw_rx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 
 	if (!is_broadcast_ether_addr(hdr->addr1) &&
 	    !is_multicast_ether_addr(hdr->addr1)) {
-		rtwdev->stats.rx_unicast += skb->len;
-		rtwdev->stats.rx_cnt++;
+		if (ieee80211_is_data_qos(fc))
+			ac = ieee802_1d_to_ac[*ieee80211_get_qos_ctl(hdr) &
+					       IEEE80211_QOS_CTL_TAG1D_MASK];
+		rate_class = rtw_rx_status_rate_class(IEEE80211_SKB_RXCB(skb));
+
+		pcpu = rtw_traffic_stats_begin(rtwdev, &flags);
+		pcpu->cnt.rx_unicast += skb->len;
+		pcpu->cnt.rx_cnt++;
+		pcpu->cnt.rx_ac_bytes[ac] += skb->len;
+		pcpu->cnt.rx_ac_pkts[ac]++;
+		pcpu->cnt.rx_rate_pkts[rate_class]++;
+		rtw_traffic_stats_end(pcpu, flags);
+
+		rtw_lps_policy_activity(rtwdev, ac);
+
 		if (vif) {
 			rtwvif = (struct rtw_vif *)vif->drv_priv;
 			rtwvif->stats.rx_unicast += skb->len;
@@ -34,6 +73,17 @@ void rtw_rx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 }
 EXPORT_SYMBOL(rtw_rx_stats);
 
+void rtw_rx_stats_drop(struct rtw_dev *rtwdev)
+{
+	struct rtw_pcpu_traffic_stats *pcpu;
+	unsigned long flags;
+
+	pcpu = rtw_traffic_stats_begin(rtwdev, &flags);
+	pcpu->cnt.rx_drop++;
+	rtw_traffic_stats_end(pcpu, flags);
+}
+EXPORT_SYMBOL(rtw_rx_stats_drop);
+
 struct rtw_rx_addr_match_data {
 	struct rtw_dev *rtwdev;
 	struct ieee80211_hdr *hdr;
@@ -41,19 +91,71 @@ struct rtw_rx_addr_match_data {
 	u8 *bssid;
 };
 
+void rtw_rx_phy_stat_flush(struct rtw_dev *rtwdev)
+{
+	struct rtw_rx_phy_batch *batch = &rtwdev->rx_phy_batch;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pkt_count *cur_pkt_cnt = &dm_info->cur_pkt_count;
+	unsigned int rate;
+	u16 n;
+	u8 i;
+
+	if (!batch->pkt_num)
+		return;
+
+	dm_info->curr_rx_rate = batch->last_rate;
+	cur_pkt_cnt->num_bcn_pkt += batch->pkt_count.num_bcn_pkt;
+	for_each_set_bit(rate, batch->rates, DESC_RATE_MAX)
+		cur_pkt_cnt->num_qry_pkt[rate] += batch->pkt_count.num_qry_pkt[rate];
+
+	/* the batch mean goes in once per frame of the batch, so the filters
+	 * decay per frame as before and keep their time constant
+	 */
+	for (i = 0; i < RTW_EVM_NUM; i++) {
+		u8 evm;
+
+		if (!batch->evm_num[i])
+			continue;
+
+		evm = batch->evm_sum[i] / batch->evm_num[i];
+		for (n = 0; n < batch->evm_num[i]; n++)
+			ewma_evm_add(&dm_info->ewma_evm[i], evm);
+	}
+
+	for (i = 0; i < RTW_SNR_NUM; i++) {
+		s8 snr;
+
+		if (!batch->snr_num[i])
+			continue;
+
+		snr = batch->snr_sum[i] / batch->snr_num[i];
+		for (n = 0; n < batch->snr_num[i]; n++)
+			ewma_snr_add(&dm_info->ewma_snr[i], snr);
+	}
+
+	memset(batch, 0, offsetof(struct rtw_rx_phy_batch, skip_cnt));
+}
+EXPORT_SYMBOL(rtw_rx_phy_stat_flush);
+
 static void rtw_rx_phy_stat(struct rtw_dev *rtwdev,
 			    struct rtw_rx_pkt_stat *pkt_stat,
 			    struct ieee80211_hdr *hdr)
 {
+	struct rtw_rx_phy_batch *batch = &rtwdev->rx_phy_batch;
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
-	struct rtw_pkt_count *cur_pkt_cnt = &dm_info->cur_pkt_count;
 	u8 rate_ss, rate_ss_evm, evm_id;
 	u8 i, idx;
 
-	dm_info->curr_rx_rate = pkt_stat->rate;
+	batch->last_rate = pkt_stat->rate;
 
-	if (ieee80211_is_beacon(hdr->frame_control))
-		cur_pkt_cnt->num_bcn_pkt++;
+	if (ieee80211_is_beacon(hdr->frame_control)) {
+		batch->pkt_count.num_bcn_pkt++;
+	} else if (rtw_phy_stat_sample > 1 &&
+		   ++batch->skip_cnt < rtw_phy_stat_sample) {
+		goto pkt_num;
+	} else {
+		batch->skip_cnt = 0;
+	}
 
 	switch (pkt_stat->rate) {
 	case DESC_RATE1M...DESC_RATE11M:
@@ -88,17 +190,21 @@ static void rtw_rx_phy_stat(struct rtw_dev *rtwdev,
 
 	for (i = 0; i < rate_ss_evm; i++) {
 		idx = evm_id + i;
-		ewma_evm_add(&dm_info->ewma_evm[idx],
-			     dm_info->rx_evm_dbm[i]);
+		batch->evm_sum[idx] += dm_info->rx_evm_dbm[i];
+		batch->evm_num[idx]++;
 	}
 
 	for (i = 0; i < rtwdev->hal.rf_path_num; i++) {
 		idx = RTW_SNR_OFDM_A + 4 * rate_ss + i;
-		ewma_snr_add(&dm_info->ewma_snr[idx],
-			     dm_info->rx_snr[i]);
+		batch->snr_sum[idx] += dm_info->rx_snr[i];
+		batch->snr_num[idx]++;
 	}
 pkt_num:
-	cur_pkt_cnt->num_qry_pkt[pkt_stat->rate]++;
+	batch->pkt_count.num_qry_pkt[pkt_stat->rate]++;
+	__set_bit(pkt_stat->rate, batch->rates);
+
+	if (++batch->pkt_num >= RTW_RX_PHY_BATCH_MAX)
+		rtw_rx_phy_stat_flush(rtwdev);
 }
 
 static void rtw_rx_addr_match_iter(void *data, u8 *mac,
@@ -129,22 +235,178 @@ static void rtw_rx_addr_match_iter(void *data, u8 *mac,
 	ewma_rssi_add(&si->avg_rssi, pkt_stat->rssi);
 }
 
+static u32 rtw_rx_match_hash(const u8 *addr)
+{
+	return hash_64(ether_addr_to_u64(addr), RTW_RX_MATCH_HASH_BITS);
+}
+
+static struct rtw_sta_info *
+rtw_rx_match_find_sta(const struct rtw_rx_match_table *tbl, const u8 *addr,
+		      const struct rtw_vif *rtwvif)
+{
+	const struct rtw_rx_match_sta *entry;
+	u32 h = rtw_rx_match_hash(addr);
+	u8 idx;
+
+	while ((idx = tbl->sta_hash[h]) != RTW_RX_MATCH_HASH_EMPTY) {
+		entry = &tbl->stas[idx];
+		if (entry->rtwvif == rtwvif && ether_addr_equal(entry->addr, addr))
+			return entry->si;
+		h = (h + 1) & (RTW_RX_MATCH_HASH_SIZE - 1);
+	}
+
+	return NULL;
+}
+
+struct rtw_rx_match_build_data {
+	struct rtw_rx_match_table *tbl;
+	struct rtw_sta_info *del_si;
+	struct ieee80211_vif *del_vif;
+};
+
+static void rtw_rx_match_add_sta(struct rtw_rx_match_table *tbl,
+				 struct rtw_sta_info *si)
+{
+	struct rtw_rx_match_sta *entry;
+	u32 h;
+
+	if (tbl->sta_num >= RTW_MAX_MAC_ID_NUM)
+		return;
+
+	entry = &tbl->stas[tbl->sta_num];
+	ether_addr_copy(entry->addr, si->sta->addr);
+	entry->rtwvif = (struct rtw_vif *)si->vif->drv_priv;
+	entry->si = si;
+
+	h = rtw_rx_match_hash(entry->addr);
+	while (tbl->sta_hash[h] != RTW_RX_MATCH_HASH_EMPTY)
+		h = (h + 1) & (RTW_RX_MATCH_HASH_SIZE - 1);
+	tbl->sta_hash[h] = tbl->sta_num++;
+}
+
+static void rtw_rx_match_build_vif_iter(void *data, u8 *mac,
+					struct ieee80211_vif *vif)
+{
+	struct rtw_rx_match_build_data *build = data;
+	struct rtw_rx_match_table *tbl = build->tbl;
+	struct rtw_rx_match_vif *entry;
+
+	if (vif == build->del_vif || tbl->vif_num >= RTW_PORT_NUM)
+		return;
+
+	if (!vif->bss_conf.bssid || is_zero_ether_addr(vif->bss_conf.bssid))
+		return;
+
+	entry = &tbl->vifs[tbl->vif_num++];
+	ether_addr_copy(entry->bssid, vif->bss_conf.bssid);
+	ether_addr_copy(entry->addr, vif->addr);
+	entry->rtwvif = (struct rtw_vif *)vif->drv_priv;
+}
+
+static void rtw_rx_match_build_sta_iter(void *data, struct ieee80211_sta *sta)
+{
+	struct rtw_rx_match_build_data *build = data;
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+
+	if (si == build->del_si || si->vif == build->del_vif)
+		return;
+
+	rtw_rx_match_add_sta(build->tbl, si);
+}
+
+/* Rebuild the RX address lookup after a station or interface change.
+ * @add_si is not yet visible to mac80211 iteration when called from
+ * sta_add, @del_si and @del_vif are still visible while being removed.
+ * Callers that free the removed objects right after must wait for an
+ * RCU grace period. Without memory the lookup is dropped and RX falls
+ * back to walking the interfaces until the next successful rebuild.
+ */
+void rtw_rx_addr_match_update(struct rtw_dev *rtwdev,
+			      struct rtw_sta_info *add_si,
+			      struct rtw_sta_info *del_si,
+			      struct ieee80211_vif *del_vif)
+{
+	struct rtw_rx_match_build_data build = {
+		.del_si = del_si,
+		.del_vif = del_vif,
+	};
+	struct rtw_rx_match_table *old;
+
+	lockdep_assert_held(&rtwdev->mutex);
+
+	build.tbl = kzalloc(sizeof(*build.tbl), GFP_KERNEL);
+	if (build.tbl) {
+		memset(build.tbl->sta_hash, RTW_RX_MATCH_HASH_EMPTY,
+		       sizeof(build.tbl->sta_hash));
+		rtw_iterate_vifs_atomic(rtwdev, rtw_rx_match_build_vif_iter,
+					&build);
+		rtw_iterate_stas_atomic(rtwdev, rtw_rx_match_build_sta_iter,
+					&build);
+		if (add_si &&
+		    !rtw_rx_match_find_sta(build.tbl, add_si->sta->addr,
+					   (struct rtw_vif *)add_si->vif->drv_priv))
+			rtw_rx_match_add_sta(build.tbl, add_si);
+	}
+
+	old = rcu_dereference_protected(rtwdev->rx_match,
+					lockdep_is_held(&rtwdev->mutex));
+	rcu_assign_pointer(rtwdev->rx_match, build.tbl);
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
+void rtw_rx_addr_match_deinit(struct rtw_dev *rtwdev)
+{
+	kfree(rcu_dereference_protected(rtwdev->rx_match, true));
+	RCU_INIT_POINTER(rtwdev->rx_match, NULL);
+}
+
 static void rtw_rx_addr_match(struct rtw_dev *rtwdev,
 			      struct rtw_rx_pkt_stat *pkt_stat,
 			      struct ieee80211_hdr *hdr)
 {
 	struct rtw_rx_addr_match_data data = {};
+	const struct rtw_rx_match_table *tbl;
+	const struct rtw_rx_match_vif *entry;
+	struct rtw_sta_info *si;
+	u8 *bssid;
+	int i;
 
 	if (pkt_stat->crc_err || pkt_stat->icv_err || !pkt_stat->phy_status ||
 	    ieee80211_is_ctl(hdr->frame_control))
 		return;
 
-	data.rtwdev = rtwdev;
-	data.hdr = hdr;
-	data.pkt_stat = pkt_stat;
-	data.bssid = get_hdr_bssid(hdr);
+	bssid = get_hdr_bssid(hdr);
+
+	rcu_read_lock();
+	tbl = rcu_dereference(rtwdev->rx_match);
+	if (!tbl) {
+		rcu_read_unlock();
+
+		data.rtwdev = rtwdev;
+		data.hdr = hdr;
+		data.pkt_stat = pkt_stat;
+		data.bssid = bssid;
+
+		rtw_iterate_vifs_atomic(rtwdev, rtw_rx_addr_match_iter, &data);
+		return;
+	}
+
+	for (i = 0; i < tbl->vif_num; i++) {
+		entry = &tbl->vifs[i];
+		if (!ether_addr_equal(entry->bssid, bssid))
+			continue;
+
+		if (!(ether_addr_equal(entry->addr, hdr->addr1) ||
+		      ieee80211_is_beacon(hdr->frame_control)))
+			continue;
 
-	rtw_iterate_vifs_atomic(rtwdev, rtw_rx_addr_match_iter, &data);
+		rtw_rx_phy_stat(rtwdev, pkt_stat, hdr);
+		si = rtw_rx_match_find_sta(tbl, hdr->addr2, entry->rtwvif);
+		if (si)
+			ewma_rssi_add(&si->avg_rssi, pkt_stat->rssi);
+	}
+	rcu_read_unlock();
 }
 
 static void rtw_set_rx_freq_by_pktstat(struct rtw_rx_pkt_stat *pkt_stat,
@@ -203,6 +465,48 @@ fill_rx_status:
 }
 EXPORT_SYMBOL(rtw_update_rx_freq_from_ie);
 
+/* no A-MPDU lasts longer than the HT PPDU limit of 10 ms */
+#define RTW_RX_AGG_MAX_US	10000
+
+/* A run of QoS data MPDUs with the same ppdu_cnt, transmitter and rate is
+ * taken as one A-MPDU, its length is filed once the next one starts.
+ *
+ * ppdu_cnt is only two bits. When a multiple of four PPDUs in between
+ * is not accounted (other frame types, failed CRC), two A-MPDUs from
+ * the same station at the same rate still merge into one run. The TSF
+ * gap bounds a run to one PPDU duration, which catches most but not
+ * all of those cases. So the histogram is an estimate that leans
+ * towards longer aggregates.
+ */
+static void rtw_rx_agg_account(struct rtw_dev *rtwdev,
+			       struct rtw_rx_pkt_stat *pkt_stat,
+			       struct ieee80211_hdr *hdr)
+{
+	struct rtw_rx_agg_hist *hist = &rtwdev->rx_agg;
+
+	if (pkt_stat->crc_err || !ieee80211_is_data_qos(hdr->frame_control) ||
+	    is_multicast_ether_addr(hdr->addr1))
+		return;
+
+	if (hist->run && pkt_stat->ppdu_cnt == hist->ppdu_cnt &&
+	    pkt_stat->rate == hist->rate &&
+	    ether_addr_equal(hdr->addr2, hist->ta) &&
+	    pkt_stat->tsf_low - hist->tsf_low < RTW_RX_AGG_MAX_US) {
+		if (hist->run < U16_MAX)
+			hist->run++;
+		return;
+	}
+
+	if (hist->run)
+		hist->len[min_t(u8, fls(hist->run - 1),
+				RTW_RX_AGG_HIST_NUM - 1)]++;
+	hist->ppdu_cnt = pkt_stat->ppdu_cnt;
+	hist->rate = pkt_stat->rate;
+	ether_addr_copy(hist->ta, hdr->addr2);
+	hist->tsf_low = pkt_stat->tsf_low;
+	hist->run = 1;
+}
+
 static void rtw_rx_fill_rx_status(struct rtw_dev *rtwdev,
 				  struct rtw_rx_pkt_stat *pkt_stat,
 				  struct ieee80211_hdr *hdr,
@@ -281,6 +585,7 @@ static void rtw_rx_fill_rx_status(struct rtw_dev *rtwdev,
 	}
 
 	rtw_rx_addr_match(rtwdev, pkt_stat, hdr);
+	rtw_rx_agg_account(rtwdev, pkt_stat, hdr);
 
 	if (test_bit(RTW_FLAG_SCANNING, rtwdev->flags)) {
 		if (ieee80211_is_beacon(hdr->frame_control) ||
@@ -369,3 +674,7 @@ void rtw_rx_query_rx_desc(struct rtw_dev *rtwdev, void *rx_desc8,
 	rtw_rx_fill_rx_status(rtwdev, pkt_stat, hdr, rx_status);
 }
 EXPORT_SYMBOL(rtw_rx_query_rx_desc);
+
+#ifdef CONFIG_RTW88_KUNIT_TEST
+#include "rx_test.c"
+#endif
@@ -49,9 +49,16 @@ struct rtw_rx_desc {
 
 void rtw_rx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 		  struct sk_buff *skb);
+void rtw_rx_stats_drop(struct rtw_dev *rtwdev);
+void rtw_rx_phy_stat_flush(struct rtw_dev *rtwdev);
 void rtw_rx_query_rx_desc(struct rtw_dev *rtwdev, void *rx_desc8,
 			  void *rx_buf, struct rtw_rx_pkt_stat *pkt_stat,
 			  struct ieee80211_rx_status *rx_status);
+void rtw_rx_addr_match_update(struct rtw_dev *rtwdev,
+			      struct rtw_sta_info *add_si,
+			      struct rtw_sta_info *del_si,
+			      struct ieee80211_vif *del_vif);
+void rtw_rx_addr_match_deinit(struct rtw_dev *rtwdev);
 void rtw_update_rx_freq_from_ie(struct rtw_dev *rtwdev, struct sk_buff *skb,
 				struct ieee80211_rx_status *rx_status,
 				struct rtw_rx_pkt_stat *pkt_stat);
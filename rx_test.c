@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#include <kunit/test.h>
+
+#define RTW_RX_TEST_FRAMES	100000
+
+struct rtw_rx_test_env {
+	struct rtw_rx_match_table *tbl;
+	struct ieee80211_vif *vif;
+	struct ieee80211_hdr *hdrs;
+	int hdr_num;
+};
+
+static void rtw_rx_test_addr(u8 *addr, u8 id)
+{
+	static const u8 base[ETH_ALEN] = {0x02, 0x1c, 0x7a, 0x00, 0x00, 0x00};
+
+	ether_addr_copy(addr, base);
+	addr[3] = id * 37;
+	addr[4] = id * 11;
+	addr[5] = id;
+}
+
+/* an AP interface with @sta_num associated stations, and one data frame
+ * from each of them plus one from a station that is not associated
+ */
+static void rtw_rx_test_env(struct kunit *test, struct rtw_rx_test_env *env,
+			    int sta_num)
+{
+	struct rtw_rx_match_table *tbl;
+	struct rtw_rx_match_vif *entry;
+	struct ieee80211_sta *sta;
+	struct ieee80211_hdr *hdr;
+	struct rtw_sta_info *si;
+	int i;
+
+	tbl = kunit_kzalloc(test, sizeof(*tbl), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, tbl);
+	memset(tbl->sta_hash, RTW_RX_MATCH_HASH_EMPTY, sizeof(tbl->sta_hash));
+
+	env->vif = kunit_kzalloc(test, sizeof(*env->vif) +
+				 sizeof(struct rtw_vif), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, env->vif);
+	rtw_rx_test_addr(env->vif->addr, 0);
+
+	entry = &tbl->vifs[tbl->vif_num++];
+	ether_addr_copy(entry->bssid, env->vif->addr);
+	ether_addr_copy(entry->addr, env->vif->addr);
+	entry->rtwvif = (struct rtw_vif *)env->vif->drv_priv;
+
+	env->hdr_num = sta_num + 1;
+	env->hdrs = kunit_kcalloc(test, env->hdr_num, sizeof(*env->hdrs),
+				  GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, env->hdrs);
+
+	for (i = 0; i < env->hdr_num; i++) {
+		hdr = &env->hdrs[i];
+		hdr->frame_control = cpu_to_le16(IEEE80211_FTYPE_DATA |
+						 IEEE80211_STYPE_QOS_DATA |
+						 IEEE80211_FCTL_TODS);
+		ether_addr_copy(hdr->addr1, env->vif->addr);
+		rtw_rx_test_addr(hdr->addr2, i + 1);
+		eth_broadcast_addr(hdr->addr3);
+
+		if (i == sta_num)
+			break;
+
+		sta = kunit_kzalloc(test, sizeof(*sta) + sizeof(*si),
+				    GFP_KERNEL);
+		KUNIT_ASSERT_NOT_NULL(test, sta);
+		ether_addr_copy(sta->addr, hdr->addr2);
+
+		si = (struct rtw_sta_info *)sta->drv_priv;
+		si->sta = sta;
+		si->vif = env->vif;
+		rtw_rx_match_add_sta(tbl, si);
+	}
+
+	env->tbl = tbl;
+}
+
+/* the station a frame belongs to, the way rtw_rx_addr_match() finds it */
+static struct rtw_sta_info *
+rtw_rx_test_lookup(const struct rtw_rx_match_table *tbl,
+		   struct ieee80211_hdr *hdr)
+{
+	const struct rtw_rx_match_vif *entry;
+	u8 *bssid = get_hdr_bssid(hdr);
+	int i;
+
+	for (i = 0; i < tbl->vif_num; i++) {
+		entry = &tbl->vifs[i];
+		if (!ether_addr_equal(entry->bssid, bssid) ||
+		    !ether_addr_equal(entry->addr, hdr->addr1))
+			continue;
+
+		return rtw_rx_match_find_sta(tbl, hdr->addr2, entry->rtwvif);
+	}
+
+	return NULL;
+}
+
+/* the same without the hash, one compare per associated station */
+static struct rtw_sta_info *
+rtw_rx_test_lookup_linear(const struct rtw_rx_match_table *tbl,
+			  struct ieee80211_hdr *hdr)
+{
+	const struct rtw_rx_match_vif *entry;
+	const struct rtw_rx_match_sta *sta;
+	u8 *bssid = get_hdr_bssid(hdr);
+	int i, j;
+
+	for (i = 0; i < tbl->vif_num; i++) {
+		entry = &tbl->vifs[i];
+		if (!ether_addr_equal(entry->bssid, bssid) ||
+		    !ether_addr_equal(entry->addr, hdr->addr1))
+			continue;
+
+		for (j = 0; j < tbl->sta_num; j++) {
+			sta = &tbl->stas[j];
+			if (sta->rtwvif == entry->rtwvif &&
+			    ether_addr_equal(sta->addr, hdr->addr2))
+				return sta->si;
+		}
+	}
+
+	return NULL;
+}
+
+static u64 rtw_rx_test_time(const struct rtw_rx_test_env *env, bool linear)
+{
+	struct ieee80211_hdr *hdr;
+	struct rtw_sta_info *si;
+	ktime_t start;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < RTW_RX_TEST_FRAMES; i++) {
+		hdr = &env->hdrs[i % env->hdr_num];
+		if (linear)
+			si = rtw_rx_test_lookup_linear(env->tbl, hdr);
+		else
+			si = rtw_rx_test_lookup(env->tbl, hdr);
+		/* keep every lookup, nothing in the loop depends on it */
+		OPTIMIZER_HIDE_VAR(si);
+	}
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static void rtw_rx_test_match(struct kunit *test)
+{
+	struct rtw_rx_test_env env;
+	struct ieee80211_hdr other;
+	struct rtw_sta_info *si;
+	int i;
+
+	rtw_rx_test_env(test, &env, RTW_MAX_MAC_ID_NUM);
+	KUNIT_EXPECT_EQ(test, env.tbl->sta_num, RTW_MAX_MAC_ID_NUM);
+
+	for (i = 0; i < env.hdr_num; i++) {
+		si = rtw_rx_test_lookup(env.tbl, &env.hdrs[i]);
+		KUNIT_EXPECT_PTR_EQ(test, si,
+				    rtw_rx_test_lookup_linear(env.tbl,
+							      &env.hdrs[i]));
+		if (i == RTW_MAX_MAC_ID_NUM) {
+			KUNIT_EXPECT_NULL(test, si);
+			continue;
+		}
+
+		KUNIT_ASSERT_NOT_NULL(test, si);
+		KUNIT_EXPECT_TRUE(test, ether_addr_equal(si->sta->addr,
+							 env.hdrs[i].addr2));
+	}
+
+	/* a known station talking to somebody else's BSS */
+	other = env.hdrs[0];
+	rtw_rx_test_addr(other.addr1, 0xff);
+	KUNIT_EXPECT_NULL(test, rtw_rx_test_lookup(env.tbl, &other));
+}
+
+static void rtw_rx_test_match_bench(struct kunit *test)
+{
+	static const int sta_nums[] = {1, 4, 8, 16, RTW_MAX_MAC_ID_NUM};
+	struct rtw_rx_test_env env;
+	u64 hash_ns, linear_ns;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sta_nums); i++) {
+		rtw_rx_test_env(test, &env, sta_nums[i]);
+
+		hash_ns = rtw_rx_test_time(&env, false);
+		linear_ns = rtw_rx_test_time(&env, true);
+
+		kunit_info(test, "%d stations, %d frames: hash %llu ns, linear %llu ns\n",
+			   sta_nums[i], RTW_RX_TEST_FRAMES, hash_ns, linear_ns);
+	}
+}
+
+static struct kunit_case rtw_rx_test_cases[] = {
+	KUNIT_CASE(rtw_rx_test_match),
+	KUNIT_CASE(rtw_rx_test_match_bench),
+	{}
+};
+
+static struct kunit_suite rtw_rx_test_suite = {
+	.name = "rtw88_rx",
+	.test_cases = rtw_rx_test_cases,
+};
+
+kunit_test_suites(&rtw_rx_test_suite);
@@ -35,6 +35,7 @@ static int rtw_apply_sar(struct rtw_dev *rtwdev, const struct rtw_sar *new)
 	}
 
 	*sar = *new;
+	rtw_phy_tx_pwr_cache_flush(rtwdev);
 	rtw_phy_set_tx_power_level(rtwdev, hal->current_channel);
 
 	return 0;
@@ -2301,6 +2301,8 @@ static void rtw_sdio_rx_isr(struct rtw_dev *rtwdev)
 			hisr = REG_SDIO_HISR_RX_REQUEST;
 		}
 	} while (total_rx_bytes < SZ_64K && hisr & REG_SDIO_HISR_RX_REQUEST);
+
+	rtw_rx_phy_stat_flush(rtwdev);
 }
 
 static void rtw_sdio_c2h_cmd_isr(struct rtw_dev *rtwdev)
@@ -2341,9 +2343,7 @@ static void rtw_sdio_c2h_cmd_isr(struct rtw_dev *rtwdev)
 			 RTW_DBG_FW, "C2H_REG_DEBUG: id=0x%02x seq=%u plen=%u payload=%*ph\n",
 			 id, seq, plen, min_t(int, plen, 8), skb->data + 2);
 
-	*((u32 *)skb->cb) = 0;
-	skb_queue_tail(&rtwdev->c2h_queue, skb);
-	ieee80211_queue_work(rtwdev->hw, &rtwdev->c2h_work);
+	rtw_fw_c2h_cmd_rx_irqsafe(rtwdev, 0, skb);
 
 clear_evt:
 	rtw_write8(rtwdev, REG_C2HEVT_CLEAR, C2H_EVT_HOST_CLOSE);
@@ -2398,6 +2398,9 @@ static void rtw_sdio_handle_interrupt(struct sdio_func *sdio_func)
 		rtw_sdio_c2h_cmd_isr(rtwdev);
 	}
 
+	if (hisr & REG_SDIO_HISR_CPWM1)
+		rtw_power_mode_ack(rtwdev);
+
 	if (rtwdev->chip->id == RTW_CHIP_TYPE_8723B)
 		clear = hisr & rtwsdio->irq_mask & RTW_SDIO_HISR_CLEAR_MASK;
 	else
@@ -19,6 +19,38 @@ int rtw_sec_get_free_cam(struct rtw_sec_desc *sec)
 	return find_first_zero_bit(sec->cam_map, RTW_MAX_SEC_CAM_NUM);
 }
 
+/* Program the words of CAM entry @hw_key_idx that differ from the shadow.
+ * Word 0 carries the valid bit, so it goes last and the engine never sees a
+ * valid entry with half of the key written.
+ */
+static void rtw_sec_cam_program(struct rtw_dev *rtwdev,
+				struct rtw_sec_desc *sec, u8 hw_key_idx,
+				const u32 *words, u8 num)
+{
+	u32 *shadow = sec->cam_shadow[hw_key_idx];
+	u8 *known = &sec->cam_known[hw_key_idx];
+	u32 write_cmd;
+	u32 addr;
+	int i;
+
+	lockdep_assert_held(&rtwdev->mutex);
+
+	write_cmd = RTW_SEC_CMD_WRITE_ENABLE | RTW_SEC_CMD_POLLING;
+	addr = hw_key_idx << RTW_SEC_CAM_ENTRY_SHIFT;
+	for (i = num - 1; i >= 0; i--) {
+		if ((*known & BIT(i)) && shadow[i] == words[i]) {
+			sec->cam_stats.skipped++;
+			continue;
+		}
+
+		rtw_write32(rtwdev, RTW_SEC_WRITE_REG, words[i]);
+		rtw_write32(rtwdev, RTW_SEC_CMD_REG, write_cmd | (addr + i));
+		shadow[i] = words[i];
+		*known |= BIT(i);
+		sec->cam_stats.written++;
+	}
+}
+
 void rtw_sec_write_cam(struct rtw_dev *rtwdev,
 		       struct rtw_sec_desc *sec,
 		       struct ieee80211_sta *sta,
@@ -26,10 +58,7 @@ void rtw_sec_write_cam(struct rtw_dev *rtwdev,
 		       u8 hw_key_type, u8 hw_key_idx)
 {
 	struct rtw_cam_entry *cam = &sec->cam_table[hw_key_idx];
-	u32 write_cmd;
-	u32 command;
-	u32 content;
-	u32 addr;
+	u32 words[RTW_SEC_CAM_WORD_NUM];
 	int i, j;
 
 	set_bit(hw_key_idx, sec->cam_map);
@@ -42,41 +71,38 @@ void rtw_sec_write_cam(struct rtw_dev *rtwdev,
 	else
 		eth_broadcast_addr(cam->addr);
 
-	write_cmd = RTW_SEC_CMD_WRITE_ENABLE | RTW_SEC_CMD_POLLING;
-	addr = hw_key_idx << RTW_SEC_CAM_ENTRY_SHIFT;
-	for (i = 7; i >= 0; i--) {
+	for (i = 0; i < RTW_SEC_CAM_WORD_NUM; i++) {
 		switch (i) {
 		case 0:
-			content = ((key->keyidx & 0x3))		|
-				  ((hw_key_type & 0x7)	<< 2)	|
-				  (cam->group		<< 6)	|
-				  (cam->valid		<< 15)	|
-				  (cam->addr[0]		<< 16)	|
-				  (cam->addr[1]		<< 24);
+			words[i] = ((key->keyidx & 0x3))	|
+				   ((hw_key_type & 0x7)	<< 2)	|
+				   (cam->group		<< 6)	|
+				   (cam->valid		<< 15)	|
+				   (cam->addr[0]	<< 16)	|
+				   (cam->addr[1]	<< 24);
 			break;
 		case 1:
-			content = (cam->addr[2])		|
-				  (cam->addr[3]		<< 8)	|
-				  (cam->addr[4]		<< 16)	|
-				  (cam->addr[5]		<< 24);
+			words[i] = (cam->addr[2])		|
+				   (cam->addr[3]	<< 8)	|
+				   (cam->addr[4]	<< 16)	|
+				   (cam->addr[5]	<< 24);
 			break;
 		case 6:
 		case 7:
-			content = 0;
+			words[i] = 0;
 			break;
 		default:
 			j = (i - 2) << 2;
-			content = (key->key[j])			|
-				  (key->key[j + 1]	<< 8)	|
-				  (key->key[j + 2]	<< 16)	|
-				  (key->key[j + 3]	<< 24);
+			words[i] = (key->key[j])		|
+				   (key->key[j + 1]	<< 8)	|
+				   (key->key[j + 2]	<< 16)	|
+				   (key->key[j + 3]	<< 24);
 			break;
 		}
-
-		command = write_cmd | (addr + i);
-		rtw_write32(rtwdev, RTW_SEC_WRITE_REG, content);
-		rtw_write32(rtwdev, RTW_SEC_CMD_REG, command);
 	}
+
+	rtw_sec_cam_program(rtwdev, sec, hw_key_idx, words,
+			    RTW_SEC_CAM_WORD_NUM);
 }
 
 void rtw_sec_clear_cam(struct rtw_dev *rtwdev,
@@ -84,20 +110,52 @@ void rtw_sec_clear_cam(struct rtw_dev *rtwdev,
 		       u8 hw_key_idx)
 {
 	struct rtw_cam_entry *cam = &sec->cam_table[hw_key_idx];
-	u32 write_cmd;
-	u32 command;
-	u32 addr;
+	u32 word0 = 0;
 
 	clear_bit(hw_key_idx, sec->cam_map);
 	cam->valid = false;
 	cam->key = NULL;
 	eth_zero_addr(cam->addr);
 
-	write_cmd = RTW_SEC_CMD_WRITE_ENABLE | RTW_SEC_CMD_POLLING;
-	addr = hw_key_idx << RTW_SEC_CAM_ENTRY_SHIFT;
-	command = write_cmd | addr;
-	rtw_write32(rtwdev, RTW_SEC_WRITE_REG, 0);
-	rtw_write32(rtwdev, RTW_SEC_CMD_REG, command);
+	/* dropping the valid bit in word 0 is enough to retire the entry */
+	rtw_sec_cam_program(rtwdev, sec, hw_key_idx, &word0, 1);
+}
+
+/* Retire every installed entry from the driver's own bookkeeping, used when
+ * the keys are about to be installed again by mac80211 anyway.
+ */
+void rtw_sec_clear_cam_all(struct rtw_dev *rtwdev)
+{
+	struct rtw_sec_desc *sec = &rtwdev->sec;
+	u8 hw_key_idx;
+
+	for_each_set_bit(hw_key_idx, sec->cam_map, RTW_MAX_SEC_CAM_NUM)
+		rtw_sec_clear_cam(rtwdev, sec, hw_key_idx);
+}
+
+/* CAM content is lost with power, nothing in the shadow matches anymore */
+void rtw_sec_cam_invalidate(struct rtw_dev *rtwdev)
+{
+	struct rtw_sec_desc *sec = &rtwdev->sec;
+
+	memset(sec->cam_known, 0, sizeof(sec->cam_known));
+}
+EXPORT_SYMBOL(rtw_sec_cam_invalidate);
+
+/* Write the installed entries back from the shadow after a power on, in
+ * one run of register writes and without asking mac80211 for the keys.
+ */
+void rtw_sec_cam_restore(struct rtw_dev *rtwdev)
+{
+	struct rtw_sec_desc *sec = &rtwdev->sec;
+	u8 hw_key_idx;
+
+	for_each_set_bit(hw_key_idx, sec->cam_map, RTW_MAX_SEC_CAM_NUM) {
+		rtw_sec_cam_program(rtwdev, sec, hw_key_idx,
+				    sec->cam_shadow[hw_key_idx],
+				    RTW_SEC_CAM_WORD_NUM);
+		sec->cam_stats.restored++;
+	}
 }
 
 u8 rtw_sec_cam_pg_backup(struct rtw_dev *rtwdev, u8 *used_cam)
@@ -7,13 +7,17 @@
 #include "fw.h"
 #include "ps.h"
 #include "debug.h"
+#include "hrc.h"
 
 static
 void rtw_tx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
-		  struct sk_buff *skb)
+		  struct sk_buff *skb, u8 rate)
 {
+	struct rtw_pcpu_traffic_stats *pcpu;
 	struct ieee80211_hdr *hdr;
 	struct rtw_vif *rtwvif;
+	unsigned long flags;
+	u16 ac;
 
 	hdr = (struct ieee80211_hdr *)skb->data;
 
@@ -22,8 +26,20 @@ void rtw_tx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 
 	if (!is_broadcast_ether_addr(hdr->addr1) &&
 	    !is_multicast_ether_addr(hdr->addr1)) {
-		rtwdev->stats.tx_unicast += skb->len;
-		rtwdev->stats.tx_cnt++;
+		ac = skb_get_queue_mapping(skb);
+		if (ac >= IEEE80211_NUM_ACS)
+			ac = IEEE80211_AC_BE;
+
+		pcpu = rtw_traffic_stats_begin(rtwdev, &flags);
+		pcpu->cnt.tx_unicast += skb->len;
+		pcpu->cnt.tx_cnt++;
+		pcpu->cnt.tx_ac_bytes[ac] += skb->len;
+		pcpu->cnt.tx_ac_pkts[ac]++;
+		pcpu->cnt.tx_rate_pkts[rtw_desc_rate_class(rate)]++;
+		rtw_traffic_stats_end(pcpu, flags);
+
+		rtw_lps_policy_activity(rtwdev, ac);
+
 		if (vif) {
 			rtwvif = (struct rtw_vif *)vif->drv_priv;
 			rtwvif->stats.tx_unicast += skb->len;
@@ -32,6 +48,16 @@ void rtw_tx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 	}
 }
 
+void rtw_tx_stats_drop(struct rtw_dev *rtwdev)
+{
+	struct rtw_pcpu_traffic_stats *pcpu;
+	unsigned long flags;
+
+	pcpu = rtw_traffic_stats_begin(rtwdev, &flags);
+	pcpu->cnt.tx_drop++;
+	rtw_traffic_stats_end(pcpu, flags);
+}
+
 void rtw_tx_fill_tx_desc(struct rtw_dev *rtwdev,
 			 struct rtw_tx_pkt_info *pkt_info,
 			 struct rtw_tx_desc *tx_desc)
@@ -196,15 +222,98 @@ static void rtw_tx_report_enable(struct rtw_dev *rtwdev,
 				 struct rtw_tx_pkt_info *pkt_info)
 {
 	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+	u8 sn;
 
 	/* [11:8], reserved, fills with zero
 	 * [7:2],  tx report sequence number
 	 * [1:0],  firmware use, fills with zero
 	 */
-	pkt_info->sn = (atomic_inc_return(&tx_report->sn) << 2) & 0xfc;
+	sn = (atomic_inc_return(&tx_report->sn) << 2) & 0xfc;
+	/* [7] is left to the reports only host rate control asks for */
+	if (rtw_hrc_active(rtwdev))
+		sn &= ~RTW_TX_REPORT_SN_HRC;
+
+	pkt_info->sn = sn;
 	pkt_info->report = true;
 }
 
+/* The report only feeds hrc.c, no skb waits for it. Its own sequence
+ * numbers never match a slot a TX status is pending on.
+ */
+static void rtw_tx_report_enable_hrc(struct rtw_dev *rtwdev,
+				     struct rtw_tx_pkt_info *pkt_info)
+{
+	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+
+	pkt_info->sn = ((atomic_inc_return(&tx_report->hrc_sn) << 2) & 0xfc) |
+		       RTW_TX_REPORT_SN_HRC;
+	pkt_info->report = true;
+}
+
+static void rtw_tx_report_tx_status(struct rtw_dev *rtwdev,
+				    struct sk_buff *skb, bool acked)
+{
+	struct ieee80211_tx_info *info;
+
+	info = IEEE80211_SKB_CB(skb);
+	ieee80211_tx_info_clear_status(info);
+	if (acked)
+		info->flags |= IEEE80211_TX_STAT_ACK;
+	else
+		info->flags &= ~IEEE80211_TX_STAT_ACK;
+
+	ieee80211_tx_status_irqsafe(rtwdev->hw, skb);
+}
+
+/* caller must hold tx_report->q_lock */
+static struct sk_buff *rtw_tx_report_take(struct rtw_tx_report *tx_report,
+					  u8 slot)
+{
+	struct sk_buff *skb = tx_report->slots[slot].skb;
+
+	tx_report->slots[slot].skb = NULL;
+	clear_bit(slot, tx_report->pending);
+
+	return skb;
+}
+
+/* caller must hold tx_report->q_lock */
+static void rtw_tx_report_done(struct rtw_dev *rtwdev, u8 slot, bool acked)
+{
+	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+	struct rtw_tx_report_stats *stats = &tx_report->stats;
+	struct sk_buff *skb;
+	u32 latency;
+
+	latency = ktime_us_delta(ktime_get(), tx_report->slots[slot].enqueued);
+	stats->matched++;
+	stats->latency_sum_us += latency;
+	stats->latency_last_us = latency;
+	if (latency > stats->latency_max_us)
+		stats->latency_max_us = latency;
+
+	skb = rtw_tx_report_take(tx_report, slot);
+	rtw_tx_report_tx_status(rtwdev, skb, acked);
+}
+
+/* 8051 firmware does not echo the sequence number back reliably, so
+ * reports are consumed in the order the frames were queued.
+ */
+static int rtw_tx_report_oldest(struct rtw_tx_report *tx_report)
+{
+	int oldest = -ENOENT;
+	unsigned int slot;
+
+	for_each_set_bit(slot, tx_report->pending, RTW_TX_REPORT_SLOT_NUM) {
+		if (oldest < 0 ||
+		    ktime_before(tx_report->slots[slot].enqueued,
+				 tx_report->slots[oldest].enqueued))
+			oldest = slot;
+	}
+
+	return oldest;
+}
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 void rtw_tx_report_purge_timer(struct timer_list *t)
 #else
@@ -220,59 +329,101 @@ void rtw_tx_report_purge_timer(void *cntx)
 	struct rtw_dev *rtwdev = (struct rtw_dev *)cntx;
 #endif
 	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+	struct rtw_tx_report_slot *entry;
+	struct sk_buff_head expired;
+	struct sk_buff *skb;
+	unsigned long next = 0;
 	unsigned long flags;
+	unsigned int slot;
+	bool rearm = false;
 
-	if (skb_queue_len(&tx_report->queue) == 0)
-		return;
-
-	rtw_warn(rtwdev, "failed to get tx report from firmware\n");
+	__skb_queue_head_init(&expired);
 
+	/* only drop the entries that are really overdue, and re-arm the
+	 * timer for the oldest one that is still waiting
+	 */
 	spin_lock_irqsave(&tx_report->q_lock, flags);
-	skb_queue_purge(&tx_report->queue);
+	for_each_set_bit(slot, tx_report->pending, RTW_TX_REPORT_SLOT_NUM) {
+		entry = &tx_report->slots[slot];
+		if (time_after_eq(jiffies, entry->expires)) {
+			__skb_queue_tail(&expired,
+					 rtw_tx_report_take(tx_report, slot));
+			continue;
+		}
+
+		if (!rearm || time_before(entry->expires, next))
+			next = entry->expires;
+		rearm = true;
+	}
+	tx_report->stats.expired += skb_queue_len(&expired);
+	if (rearm)
+		mod_timer(&tx_report->purge_timer, next);
 	spin_unlock_irqrestore(&tx_report->q_lock, flags);
+
+	if (skb_queue_empty(&expired))
+		return;
+
+	rtw_warn(rtwdev, "failed to get tx report from firmware for %u frames\n",
+		 skb_queue_len(&expired));
+
+	while ((skb = __skb_dequeue(&expired)))
+		ieee80211_free_txskb(rtwdev->hw, skb);
 }
 
 void rtw_tx_report_enqueue(struct rtw_dev *rtwdev, struct sk_buff *skb, u8 sn)
 {
 	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+	struct rtw_tx_report_slot *entry;
+	struct sk_buff *stale = NULL;
 	unsigned long flags;
-	u8 *drv_data;
+	u8 slot = RTW_TX_REPORT_SN_TO_SLOT(sn);
 
-	/* pass sn to tx report handler through driver data */
-	drv_data = (u8 *)IEEE80211_SKB_CB(skb)->status.status_driver_data;
-	*drv_data = sn;
+	entry = &tx_report->slots[slot];
 
 	spin_lock_irqsave(&tx_report->q_lock, flags);
-	__skb_queue_tail(&tx_report->queue, skb);
+	/* the sequence number wrapped before firmware reported this slot */
+	if (test_bit(slot, tx_report->pending)) {
+		stale = rtw_tx_report_take(tx_report, slot);
+		tx_report->stats.overwritten++;
+	}
+
+	entry->skb = skb;
+	entry->sn = sn;
+	entry->enqueued = ktime_get();
+	entry->expires = jiffies + RTW_TX_PROBE_TIMEOUT;
+	set_bit(slot, tx_report->pending);
+
+	/* entries expire in enqueue order, so a pending timer already
+	 * covers an older entry and is re-armed lazily on expiry
+	 */
+	if (!timer_pending(&tx_report->purge_timer))
+		mod_timer(&tx_report->purge_timer, entry->expires);
 	spin_unlock_irqrestore(&tx_report->q_lock, flags);
 
-	mod_timer(&tx_report->purge_timer, jiffies + RTW_TX_PROBE_TIMEOUT);
+	if (stale)
+		ieee80211_free_txskb(rtwdev->hw, stale);
 }
 EXPORT_SYMBOL(rtw_tx_report_enqueue);
 
-static void rtw_tx_report_tx_status(struct rtw_dev *rtwdev,
-				    struct sk_buff *skb, bool acked)
+void rtw_tx_report_purge(struct rtw_dev *rtwdev)
 {
-	struct ieee80211_tx_info *info;
-
-	info = IEEE80211_SKB_CB(skb);
-	ieee80211_tx_info_clear_status(info);
-	if (acked)
-		info->flags |= IEEE80211_TX_STAT_ACK;
-	else
-		info->flags &= ~IEEE80211_TX_STAT_ACK;
+	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+	unsigned long flags;
+	unsigned int slot;
 
-	ieee80211_tx_status_irqsafe(rtwdev->hw, skb);
+	spin_lock_irqsave(&tx_report->q_lock, flags);
+	for_each_set_bit(slot, tx_report->pending, RTW_TX_REPORT_SLOT_NUM)
+		dev_kfree_skb_any(rtw_tx_report_take(tx_report, slot));
+	spin_unlock_irqrestore(&tx_report->q_lock, flags);
 }
 
 void rtw_tx_report_handle(struct rtw_dev *rtwdev, struct sk_buff *skb, int src)
 {
 	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
 	struct rtw_c2h_cmd *c2h;
-	struct sk_buff *cur, *tmp;
 	unsigned long flags;
+	int slot;
 	u8 sn, st;
-	u8 *n;
 
 	c2h = get_c2h_from_skb(skb);
 
@@ -285,14 +436,19 @@ void rtw_tx_report_handle(struct rtw_dev *rtwdev, struct sk_buff *skb, int src)
 	}
 
 	spin_lock_irqsave(&tx_report->q_lock, flags);
-	skb_queue_walk_safe(&tx_report->queue, cur, tmp) {
-		n = (u8 *)IEEE80211_SKB_CB(cur)->status.status_driver_data;
-		if (*n == sn || rtw_chip_wcpu_8051(rtwdev)) {
-			__skb_unlink(cur, &tx_report->queue);
-			rtw_tx_report_tx_status(rtwdev, cur, st == 0);
-			break;
-		}
+	if (rtw_chip_wcpu_8051(rtwdev)) {
+		slot = rtw_tx_report_oldest(tx_report);
+	} else {
+		slot = RTW_TX_REPORT_SN_TO_SLOT(sn);
+		if (!test_bit(slot, tx_report->pending) ||
+		    tx_report->slots[slot].sn != sn)
+			slot = -ENOENT;
 	}
+
+	if (slot >= 0)
+		rtw_tx_report_done(rtwdev, slot, st == 0);
+	else
+		tx_report->stats.unmatched++;
 	spin_unlock_irqrestore(&tx_report->q_lock, flags);
 }
 
@@ -300,12 +456,12 @@ void rtw_tx_report_handle_8723b(struct rtw_dev *rtwdev, u8 report_type,
 				u8 *payload, u8 len)
 {
 	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
-	struct sk_buff *cur, *tmp;
 	unsigned long flags;
 	int dump_len = min_t(int, len, 8);
 	bool failed = len > 0 && (payload[0] & (BIT(6) | BIT(7)));
 	u8 sn = len >= 7 ? payload[6] : 0xff;
-	u8 *n;
+	bool hrc_fed;
+	u8 slot;
 
 	/* 8723B SDIO v41 firmware reports management TX through C2H ID 0x03
 	 * (C2H_CCX_TX_RPT), matching staging.  Payload byte 0 is the vendor
@@ -323,15 +479,20 @@ void rtw_tx_report_handle_8723b(struct rtw_dev *rtwdev, u8 report_type,
 	if (len < 7)
 		return;
 
+	/* frames sent under host rate control ask for reports of their own */
+	hrc_fed = rtw_hrc_tx_report(rtwdev, GET_CCX_REPORT_MACID_V0(payload),
+				    GET_CCX_REPORT_RATE_V0(payload),
+				    GET_CCX_REPORT_RETRY_V0(payload), !failed);
+
+	slot = RTW_TX_REPORT_SN_TO_SLOT(sn);
+
 	spin_lock_irqsave(&tx_report->q_lock, flags);
-	skb_queue_walk_safe(&tx_report->queue, cur, tmp) {
-		n = (u8 *)IEEE80211_SKB_CB(cur)->status.status_driver_data;
-		if (*n == sn) {
-			__skb_unlink(cur, &tx_report->queue);
-			rtw_tx_report_tx_status(rtwdev, cur, !failed);
-			break;
-		}
-	}
+	if (!(sn & RTW_TX_REPORT_SN_HRC) &&
+	    test_bit(slot, tx_report->pending) &&
+	    tx_report->slots[slot].sn == sn)
+		rtw_tx_report_done(rtwdev, slot, !failed);
+	else if (!hrc_fed)
+		tx_report->stats.unmatched++;
 	spin_unlock_irqrestore(&tx_report->q_lock, flags);
 }
 
@@ -412,6 +573,38 @@ static bool rtw_tx_8723bs_bss_has_cck(struct rtw_dev *rtwdev,
 	return has_cck;
 }
 
+void rtw_tx_8723bs_bss_cck_refresh(struct rtw_dev *rtwdev,
+				   struct ieee80211_vif *vif)
+{
+	struct rtw_vif *rtwvif = (struct rtw_vif *)vif->drv_priv;
+	struct rtw_bss_cck *bss_cck = &rtwvif->bss_cck;
+	const u8 *bssid = vif->bss_conf.bssid;
+	bool known;
+	bool has_cck;
+	u8 state;
+
+	WRITE_ONCE(bss_cck->state, RTW_BSS_CCK_INVALID);
+	bss_cck->refresh_cnt++;
+
+	if (!bssid || !is_valid_ether_addr(bssid))
+		return;
+
+	has_cck = rtw_tx_8723bs_bss_has_cck(rtwdev, vif, bssid, &known);
+	if (!known)
+		state = RTW_BSS_CCK_UNKNOWN;
+	else if (has_cck)
+		state = RTW_BSS_CCK_SUPPORTED;
+	else
+		state = RTW_BSS_CCK_UNSUPPORTED;
+
+	ether_addr_copy(bss_cck->bssid, bssid);
+	smp_wmb();
+	WRITE_ONCE(bss_cck->state, state);
+
+	rtw_dbg(rtwdev, RTW_DBG_TX, "bss %pM cck state %u, refresh %u\n",
+		bssid, state, bss_cck->refresh_cnt);
+}
+
 static void rtw_tx_8723bs_sdio_rate(struct rtw_dev *rtwdev,
 				    struct rtw_tx_pkt_info *pkt_info,
 				    struct sk_buff *skb)
@@ -419,15 +612,35 @@ static void rtw_tx_8723bs_sdio_rate(struct rtw_dev *rtwdev,
 	struct ieee80211_tx_info *tx_info = IEEE80211_SKB_CB(skb);
 	struct ieee80211_vif *vif = tx_info->control.vif;
 	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+	struct rtw_bss_cck *bss_cck;
 	const u8 *bssid = NULL;
 	bool known = false;
 	bool has_cck = true;
+	u8 state = RTW_BSS_CCK_INVALID;
 
 	if (ieee80211_is_data(hdr->frame_control) ||
 	    ieee80211_is_mgmt(hdr->frame_control))
 		bssid = hdr->addr1;
 
-	has_cck = rtw_tx_8723bs_bss_has_cck(rtwdev, vif, bssid, &known);
+	/* frames to the associated BSS use the cached result, only frames
+	 * to other BSSes, e.g. auth/assoc before association, do a lookup
+	 */
+	if (vif && bssid) {
+		bss_cck = &((struct rtw_vif *)vif->drv_priv)->bss_cck;
+		state = READ_ONCE(bss_cck->state);
+		smp_rmb();
+		if (state != RTW_BSS_CCK_INVALID &&
+		    !ether_addr_equal(bss_cck->bssid, bssid))
+			state = RTW_BSS_CCK_INVALID;
+	}
+
+	if (state == RTW_BSS_CCK_INVALID) {
+		has_cck = rtw_tx_8723bs_bss_has_cck(rtwdev, vif, bssid, &known);
+	} else {
+		known = state != RTW_BSS_CCK_UNKNOWN;
+		has_cck = state == RTW_BSS_CCK_SUPPORTED;
+	}
+
 	if (!known && vif && vif->bss_conf.basic_rates)
 		has_cck = vif->bss_conf.basic_rates & 0xf;
 	else if (!known)
@@ -553,6 +766,85 @@ static void rtw_tx_mgmt_pkt_info_update(struct rtw_dev *rtwdev,
 	/* TODO: need to change hw port and hw ssn sel for multiple vifs */
 }
 
+static void rtw_tx_tmpl_build(struct rtw_dev *rtwdev,
+			      struct ieee80211_sta *sta,
+			      struct rtw_tx_tmpl *tmpl)
+{
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
+	if (sta->deflink.vht_cap.vht_supported)
+		tmpl->rate = get_highest_vht_tx_rate(rtwdev, sta);
+	else if (sta->deflink.ht_cap.ht_supported)
+		tmpl->rate = get_highest_ht_tx_rate(rtwdev, sta);
+	else if (sta->deflink.supp_rates[0] <= 0xf)
+		tmpl->rate = DESC_RATE11M;
+	else
+		tmpl->rate = DESC_RATE54M;
+#else
+	if (sta->vht_cap.vht_supported)
+		tmpl->rate = get_highest_vht_tx_rate(rtwdev, sta);
+	else if (sta->ht_cap.ht_supported)
+		tmpl->rate = get_highest_ht_tx_rate(rtwdev, sta);
+	else if (sta->supp_rates[0] <= 0xf)
+		tmpl->rate = DESC_RATE11M;
+	else
+		tmpl->rate = DESC_RATE54M;
+#endif
+
+	tmpl->rate_id = si->rate_id;
+	tmpl->bw = si->bw_mode;
+	tmpl->ampdu_factor = get_tx_ampdu_factor(sta);
+	tmpl->ampdu_density = get_tx_ampdu_density(sta);
+	tmpl->stbc = si->stbc_en;
+	tmpl->ldpc = si->ldpc_en;
+}
+
+void rtw_tx_tmpl_update(struct rtw_dev *rtwdev, struct rtw_sta_info *si)
+{
+	struct rtw_tx_tmpl *tmpl, *old;
+
+	lockdep_assert_held(&rtwdev->mutex);
+
+	/* without a template the TX path builds the fields per frame */
+	tmpl = kzalloc(sizeof(*tmpl), GFP_KERNEL);
+	if (tmpl)
+		rtw_tx_tmpl_build(rtwdev, si->sta, tmpl);
+
+	old = rcu_dereference_protected(si->tx_tmpl,
+					lockdep_is_held(&rtwdev->mutex));
+	rcu_assign_pointer(si->tx_tmpl, tmpl);
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
+void rtw_tx_tmpl_free(struct rtw_dev *rtwdev, struct rtw_sta_info *si)
+{
+	struct rtw_tx_tmpl *old;
+
+	old = rcu_dereference_protected(si->tx_tmpl,
+					lockdep_is_held(&rtwdev->mutex));
+	RCU_INIT_POINTER(si->tx_tmpl, NULL);
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
+static void rtw_tx_tmpl_get(struct rtw_dev *rtwdev, struct ieee80211_sta *sta,
+			    struct rtw_tx_tmpl *tmpl)
+{
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+	struct rtw_tx_tmpl *cur;
+
+	rcu_read_lock();
+	cur = rcu_dereference(si->tx_tmpl);
+	if (likely(cur))
+		*tmpl = *cur;
+	rcu_read_unlock();
+
+	if (unlikely(!cur))
+		rtw_tx_tmpl_build(rtwdev, sta, tmpl);
+}
+
 static void rtw_tx_data_pkt_info_update(struct rtw_dev *rtwdev,
 					struct rtw_tx_pkt_info *pkt_info,
 					struct ieee80211_sta *sta,
@@ -562,6 +854,7 @@ static void rtw_tx_data_pkt_info_update(struct rtw_dev *rtwdev,
 	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
 	struct ieee80211_hw *hw = rtwdev->hw;
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_tx_tmpl tmpl;
 	struct rtw_sta_info *si;
 	u8 fix_rate;
 	u16 seq;
@@ -573,6 +866,8 @@ static void rtw_tx_data_pkt_info_update(struct rtw_dev *rtwdev,
 	u8 bw = RTW_CHANNEL_WIDTH_20;
 	bool stbc = false;
 	bool ldpc = false;
+	bool hrc_report;
+	u8 hrc_rate;
 
 	seq = (le16_to_cpu(hdr->seq_ctrl) & IEEE80211_SCTL_SEQ) >> 4;
 
@@ -580,41 +875,24 @@ static void rtw_tx_data_pkt_info_update(struct rtw_dev *rtwdev,
 	if (!sta)
 		goto out;
 
+	si = (struct rtw_sta_info *)sta->drv_priv;
+	rtw_tx_tmpl_get(rtwdev, sta, &tmpl);
+
+	/* aggregation is decided by mac80211 per frame and TID */
 	if (info->flags & IEEE80211_TX_CTL_AMPDU) {
 		ampdu_en = true;
-		ampdu_factor = get_tx_ampdu_factor(sta);
-		ampdu_density = get_tx_ampdu_density(sta);
+		ampdu_factor = tmpl.ampdu_factor;
+		ampdu_density = tmpl.ampdu_density;
 	}
 
 	if (info->control.use_rts || skb->len > hw->wiphy->rts_threshold)
 		pkt_info->rts = true;
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
-	if (sta->deflink.vht_cap.vht_supported)
-		rate = get_highest_vht_tx_rate(rtwdev, sta);
-	else if (sta->deflink.ht_cap.ht_supported)
-		rate = get_highest_ht_tx_rate(rtwdev, sta);
-	else if (sta->deflink.supp_rates[0] <= 0xf)
-		rate = DESC_RATE11M;
-	else
-		rate = DESC_RATE54M;
-#else
-	if (sta->vht_cap.vht_supported)
-		rate = get_highest_vht_tx_rate(rtwdev, sta);
-	else if (sta->ht_cap.ht_supported)
-		rate = get_highest_ht_tx_rate(rtwdev, sta);
-	else if (sta->supp_rates[0] <= 0xf)
-		rate = DESC_RATE11M;
-	else
-		rate = DESC_RATE54M;
-#endif
-
-	si = (struct rtw_sta_info *)sta->drv_priv;
-
-	bw = si->bw_mode;
-	rate_id = si->rate_id;
-	stbc = rtwdev->hal.txrx_1ss ? false : si->stbc_en;
-	ldpc = si->ldpc_en;
+	rate = tmpl.rate;
+	bw = tmpl.bw;
+	rate_id = tmpl.rate_id;
+	stbc = rtwdev->hal.txrx_1ss ? false : tmpl.stbc;
+	ldpc = tmpl.ldpc;
 
 out:
 	pkt_info->seq = seq;
@@ -649,6 +927,20 @@ out:
 		 */
 	}
 
+	/* host rate control probes one rate per frame, so no fallback.
+	 * EAPOL keeps the robust rate picked below.
+	 */
+	if (sta && skb->protocol != cpu_to_be16(ETH_P_PAE) &&
+	    rtw_hrc_tx_rate(rtwdev, si, &hrc_rate, &hrc_report)) {
+		pkt_info->rate = hrc_rate;
+		pkt_info->use_rate = true;
+		pkt_info->dis_rate_fallback = true;
+		/* a frame mac80211 waits on reports through its own slot */
+		if (hrc_report &&
+		    !(info->flags & IEEE80211_TX_CTL_REQ_TX_STATUS))
+			rtw_tx_report_enable_hrc(rtwdev, pkt_info);
+	}
+
 	if (skb->protocol == cpu_to_be16(ETH_P_PAE)) {
 		rtw_tx_pkt_info_update_rate(rtwdev, pkt_info, skb, true);
 
@@ -732,7 +1024,7 @@ void rtw_tx_pkt_info_update(struct rtw_dev *rtwdev,
 		pkt_info->ls = false;
 
 	/* maybe merge with tx status ? */
-	rtw_tx_stats(rtwdev, vif, skb);
+	rtw_tx_stats(rtwdev, vif, skb, pkt_info->rate);
 }
 
 void rtw_tx_rsvd_page_pkt_info_update(struct rtw_dev *rtwdev,
@@ -838,26 +1130,100 @@ rtw_tx_write_data_h2c_get(struct rtw_dev *rtwdev,
 }
 EXPORT_SYMBOL(rtw_tx_write_data_h2c_get);
 
-void rtw_tx(struct rtw_dev *rtwdev,
-	    struct ieee80211_tx_control *control,
-	    struct sk_buff *skb)
+static void rtw_tx_write_skb(struct rtw_dev *rtwdev, struct ieee80211_sta *sta,
+			     struct sk_buff *skb)
 {
 	struct rtw_tx_pkt_info pkt_info = {0};
 	int ret;
 
-	rtw_tx_pkt_info_update(rtwdev, &pkt_info, control->sta, skb);
+	rtw_tx_pkt_info_update(rtwdev, &pkt_info, sta, skb);
 	ret = rtw_hci_tx_write(rtwdev, &pkt_info, skb);
 	if (ret) {
 		rtw_err(rtwdev, "failed to write TX skb to HCI\n");
-		goto out;
+		rtw_tx_stats_drop(rtwdev);
+		ieee80211_free_txskb(rtwdev->hw, skb);
 	}
+}
 
+void rtw_tx(struct rtw_dev *rtwdev,
+	    struct ieee80211_tx_control *control,
+	    struct sk_buff *skb)
+{
+	/* held like the txq frames until firmware acks leaving LPS */
+	if (test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags)) {
+		skb_queue_tail(&rtwdev->lps_tx_queue, skb);
+		/* the ack may have raced with the queueing */
+		if (!test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+			queue_work(rtwdev->tx_wq, &rtwdev->tx_work);
+		return;
+	}
+
+	rtw_tx_write_skb(rtwdev, control->sta, skb);
 	rtw_hci_tx_kick_off(rtwdev);
+}
 
-	return;
+/* send the frames rtw_tx() held while leaving LPS, the station is looked
+ * up again since it was only valid for the duration of the call
+ */
+static void rtw_tx_lps_held(struct rtw_dev *rtwdev)
+{
+	struct ieee80211_sta *sta;
+	struct ieee80211_hdr *hdr;
+	struct sk_buff *skb;
 
-out:
-	ieee80211_free_txskb(rtwdev->hw, skb);
+	rcu_read_lock();
+
+	while ((skb = skb_dequeue(&rtwdev->lps_tx_queue))) {
+		hdr = (struct ieee80211_hdr *)skb->data;
+		sta = ieee80211_find_sta_by_ifaddr(rtwdev->hw, hdr->addr1,
+						   hdr->addr2);
+		rtw_tx_write_skb(rtwdev, sta, skb);
+	}
+
+	rcu_read_unlock();
+}
+
+void rtw_agg_event(struct ieee80211_sta *sta, u8 tid, enum rtw_agg_event ev)
+{
+	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+	struct rtw_agg_tid_stats *stats;
+
+	if (tid >= IEEE80211_NUM_TIDS)
+		return;
+
+	stats = &si->agg[tid];
+	stats->ev[ev]++;
+
+	switch (ev) {
+	case RTW_AGG_EV_REQUEST:
+		if (stats->state == RTW_AGG_IDLE)
+			stats->state = RTW_AGG_REQUESTED;
+		break;
+	case RTW_AGG_EV_REFUSED:
+		if (stats->state == RTW_AGG_REQUESTED)
+			stats->state = RTW_AGG_IDLE;
+		break;
+	case RTW_AGG_EV_BLOCKED:
+		stats->state = RTW_AGG_BLOCKED;
+		break;
+	case RTW_AGG_EV_TX_START:
+		stats->state = RTW_AGG_STARTING;
+		break;
+	case RTW_AGG_EV_TX_OPERATIONAL:
+		stats->state = RTW_AGG_OPERATIONAL;
+		break;
+	case RTW_AGG_EV_TX_STOP:
+		stats->state = RTW_AGG_IDLE;
+		break;
+	case RTW_AGG_EV_RX_START:
+		stats->rx_active = true;
+		break;
+	case RTW_AGG_EV_RX_STOP:
+		stats->rx_active = false;
+		break;
+	default:
+		break;
+	}
 }
 
 static void rtw_txq_check_agg(struct rtw_dev *rtwdev,
@@ -892,23 +1258,62 @@ static void rtw_txq_check_agg(struct rtw_dev *rtwdev,
 	ieee80211_queue_work(rtwdev->hw, &rtwdev->ba_work);
 }
 
-static int rtw_txq_push_skb(struct rtw_dev *rtwdev,
-			    struct rtw_txq *rtwtxq,
-			    struct sk_buff *skb)
+static void rtw_txq_count_agg(struct ieee80211_txq *txq, struct sk_buff *skb)
+{
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct rtw_sta_info *si;
+
+	if (!txq->sta || txq->tid >= IEEE80211_NUM_TIDS)
+		return;
+
+	si = (struct rtw_sta_info *)txq->sta->drv_priv;
+	if (info->flags & IEEE80211_TX_CTL_AMPDU)
+		si->agg[txq->tid].ampdu_frames++;
+	else
+		si->agg[txq->tid].single_frames++;
+}
+
+static void rtw_txq_flush_batch(struct rtw_dev *rtwdev,
+				enum rtw_tx_queue_type queue)
+{
+	struct rtw_tx_batch *batch = &rtwdev->tx_batch[queue];
+	int done;
+	int i;
+
+	if (!batch->num)
+		return;
+
+	done = rtw_hci_tx_write_batch(rtwdev, queue, batch);
+	if (done < batch->num) {
+		rtw_err(rtwdev, "failed to write %d TX skbs to HCI, ret %d\n",
+			batch->num - max(done, 0), done);
+		for (i = max(done, 0); i < batch->num; i++) {
+			rtw_tx_stats_drop(rtwdev);
+			ieee80211_free_txskb(rtwdev->hw, batch->skbs[i]);
+		}
+	}
+
+	batch->num = 0;
+}
+
+static void rtw_txq_push_skb(struct rtw_dev *rtwdev,
+			     struct rtw_txq *rtwtxq,
+			     struct sk_buff *skb)
 {
 	struct ieee80211_txq *txq = rtwtxq_to_txq(rtwtxq);
-	struct rtw_tx_pkt_info pkt_info = {0};
-	int ret;
+	enum rtw_tx_queue_type queue = rtw_tx_queue_mapping(skb);
+	struct rtw_tx_batch *batch = &rtwdev->tx_batch[queue];
+	struct rtw_tx_pkt_info *pkt_info = &batch->pkt_info[batch->num];
 
 	rtw_txq_check_agg(rtwdev, rtwtxq, skb);
+	rtw_txq_count_agg(txq, skb);
 
-	rtw_tx_pkt_info_update(rtwdev, &pkt_info, txq->sta, skb);
-	ret = rtw_hci_tx_write(rtwdev, &pkt_info, skb);
-	if (ret) {
-		rtw_err(rtwdev, "failed to write TX skb to HCI\n");
-		return ret;
-	}
-	return 0;
+	memset(pkt_info, 0, sizeof(*pkt_info));
+	rtw_tx_pkt_info_update(rtwdev, pkt_info, txq->sta, skb);
+	batch->skbs[batch->num++] = skb;
+
+	if (batch->num == RTW_TX_BATCH_MAX)
+		rtw_txq_flush_batch(rtwdev, queue);
 }
 
 static struct sk_buff *rtw_txq_dequeue(struct rtw_dev *rtwdev,
@@ -929,7 +1334,6 @@ static void rtw_txq_push(struct rtw_dev *rtwdev,
 			 unsigned long frames)
 {
 	struct sk_buff *skb;
-	int ret;
 	int i;
 
 	rcu_read_lock();
@@ -939,11 +1343,7 @@ static void rtw_txq_push(struct rtw_dev *rtwdev,
 		if (!skb)
 			break;
 
-		ret = rtw_txq_push_skb(rtwdev, rtwtxq, skb);
-		if (ret) {
-			rtw_err(rtwdev, "failed to pusk skb, ret %d\n", ret);
-			break;
-		}
+		rtw_txq_push_skb(rtwdev, rtwtxq, skb);
 	}
 
 	rcu_read_unlock();
@@ -952,9 +1352,19 @@ static void rtw_txq_push(struct rtw_dev *rtwdev,
 void __rtw_tx_work(struct rtw_dev *rtwdev)
 {
 	struct rtw_txq *rtwtxq, *tmp;
+	int queue;
+
+	/* frames stay queued until firmware acks leaving LPS */
+	if (test_bit(RTW_FLAG_LEISURE_PS_LEAVING, rtwdev->flags))
+		return;
 
 	spin_lock_bh(&rtwdev->txq_lock);
 
+	rtw_tx_lps_held(rtwdev);
+
+	/* frames are collected per hardware queue across all txqs, so the
+	 * HCI sees whole bursts instead of one skb at a time
+	 */
 	list_for_each_entry_safe(rtwtxq, tmp, &rtwdev->txqs, list) {
 		struct ieee80211_txq *txq = rtwtxq_to_txq(rtwtxq);
 		unsigned long frame_cnt;
@@ -965,6 +1375,10 @@ void __rtw_tx_work(struct rtw_dev *rtwdev)
 		list_del_init(&rtwtxq->list);
 	}
 
+	/* higher queue types first, VO ahead of BK */
+	for (queue = RTK_MAX_TX_QUEUE_NUM - 1; queue >= 0; queue--)
+		rtw_txq_flush_batch(rtwdev, queue);
+
 	rtw_hci_tx_kick_off(rtwdev);
 
 	spin_unlock_bh(&rtwdev->txq_lock);
@@ -1042,3 +1456,7 @@ enum rtw_tx_queue_type rtw_tx_queue_mapping(struct sk_buff *skb)
 	return queue;
 }
 EXPORT_SYMBOL(rtw_tx_queue_mapping);
+
+#ifdef CONFIG_RTW88_KUNIT_TEST
+#include "tx_test.c"
+#endif
@@ -95,13 +95,17 @@ enum rtw_tx_desc_queue_select {
 
 enum rtw_rsvd_packet_type;
 
+void rtw_tx_stats_drop(struct rtw_dev *rtwdev);
 void rtw_tx(struct rtw_dev *rtwdev,
 	    struct ieee80211_tx_control *control,
 	    struct sk_buff *skb);
 void rtw_txq_init(struct rtw_dev *rtwdev, struct ieee80211_txq *txq);
 void rtw_txq_cleanup(struct rtw_dev *rtwdev, struct ieee80211_txq *txq);
+void rtw_agg_event(struct ieee80211_sta *sta, u8 tid, enum rtw_agg_event ev);
 void rtw_tx_work(struct work_struct *w);
 void __rtw_tx_work(struct rtw_dev *rtwdev);
+void rtw_tx_tmpl_update(struct rtw_dev *rtwdev, struct rtw_sta_info *si);
+void rtw_tx_tmpl_free(struct rtw_dev *rtwdev, struct rtw_sta_info *si);
 void rtw_tx_pkt_info_update(struct rtw_dev *rtwdev,
 			    struct rtw_tx_pkt_info *pkt_info,
 			    struct ieee80211_sta *sta,
@@ -110,6 +114,9 @@ void rtw_tx_fill_tx_desc(struct rtw_dev *rtwdev,
 			 struct rtw_tx_pkt_info *pkt_info,
 			 struct rtw_tx_desc *tx_desc);
 void rtw_tx_report_enqueue(struct rtw_dev *rtwdev, struct sk_buff *skb, u8 sn);
+void rtw_tx_report_purge(struct rtw_dev *rtwdev);
+void rtw_tx_8723bs_bss_cck_refresh(struct rtw_dev *rtwdev,
+				   struct ieee80211_vif *vif);
 void rtw_tx_report_handle(struct rtw_dev *rtwdev, struct sk_buff *skb, int src);
 void rtw_tx_report_handle_8723b(struct rtw_dev *rtwdev, u8 report_type,
 				u8 *payload, u8 len);
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/* Copyright(c) 2018-2019  Realtek Corporation
+ */
+
+#include <kunit/test.h>
+
+#define RTW_TX_TEST_FRAMES	100000
+
+static struct ieee80211_sta *rtw_tx_test_sta(struct kunit *test, bool vht)
+{
+	struct ieee80211_sta_vht_cap *vht_cap;
+	struct ieee80211_sta_ht_cap *ht_cap;
+	struct ieee80211_sta *sta;
+	struct rtw_sta_info *si;
+
+	sta = kunit_kzalloc(test, sizeof(*sta) + sizeof(*si), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, sta);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
+	ht_cap = &sta->deflink.ht_cap;
+	vht_cap = &sta->deflink.vht_cap;
+#else
+	ht_cap = &sta->ht_cap;
+	vht_cap = &sta->vht_cap;
+#endif
+
+	ht_cap->ht_supported = true;
+	ht_cap->ampdu_factor = IEEE80211_HT_MAX_AMPDU_64K;
+	ht_cap->ampdu_density = IEEE80211_HT_MPDU_DENSITY_8;
+	ht_cap->mcs.rx_mask[0] = 0xff;
+	ht_cap->mcs.rx_mask[1] = 0xff;
+	vht_cap->vht_supported = vht;
+	vht_cap->vht_mcs.tx_mcs_map = cpu_to_le16(0xfffa);
+
+	si = (struct rtw_sta_info *)sta->drv_priv;
+	si->sta = sta;
+	si->rate_id = vht ? RTW_RATEID_ARFR0_AC_2SS : RTW_RATEID_BGN_40M_2SS;
+	si->bw_mode = vht ? RTW_CHANNEL_WIDTH_80 : RTW_CHANNEL_WIDTH_40;
+	si->stbc_en = true;
+	si->ldpc_en = vht;
+
+	return sta;
+}
+
+static void rtw_tx_test_expect_tmpl(struct kunit *test,
+				    const struct rtw_tx_tmpl *a,
+				    const struct rtw_tx_tmpl *b)
+{
+	KUNIT_EXPECT_EQ(test, a->rate, b->rate);
+	KUNIT_EXPECT_EQ(test, a->rate_id, b->rate_id);
+	KUNIT_EXPECT_EQ(test, a->bw, b->bw);
+	KUNIT_EXPECT_EQ(test, a->ampdu_factor, b->ampdu_factor);
+	KUNIT_EXPECT_EQ(test, a->ampdu_density, b->ampdu_density);
+	KUNIT_EXPECT_EQ(test, a->stbc, b->stbc);
+	KUNIT_EXPECT_EQ(test, a->ldpc, b->ldpc);
+}
+
+/* what rtw_tx_data_pkt_info_update() pays per frame for the station part */
+static u64 rtw_tx_test_time(struct rtw_dev *rtwdev, struct ieee80211_sta *sta,
+			    struct rtw_tx_tmpl *tmpl)
+{
+	ktime_t start;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < RTW_TX_TEST_FRAMES; i++) {
+		rtw_tx_tmpl_get(rtwdev, sta, tmpl);
+		/* keep every lookup, nothing in the loop depends on it */
+		barrier();
+	}
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static void rtw_tx_test_tmpl_bench(struct kunit *test)
+{
+	struct rtw_tx_tmpl built, got;
+	struct ieee80211_sta *sta;
+	struct rtw_dev *rtwdev;
+	struct rtw_sta_info *si;
+	u64 tmpl_ns, build_ns;
+	int vht;
+
+	rtwdev = kunit_kzalloc(test, sizeof(*rtwdev), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, rtwdev);
+
+	mutex_init(&rtwdev->mutex);
+	rtwdev->hal.rf_type = RF_2T2R;
+	rtwdev->efuse.hw_cap.nss = 2;
+
+	for (vht = 0; vht < 2; vht++) {
+		sta = rtw_tx_test_sta(test, vht);
+		si = (struct rtw_sta_info *)sta->drv_priv;
+		rtw_tx_tmpl_build(rtwdev, sta, &built);
+
+		mutex_lock(&rtwdev->mutex);
+		rtw_tx_tmpl_update(rtwdev, si);
+		mutex_unlock(&rtwdev->mutex);
+		KUNIT_ASSERT_NOT_NULL(test, rcu_access_pointer(si->tx_tmpl));
+
+		tmpl_ns = rtw_tx_test_time(rtwdev, sta, &got);
+		rtw_tx_test_expect_tmpl(test, &got, &built);
+
+		/* the fallback when the template could not be allocated */
+		mutex_lock(&rtwdev->mutex);
+		rtw_tx_tmpl_free(rtwdev, si);
+		mutex_unlock(&rtwdev->mutex);
+
+		build_ns = rtw_tx_test_time(rtwdev, sta, &got);
+		rtw_tx_test_expect_tmpl(test, &got, &built);
+
+		kunit_info(test, "%s station, %d frames: template %llu ns, per frame build %llu ns\n",
+			   vht ? "VHT" : "HT", RTW_TX_TEST_FRAMES,
+			   tmpl_ns, build_ns);
+	}
+}
+
+static struct kunit_case rtw_tx_test_cases[] = {
+	KUNIT_CASE(rtw_tx_test_tmpl_bench),
+	{}
+};
+
+static struct kunit_suite rtw_tx_test_suite = {
+	.name = "rtw88_tx",
+	.test_cases = rtw_tx_test_cases,
+};
+
+kunit_test_suites(&rtw_tx_test_suite);
@@ -598,6 +598,55 @@ static int rtw_usb_tx_write(struct rtw_dev *rtwdev,
 	return 0;
 }
 
+static int rtw_usb_tx_write_batch(struct rtw_dev *rtwdev,
+				  enum rtw_tx_queue_type queue,
+				  struct rtw_tx_batch *batch)
+{
+	struct rtw_usb *rtwusb = rtw_get_usb_priv(rtwdev);
+	const struct rtw_chip_info *chip = rtwdev->chip;
+	struct sk_buff_head list[RTW_USB_EP_MAX];
+	struct rtw_tx_pkt_info *pkt_info;
+	struct rtw_usb_tx_data *tx_data;
+	struct rtw_tx_desc *pkt_desc;
+	struct sk_buff *skb;
+	unsigned long flags;
+	int i, ep;
+
+	for (ep = 0; ep < RTW_USB_EP_MAX; ep++)
+		__skb_queue_head_init(&list[ep]);
+
+	for (i = 0; i < batch->num; i++) {
+		skb = batch->skbs[i];
+		pkt_info = &batch->pkt_info[i];
+
+		pkt_info->qsel = rtw_usb_tx_queue_mapping_to_qsel(skb);
+		ep = qsel_to_ep(rtwusb, pkt_info->qsel);
+		if (ep < 0)
+			break;
+
+		pkt_desc = skb_push(skb, chip->tx_pkt_desc_sz);
+		memset(pkt_desc, 0, chip->tx_pkt_desc_sz);
+		rtw_tx_fill_tx_desc(rtwdev, pkt_info, pkt_desc);
+		rtw_tx_fill_txdesc_checksum(rtwdev, pkt_info, pkt_desc);
+		tx_data = rtw_usb_get_tx_data(skb);
+		tx_data->sn = pkt_info->sn;
+
+		__skb_queue_tail(&list[ep], skb);
+	}
+
+	/* take each endpoint queue lock once for the whole burst */
+	for (ep = 0; ep < RTW_USB_EP_MAX; ep++) {
+		if (skb_queue_empty(&list[ep]))
+			continue;
+
+		spin_lock_irqsave(&rtwusb->tx_queue[ep].lock, flags);
+		skb_queue_splice_tail(&list[ep], &rtwusb->tx_queue[ep]);
+		spin_unlock_irqrestore(&rtwusb->tx_queue[ep].lock, flags);
+	}
+
+	return i;
+}
+
 static void rtw_usb_tx_kick_off(struct rtw_dev *rtwdev)
 {
 	struct rtw_usb *rtwusb = rtw_get_usb_priv(rtwdev);
@@ -634,6 +683,7 @@ static void rtw_usb_rx_handler(unsigned long shut_up_gcc)
 
 		if (skb_queue_len(&rtwusb->rx_queue) >= RTW_USB_MAX_RXQ_LEN) {
 			dev_dbg_ratelimited(rtwdev->dev, "failed to get rx_queue, overflow\n");
+			rtw_rx_stats_drop(rtwdev);
 			dev_kfree_skb_any(rx_skb);
 			continue;
 		}
@@ -667,6 +717,7 @@ static void rtw_usb_rx_handler(unsigned long shut_up_gcc)
 				rtw_dbg(rtwdev, RTW_DBG_USB,
 					"failed to allocate RX skb of size %u\n",
 					skb_len);
+				rtw_rx_stats_drop(rtwdev);
 				goto skip_packet;
 			}
 
@@ -679,8 +730,8 @@ static void rtw_usb_rx_handler(unsigned long shut_up_gcc)
 				rtw_update_rx_freq_for_invalid(rtwdev, skb,
 							       &rx_status,
 							       &pkt_stat);
-				rtw_rx_stats(rtwdev, pkt_stat.vif, skb);
 				memcpy(skb->cb, &rx_status, sizeof(rx_status));
+				rtw_rx_stats(rtwdev, pkt_stat.vif, skb);
 				ieee80211_rx_irqsafe(rtwdev->hw, skb);
 			}
 
@@ -694,6 +745,8 @@ skip_packet:
 		else
 			skb_queue_tail(&rtwusb->rx_free_queue, rx_skb);
 	}
+
+	rtw_rx_phy_stat_flush(rtwdev);
 }
 
 static void rtw_usb_read_port_complete(struct urb *urb);
@@ -964,6 +1017,7 @@ static void rtw_usb_dynamic_rx_agg(struct rtw_dev *rtwdev, bool enable)
 
 static const struct rtw_hci_ops rtw_usb_ops = {
 	.tx_write = rtw_usb_tx_write,
+	.tx_write_batch = rtw_usb_tx_write_batch,
 	.tx_kick_off = rtw_usb_tx_kick_off,
 	.setup = rtw_usb_setup,
 	.start = rtw_usb_start,
@@ -5,6 +5,7 @@
 #include "main.h"
 #include "util.h"
 #include "reg.h"
+#include "debug.h"
 
 bool check_hw_ready(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target)
 {
@@ -107,27 +108,23 @@ void rtw_desc_to_mcsrate(u16 rate, u8 *mcs, u8 *nss)
 	}
 }
 
-struct rtw_stas_entry {
-	struct list_head list;
-	struct ieee80211_sta *sta;
-};
-
 struct rtw_iter_stas_data {
-	struct rtw_dev *rtwdev;
-	struct list_head list;
+	struct ieee80211_sta **stas;
+	u32 num;
+	u32 max;
+	u32 overflow;
 };
 
 static void rtw_collect_sta_iter(void *data, struct ieee80211_sta *sta)
 {
 	struct rtw_iter_stas_data *iter_stas = data;
-	struct rtw_stas_entry *stas_entry;
 
-	stas_entry = kmalloc(sizeof(*stas_entry), GFP_ATOMIC);
-	if (!stas_entry)
+	if (iter_stas->num >= iter_stas->max) {
+		iter_stas->overflow++;
 		return;
+	}
 
-	stas_entry->sta = sta;
-	list_add_tail(&stas_entry->list, &iter_stas->list);
+	iter_stas->stas[iter_stas->num++] = sta;
 }
 
 void rtw_iterate_stas(struct rtw_dev *rtwdev,
@@ -135,74 +132,111 @@ void rtw_iterate_stas(struct rtw_dev *rtwdev,
 				       struct ieee80211_sta *sta),
 		      void *data)
 {
-	struct rtw_iter_stas_data iter_data;
-	struct rtw_stas_entry *sta_entry, *tmp;
+	struct rtw_iter_snapshot *snap = &rtwdev->iter_snapshot;
+	struct rtw_iter_stas_data iter_data = {};
+	bool nested;
+	u32 i;
 
 	/* &rtwdev->mutex makes sure no stations can be removed between
-	 * collecting the stations and iterating over them.
+	 * collecting the stations and iterating over them, and it also
+	 * serializes the users of the preallocated snapshot.
 	 */
 	lockdep_assert_held(&rtwdev->mutex);
 
-	iter_data.rtwdev = rtwdev;
-	INIT_LIST_HEAD(&iter_data.list);
+	/* an iterator calling back in here must not clobber the snapshot
+	 * being walked, give the nested walk its own array instead
+	 */
+	nested = snap->stas_busy;
+	if (nested) {
+		iter_data.stas = kcalloc(RTW_MAX_MAC_ID_NUM,
+					 sizeof(*iter_data.stas), GFP_KERNEL);
+		if (!iter_data.stas) {
+			rtw_warn(rtwdev, "failed to iterate stations\n");
+			return;
+		}
+	} else {
+		iter_data.stas = snap->stas;
+		snap->stas_busy = true;
+	}
+	iter_data.max = RTW_MAX_MAC_ID_NUM;
 
 	ieee80211_iterate_stations_atomic(rtwdev->hw, rtw_collect_sta_iter,
 					  &iter_data);
 
-	list_for_each_entry_safe(sta_entry, tmp, &iter_data.list,
-				 list) {
-		list_del_init(&sta_entry->list);
-		iterator(data, sta_entry->sta);
-		kfree(sta_entry);
-	}
-}
+	if (iter_data.overflow)
+		rtw_warn(rtwdev, "%u stations exceed snapshot, not iterated\n",
+			 iter_data.overflow);
 
-struct rtw_vifs_entry {
-	struct list_head list;
-	struct ieee80211_vif *vif;
-};
+	for (i = 0; i < iter_data.num; i++)
+		iterator(data, iter_data.stas[i]);
+
+	if (nested)
+		kfree(iter_data.stas);
+	else
+		snap->stas_busy = false;
+}
 
 struct rtw_iter_vifs_data {
-	struct rtw_dev *rtwdev;
-	struct list_head list;
+	struct ieee80211_vif **vifs;
+	u32 num;
+	u32 max;
+	u32 overflow;
 };
 
 static void rtw_collect_vif_iter(void *data, u8 *mac, struct ieee80211_vif *vif)
 {
-	struct rtw_iter_vifs_data *iter_stas = data;
-	struct rtw_vifs_entry *vifs_entry;
+	struct rtw_iter_vifs_data *iter_vifs = data;
 
-	vifs_entry = kmalloc(sizeof(*vifs_entry), GFP_ATOMIC);
-	if (!vifs_entry)
+	if (iter_vifs->num >= iter_vifs->max) {
+		iter_vifs->overflow++;
 		return;
+	}
 
-	vifs_entry->vif = vif;
-	list_add_tail(&vifs_entry->list, &iter_stas->list);
+	iter_vifs->vifs[iter_vifs->num++] = vif;
 }
 
 void rtw_iterate_vifs(struct rtw_dev *rtwdev,
 		      void (*iterator)(void *data, struct ieee80211_vif *vif),
 		      void *data)
 {
-	struct rtw_iter_vifs_data iter_data;
-	struct rtw_vifs_entry *vif_entry, *tmp;
+	struct rtw_iter_snapshot *snap = &rtwdev->iter_snapshot;
+	struct rtw_iter_vifs_data iter_data = {};
+	bool nested;
+	u32 i;
 
 	/* &rtwdev->mutex makes sure no interfaces can be removed between
-	 * collecting the interfaces and iterating over them.
+	 * collecting the interfaces and iterating over them, and it also
+	 * serializes the users of the preallocated snapshot.
 	 */
 	lockdep_assert_held(&rtwdev->mutex);
 
-	iter_data.rtwdev = rtwdev;
-	INIT_LIST_HEAD(&iter_data.list);
+	nested = snap->vifs_busy;
+	if (nested) {
+		iter_data.vifs = kcalloc(RTW_PORT_NUM, sizeof(*iter_data.vifs),
+					 GFP_KERNEL);
+		if (!iter_data.vifs) {
+			rtw_warn(rtwdev, "failed to iterate interfaces\n");
+			return;
+		}
+	} else {
+		iter_data.vifs = snap->vifs;
+		snap->vifs_busy = true;
+	}
+	iter_data.max = RTW_PORT_NUM;
 
 	ieee80211_iterate_active_interfaces_atomic(rtwdev->hw,
 						   IEEE80211_IFACE_ITER_NORMAL,
 						   rtw_collect_vif_iter, &iter_data);
 
-	list_for_each_entry_safe(vif_entry, tmp, &iter_data.list,
-				 list) {
-		list_del_init(&vif_entry->list);
-		iterator(data, vif_entry->vif);
-		kfree(vif_entry);
-	}
+	if (iter_data.overflow)
+		rtw_warn(rtwdev, "%u interfaces exceed snapshot, not iterated\n",
+			 iter_data.overflow);
+
+	for (i = 0; i < iter_data.num; i++)
+		iterator(data, iter_data.vifs[i]);
+
+	if (nested)
+		kfree(iter_data.vifs);
+	else
+		snap->vifs_busy = false;
 }
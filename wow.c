@@ -575,10 +575,13 @@ err:
 
 static int rtw_wow_leave_linked_ps(struct rtw_dev *rtwdev)
 {
-	if (!test_bit(RTW_FLAG_WOWLAN, rtwdev->flags))
+	if (!test_bit(RTW_FLAG_WOWLAN, rtwdev->flags)) {
 		cancel_delayed_work_sync(&rtwdev->watch_dog_work);
+		/* no DM half of the last round either */
+		WRITE_ONCE(rtwdev->watch_dog_sched.dm_pending, false);
+	}
 
-	rtw_leave_lps(rtwdev);
+	rtw_leave_lps_sync(rtwdev);
 
 	return 0;
 }
@@ -592,7 +595,8 @@ static int rtw_wow_leave_no_link_ps(struct rtw_dev *rtwdev)
 		if (rtw_get_lps_deep_mode(rtwdev) != LPS_DEEP_MODE_NONE)
 			rtw_leave_lps_deep(rtwdev);
 	} else {
-		if (!test_bit(RTW_FLAG_POWERON, rtwdev->flags)) {
+		if (!test_bit(RTW_FLAG_POWERON, rtwdev->flags) ||
+		    test_bit(RTW_FLAG_RETENTION_IPS, rtwdev->flags)) {
 			rtw_wow->ips_enabled = true;
 			ret = rtw_leave_ips(rtwdev);
 			if (ret)